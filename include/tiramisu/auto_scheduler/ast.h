@@ -100,6 +100,16 @@ public:
      * True if the following loop level has been unrolled.
      */
     bool unrolled = false;
+    
+    /**
+     * True if this loop level has been vectorized.
+     */
+    bool vectorized = false;
+    
+    /**
+     * True if this loop level has been parallelized.
+     */
+    bool parallelized = false;
 
     /**
      * List of the computations computed at this level.
@@ -201,6 +211,12 @@ public:
      */
     int get_loop_levels_chain_depth() const;
 
+    /**
+     * Append to repr a textual representation of the subtree rooted at this node.
+     * Used by syntax_tree::get_hash().
+     */
+    void represent_node(std::string& repr) const;
+
     /**
      * Print the subtree rooted at this node.
      */
@@ -325,6 +341,10 @@ public:
     void transform_ast_by_tiling(optimization_info const& opt);
     void transform_ast_by_interchange(optimization_info const& opt);
     void transform_ast_by_unrolling(optimization_info const& opt);
+    void transform_ast_by_vectorization(optimization_info const& opt);
+    void transform_ast_by_parallelization(optimization_info const& opt);
+    void transform_ast_by_skewing(optimization_info const& opt);
+    void transform_ast_by_shifting(optimization_info const& opt);
     
     /**
      * Copy this AST, and return the copy.
@@ -352,6 +372,11 @@ public:
      */
     std::vector<optimization_info> get_schedule() const;
     
+    /**
+     * Return true if the schedule of this AST contains an optimization of the given type.
+     */
+    bool has_optimization(optimization_type type) const;
+    
     /**
      * Add the content of new_optims to previous_optims and
      * clear new_optims.
@@ -394,6 +419,14 @@ public:
      */
     int get_buffer_id(std::string const& buf_name) const;
 
+    /**
+     * Return a hash of the program represented by this AST, of its loop structure,
+     * and of its optimizations (type, loop levels, factors and computations).
+     * The hash does not depend on the order in which the optimizations were applied :
+     * the optimizations are sorted before being hashed.
+     */
+    uint64_t get_hash() const;
+
     /**
      * Print the AST to stdout.
      */
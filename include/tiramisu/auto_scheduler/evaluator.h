@@ -7,6 +7,63 @@
 namespace tiramisu::auto_scheduler
 {
 
+const int DEFAULT_NB_WARMUPS = 2;
+const int DEFAULT_NB_EXECUTIONS = 10;
+
+/**
+ * Stores on disk the evaluations of schedules, so that a schedule that was
+ * already evaluated (during this search, or during a previous one) is not evaluated again.
+ * Schedules are identified by syntax_tree::get_hash().
+ *
+ * The file is a list of records (8 bytes for the hash, 4 bytes for the evaluation),
+ * new evaluations are appended to it.
+ * The file can be shared by concurrent searches : each record is appended
+ * with a single write, under an exclusive lock (flock) of the file.
+ * Use a different file for each evaluation function, as evaluations given by
+ * different evaluation functions are not comparable.
+ */
+class evaluation_cache
+{
+private:
+
+protected:
+    /**
+     * The size of a record of the file : the hash of the AST
+     * followed by its evaluation.
+     */
+    static const int record_size = sizeof(uint64_t) + sizeof(float);
+    
+    /**
+     * The file where evaluations are stored.
+     */
+    int cache_fd;
+    
+    /**
+     * The evaluations read from the file, or inserted since the file was read.
+     */
+    std::unordered_map<uint64_t, float> evaluations;
+    
+public:
+    /**
+     * Load the evaluations stored in the given file.
+     * The file is created if it does not exist.
+     */
+    evaluation_cache(std::string const& filename);
+    
+    ~evaluation_cache();
+    
+    /**
+     * If the given AST was already evaluated, store its evaluation
+     * in "evaluation" and return true. Otherwise, return false.
+     */
+    bool find(syntax_tree const& ast, float& evaluation) const;
+    
+    /**
+     * Store the evaluation of the given AST.
+     */
+    void insert(syntax_tree const& ast, float evaluation);
+};
+
 /**
   * An abstract class that represents an evaluation function.
   * Derive this class and implement the method "evaluate" to
@@ -17,15 +74,30 @@ class evaluation_function
 private:
     
 protected:
+    /**
+     * If not null, evaluations are looked up in this cache before
+     * evaluating a schedule, and new evaluations are stored in it.
+     */
+    evaluation_cache *cache = nullptr;
     
 public:
     virtual ~evaluation_function() {}
     
+    evaluation_cache* get_cache() const { return cache; }
+    void set_cache(evaluation_cache *cache) { this->cache = cache; }
+    
     /**
      * Takes as input an abstract syntax tree and returns
      * its evaluation.
      */
     virtual float evaluate(syntax_tree& ast) =0;
+    
+    /**
+     * Takes as input a list of abstract syntax trees and returns
+     * their evaluations, in the same order.
+     * The default implementation calls evaluate() on each AST.
+     */
+    virtual std::vector<float> evaluate_batch(std::vector<syntax_tree*> const& asts);
 };
 
 /**
@@ -64,6 +136,24 @@ protected:
      * The command that will be used to execute the wrapper to measure execution time.
      */
     std::string wrapper_cmd;
+    
+    /**
+     * The number of processes used by evaluate_batch() to compile
+     * schedules concurrently. If set to 1, schedules are compiled one by one.
+     */
+    int nb_compile_workers = 1;
+    
+    /**
+     * Apply the optimizations specified by the given AST, generate the Halide
+     * statement of the program, and lower it to a Halide module for the given target.
+     * The schedules of the program are not reset by this method.
+     */
+    Halide::Module lower_to_halide_module(syntax_tree& ast, Halide::Target const& target);
+    
+    /**
+     * Execute the wrapper and return the execution time it prints.
+     */
+    float run_wrapper();
 
 public:
     /**
@@ -78,12 +168,98 @@ public:
 	 * Apply the specified optimizations, compile the program and execute it.
 	 */
     virtual float evaluate(syntax_tree& ast);
+    
+    /**
+     * Compile the given schedules concurrently, using nb_compile_workers processes,
+     * and then execute them one by one, so that the measured execution times
+     * are not disturbed by the compilation of other schedules.
+     */
+    virtual std::vector<float> evaluate_batch(std::vector<syntax_tree*> const& asts);
+    
+    void set_nb_compile_workers(int nb_compile_workers) { this->nb_compile_workers = nb_compile_workers; }
+};
+
+/**
+ * Evaluate programs by JIT compiling them, and by executing them
+ * in the process of the autoscheduler.
+ * Unlike evaluate_by_execution, no object file is written, no shared library is
+ * linked, and no wrapper is launched : the argument buffers are allocated once,
+ * and every schedule is timed directly on them.
+ */
+class evaluate_by_jit : public evaluate_by_execution
+{
+private:
+
+protected:
+    /**
+     * The number of executions to perform before measuring execution time.
+     */
+    int nb_warmups;
+    
+    /**
+     * The number of timed executions. The median of these executions is returned.
+     */
+    int nb_executions;
+    
+    /**
+     * The buffers passed to the JIT compiled program (one for each argument).
+     */
+    std::vector<Halide::Buffer<>> arguments_buffers;
+    
+    /**
+     * The arguments in the format expected by JITModule::argv_function().
+     */
+    std::vector<const void*> arguments_ptrs;
+    
+public:
+    /**
+     * arguments : the input and output buffers of the program.
+     * These buffers must have constant extents, as they are allocated
+     * by this evaluation function.
+     */
+    evaluate_by_jit(std::vector<tiramisu::buffer*> const& arguments,
+                    int nb_warmups = DEFAULT_NB_WARMUPS,
+                    int nb_executions = DEFAULT_NB_EXECUTIONS,
+                    tiramisu::function *fct = tiramisu::global::get_implicit_function());
+    
+    /**
+     * Apply the specified optimizations, JIT compile the program,
+     * and return the median of its execution times (in ms).
+     */
+    virtual float evaluate(syntax_tree& ast);
+    
+    /**
+     * JIT compiled code cannot be shared between processes,
+     * so schedules are evaluated one by one.
+     */
+    virtual std::vector<float> evaluate_batch(std::vector<syntax_tree*> const& asts)
+    {
+        return evaluation_function::evaluate_batch(asts);
+    }
+};
+
+/**
+ * Types of the frames sent to the ML model by evaluate_by_learning_model.
+ */
+enum model_frame_type
+{
+    PROGRAM_FRAME = 1,
+    SCHEDULES_FRAME = 2
 };
 
 /**
  * This evaluation function uses system pipes to communicate with an ML model
  * that will evaluate schedules.
- * JSON is used to transfer information about the schedule to evaluate.
+ *
+ * The following binary protocol is used (all integers are native 32 bits integers) :
+ * - A program frame : PROGRAM_FRAME, the size of the JSON of the program, the JSON of the program.
+ *   It is sent once, before the first schedules of a program.
+ * - A schedules frame : SCHEDULES_FRAME, the number of schedules, the number of distinct
+ *   tree structures, each tree structure (the size of its JSON and the JSON), and for each
+ *   schedule the record written by write_schedule().
+ * The model answers each schedules frame with the number of schedules, followed by
+ * the predicted speedup of each schedule (as 32 bits floats). The model evaluates the
+ * schedules that share a tree structure in one batch.
  */
 class evaluate_by_learning_model : public evaluation_function
 {
@@ -99,6 +275,30 @@ protected:
      * The pipe on which to read the evaluation of a schedule.
      */
     FILE *model_read;
+    
+    /**
+     * The function whose program was last sent to the model.
+     */
+    tiramisu::function *program_sent = nullptr;
+    
+    /**
+     * Send the JSON of the program represented by the given AST.
+     */
+    void write_program(syntax_tree const& ast);
+    
+    /**
+     * Write the schedule of the given AST as a record of 15 integers :
+     * the unfused loop level, the two interchanged loop levels, the number of tiled
+     * loop levels, the first tiled loop level, the three tiling factors, the unrolling factor,
+     * the parallelized loop level, the vector width, the first skewed loop level, the two
+     * skewing factors, and the index of the tree structure of the schedule in the frame.
+     * The value -1 (0 for the number of tiled levels and the factors) indicates
+     * that the corresponding optimization is not applied.
+     * The record is followed by the number of shiftings, and by each shifting as
+     * 3 integers : the absolute order of the shifted computation (as in the JSON
+     * of the program), the shifted loop level, and the shift.
+     */
+    void write_schedule(syntax_tree const& ast, int32_t tree_index);
 
 public:
     /**
@@ -112,6 +312,11 @@ public:
 	 */
     virtual float evaluate(syntax_tree& ast);
     
+    /**
+     * Send the given schedules to the model in one frame, and return its evaluations.
+     */
+    virtual std::vector<float> evaluate_batch(std::vector<syntax_tree*> const& asts);
+    
     /**
      * Return a JSON representation of the program represented by the AST.
      * Uses the function : represent_computations_from_nodes. 
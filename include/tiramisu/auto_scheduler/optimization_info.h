@@ -14,7 +14,11 @@ enum optimization_type
     FUSION,
     TILING,
     INTERCHANGE,
-    UNROLLING
+    UNROLLING,
+    VECTORIZATION,
+    PARALLELIZATION,
+    SKEWING,
+    SHIFTING
 };
 
 /**
@@ -36,8 +40,9 @@ struct optimization_info
     /**
      * This attribute is used when transforming the AST.
      * It indicates the node at which to start the transformation.
+     * It is null for optimizations applied to all innermost levels (l0 == -1).
      */
-    ast_node *node;
+    ast_node *node = nullptr;
     
     /**
      * The number of loop levels that this optimization affects.
@@ -55,6 +60,9 @@ struct optimization_info
      *
      * 2. In the case of fusion, l0 and l1 will contain the indices
      * of the two nodes to fuse, in the tree level to which "node" belongs to.
+     *
+     * 3. In the case of vectorization, if l0 == -1, vectorization is applied
+     * on all innermost levels.
      */
     int l0, l1, l2;
     
@@ -62,6 +70,13 @@ struct optimization_info
      * Contains the factors of each loop level.
      * For example, if the optimization is a 2 level tiling,
      * l0_fact and l1_fact will contain the tiling factors for each loop level.
+     *
+     * 1. In the case of vectorization, l0_fact is the vector width.
+     *
+     * 2. In the case of skewing, l0_fact and l1_fact are the factors (a, b)
+     * such as the new outer loop level is a*l0 + b*l1 (see computation::skew()).
+     *
+     * 3. In the case of shifting, l0_fact is the shift applied to l0.
      */
     int l0_fact, l1_fact, l2_fact;
 };
@@ -76,6 +91,11 @@ void parallelize_outermost_levels(std::vector<tiramisu::computation*> const& com
  */
 void unroll_innermost_levels(std::vector<tiramisu::computation*> const& comps_list, int unroll_fact);
 
+/**
+ * Tag the innermost level of each computation to be vectorized with a vector width = vector_width.
+ */
+void vectorize_innermost_levels(std::vector<tiramisu::computation*> const& comps_list, int vector_width);
+
 /**
  * Apply the optimizations specified by the syntax tree using the Tiramisu API.
  */
@@ -9,6 +9,7 @@ namespace tiramisu::auto_scheduler
 
 const std::vector<int> TILING_FACTORS_DEFAULT_LIST = {32, 64, 128};
 const std::vector<int> UNROLLING_FACTORS_DEFAULT_LIST = {4, 8, 16};
+const std::vector<int> VECTORIZATION_FACTORS_DEFAULT_LIST = {4, 8, 16};
 const int DEFAULT_MAX_NB_ITERATORS = 7;
 
 /**
@@ -29,14 +30,84 @@ protected:
      * A list of unrolling factors to apply when unrolling is applied.
      */
     std::vector<int> unrolling_factors_list;
+    
+    /**
+     * A list of vector widths to apply when vectorization is applied.
+     */
+    std::vector<int> vectorization_factors_list;
+    
+    /**
+     * If true, generated schedules that do not respect the dependences
+     * of the program are not returned.
+     */
+    bool check_legality = false;
+    
+    /**
+     * The function whose dependences were computed.
+     * Dependences only depend on the program, so they are computed once
+     * and reused to check every generated schedule.
+     */
+    tiramisu::function *analyzed_fct = nullptr;
+    
+    /**
+     * Compute the dependences of the program represented by the given AST,
+     * if they were not computed yet.
+     * The given AST must not contain optimizations, this is the case of the
+     * AST given to the first call of generate_schedules() by search methods.
+     */
+    void compute_dependences(syntax_tree const& ast);
+    
+    /**
+     * Return true if the schedule of the given AST respects the dependences
+     * of the program, and if the outermost loop levels can be parallelized
+     * (evaluation functions parallelize them, see parallelize_outermost_levels()).
+     * The AST must have been transformed by its optimizations.
+     */
+    bool is_legal(syntax_tree const& ast);
+    
+    /**
+     * Remove from states (and delete) the ASTs whose schedules are not legal.
+     * ast is the AST from which states were generated.
+     */
+    void prune_illegal_schedules(syntax_tree const& ast, std::vector<syntax_tree*>& states);
+    
+    /**
+     * Apply the schedule of the given AST, and prepare it for the queries
+     * of the dependence analysis (skewing_local_solver(), correcting_loop_fusion_with_shifting()).
+     * The dependences must have been computed with compute_dependences().
+     */
+    void prepare_dependence_queries(syntax_tree const& ast);
+    
+    /**
+     * Use skewing_local_solver() to find the skewings of the given node and its child
+     * that allow to parallelize one of them, or that improve locality.
+     * Add the corresponding ASTs to states.
+     */
+    void generate_skewings(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast);
+    
+    /**
+     * For each computation of the subtree rooted at the given node, except the first one,
+     * use correcting_loop_fusion_with_shifting() to find the shift of the given node
+     * that makes the fusion of the computation with the previous ones legal.
+     * Add the corresponding ASTs to states.
+     */
+    void generate_shiftings(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast);
 
 public:
     schedules_generator(std::vector<int> const& tiling_factors_list = TILING_FACTORS_DEFAULT_LIST,
-                        std::vector<int> const& unrolling_factors_list = UNROLLING_FACTORS_DEFAULT_LIST)
+                        std::vector<int> const& unrolling_factors_list = UNROLLING_FACTORS_DEFAULT_LIST,
+                        std::vector<int> const& vectorization_factors_list = VECTORIZATION_FACTORS_DEFAULT_LIST)
         
-        : tiling_factors_list(tiling_factors_list), unrolling_factors_list(unrolling_factors_list) {}
+        : tiling_factors_list(tiling_factors_list), unrolling_factors_list(unrolling_factors_list),
+          vectorization_factors_list(vectorization_factors_list) {}
 
     virtual ~schedules_generator() {}
+    
+    /**
+     * If set to true, use the dependence analysis of Tiramisu to prune
+     * generated schedules that are not legal.
+     */
+    void set_check_legality(bool check_legality) { this->check_legality = check_legality; }
 
     /**
      * Given an AST, and an optimization to apply, 
@@ -47,7 +118,8 @@ public:
 
 /**
  * Generate all combinations of the following optimizations :
- * Fusion, tiling, interchange, unrolling.
+ * Fusion, tiling, interchange, unrolling, vectorization, parallelization,
+ * skewing, shifting.
  */
 class exhaustive_generator : public schedules_generator
 {
@@ -77,12 +149,24 @@ protected:
      * apply unrolling recursively on children of the given node.
      */
     void generate_unrollings(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast);
+    
+    /**
+     * Apply vectorization to the innermost loop levels of the subtree rooted at the given node.
+     */
+    void generate_vectorizations(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast);
+    
+    /**
+     * Try to parallelize the given node, and then call this method recursively
+     * on children of the given node.
+     */
+    void generate_parallelizations(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast);
 
 public:
     exhaustive_generator(std::vector<int> const& tiling_factors_list = TILING_FACTORS_DEFAULT_LIST,
-                         std::vector<int> const& unrolling_factors_list = UNROLLING_FACTORS_DEFAULT_LIST)
+                         std::vector<int> const& unrolling_factors_list = UNROLLING_FACTORS_DEFAULT_LIST,
+                         std::vector<int> const& vectorization_factors_list = VECTORIZATION_FACTORS_DEFAULT_LIST)
         
-        : schedules_generator(tiling_factors_list, unrolling_factors_list) {}
+        : schedules_generator(tiling_factors_list, unrolling_factors_list, vectorization_factors_list) {}
 
     virtual std::vector<syntax_tree*> generate_schedules(syntax_tree const& ast, optimization_type optim);
 };
@@ -90,7 +174,8 @@ public:
 /**
  * Generate unfuse applied to shared loop levels.
  * Generate tilings and interchanges applied to shared loop levels.
- * Generate unrollings applied to innermost loop levels.
+ * Generate unrollings and vectorizations applied to innermost loop levels.
+ * Generate parallelizations and skewings applied to shared loop levels.
  */
 class ml_model_schedules_generator : public schedules_generator
 {
@@ -105,9 +190,10 @@ protected:
 public:
     ml_model_schedules_generator(int max_nb_iterators = DEFAULT_MAX_NB_ITERATORS,
                      std::vector<int> const& tiling_factors_list = TILING_FACTORS_DEFAULT_LIST,
-                     std::vector<int> const& unrolling_factors_list = UNROLLING_FACTORS_DEFAULT_LIST)
+                     std::vector<int> const& unrolling_factors_list = UNROLLING_FACTORS_DEFAULT_LIST,
+                     std::vector<int> const& vectorization_factors_list = VECTORIZATION_FACTORS_DEFAULT_LIST)
         
-        : schedules_generator(tiling_factors_list, unrolling_factors_list),    
+        : schedules_generator(tiling_factors_list, unrolling_factors_list, vectorization_factors_list),    
           max_nb_iterators(max_nb_iterators) {}
         
     virtual std::vector<syntax_tree*> generate_schedules(syntax_tree const& ast, optimization_type optim);
@@ -14,7 +14,12 @@ namespace tiramisu::auto_scheduler
 
 const std::vector<optimization_type> DEFAULT_OPTIMIZATIONS_ORDER = {UNFUSE, INTERCHANGE, TILING, UNROLLING};
 
-const int NB_OPTIMIZATIONS = DEFAULT_OPTIMIZATIONS_ORDER.size();
+/**
+ * An order that also explores skewing, parallelization and vectorization.
+ * Skewing is explored before tiling, as it relies on the original names of the loop levels.
+ */
+const std::vector<optimization_type> EXTENDED_OPTIMIZATIONS_ORDER = {UNFUSE, SKEWING, INTERCHANGE, TILING, PARALLELIZATION, VECTORIZATION, UNROLLING};
+
 const int DEFAULT_MAX_DEPTH = INT_MAX;
 
 /**
@@ -60,6 +65,11 @@ protected:
      */
     evaluate_by_execution *exec_eval = nullptr;
     
+    /**
+     * The order in which optimizations are explored.
+     */
+    std::vector<optimization_type> optimizations_order = DEFAULT_OPTIMIZATIONS_ORDER;
+    
 public:
     search_method(evaluation_function *eval_func = nullptr, schedules_generator *scheds_gen = nullptr)
         : eval_func(eval_func), scheds_gen(scheds_gen) {}
@@ -72,6 +82,7 @@ public:
     
     void set_eval_func(evaluation_function *eval_func) { this->eval_func = eval_func; }
     void set_exec_eval(evaluate_by_execution *exec_eval) { this->exec_eval = exec_eval; }
+    void set_optimizations_order(std::vector<optimization_type> const& optimizations_order) { this->optimizations_order = optimizations_order; }
         
     /**
       * The method to call to start a search.
@@ -62,6 +62,7 @@ public:
     void interchange(int L0, int L1) override;
     void parallelize(var L) override;
     void shift(var L0, int n) override;
+    void shift(int L0, int n) override;
     /*
     void skew(var i, var j, int f, var ni, var nj) override;
     void skew(var i, var j, var k, int factor, var ni, var nj, var nk) override;
@@ -94,6 +95,7 @@ public:
     void unroll(int L, int fac) override;
     void vectorize(var L, int v) override;
     void vectorize(var L, int v, var L_outer, var L_inner) override;
+    void vectorize(int L, int v) override;
     // @}
 };  // class block
 
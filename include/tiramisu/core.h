@@ -11,6 +11,7 @@
 #include <isl/space.h>
 #include <isl/constraint.h>
 
+#include <functional>
 #include <map>
 #include <string.h>
 #include <stdint.h>
@@ -22,6 +23,7 @@
 #include <tiramisu/debug.h>
 #include <tiramisu/expr.h>
 #include <tiramisu/type.h>
+#include <tiramisu/profiler.h>
 #include "cuda_ast.h"
 
 namespace tiramisu
@@ -51,6 +53,7 @@ class dnn_access_matrix;
 class simple_generator;
 
 void unroll_innermost_levels(std::vector<tiramisu::computation*> const& comps_list, int unroll_fact);
+void vectorize_innermost_levels(std::vector<tiramisu::computation*> const& comps_list, int vector_width);
 }
 
 struct HalideCodegenOutput
@@ -136,6 +139,12 @@ void init();
 void codegen(const std::vector<tiramisu::buffer *> &arguments, const std::string obj_filename, const bool gen_cuda_stmt = false);
 void codegen(const std::vector<tiramisu::buffer *> &arguments, const std::string obj_filename, const tiramisu::hardware_architecture_t gen_architecture_flag);
 
+/**
+  * Generate a version of the implicit function specialized for the values
+  * of the parameters that satisfy \p constraints (see function::specialize_on()).
+  */
+void specialize_on(const std::string &constraints, std::function<void()> schedule = std::function<void()>());
+
 /**
  * Full check of schedule legality for this function using dependency analysis 
  * must be used after invoking : performe_full_dependency_analysis()
@@ -160,6 +169,19 @@ void performe_full_dependency_analysis();
  */
 void prepare_schedules_for_legality_checks(bool reset_static_dimesion = false);
 
+/**
+ * Fold the storage of the temporary buffers of the implicit function
+ * automatically (see function::fold_storage_automatically()).
+ */
+void fold_storage_automatically();
+
+/**
+ * Pad the buffers of the implicit function whose accesses conflict in the
+ * cache (see function::pad_buffers_automatically()).
+ */
+std::map<std::string, int> pad_buffers_automatically(int cache_size = 32 * 1024, int associativity = 8,
+                                                     int line_size = 64);
+
  /**
      * Checks if the given fuzed computations could legally have their loop level \p i as parallel using dependence analysis and legality check.
      * It relies fully on the dependence analysis result, so the  method \p performe_full_dependency_analysis() must be invoked before.
@@ -354,6 +376,57 @@ private:
       */
     std::vector<std::tuple<std::string, int, int>> unroll_dimensions;
 
+    /**
+      * Indexes of parallel_dimensions, vector_dimensions and unroll_dimensions
+      * by computation name. They map each computation name to its tagged
+      * loop levels (and to the vector length or the unrolling factor of each
+      * level), and are used by should_parallelize(), should_vectorize(),
+      * get_vector_length() and get_unrolling_factor() during code generation.
+      */
+    // @{
+    std::unordered_map<std::string, std::unordered_set<int>> parallel_dimensions_index;
+    std::unordered_map<std::string, std::unordered_map<int, int>> vector_dimensions_index;
+    std::unordered_map<std::string, std::unordered_map<int, int>> unroll_dimensions_index;
+    // @}
+
+    /**
+      * The vectorized dimensions whose last partial vector is not handled
+      * by separation (see computation::vectorize()), mapped to the way it
+      * is handled, by computation name and loop level.
+      */
+    std::unordered_map<std::string, std::unordered_map<int, tiramisu::vector_tail_t>> vector_tails;
+
+    /**
+      * The software prefetches requested for each computation (see
+      * computation::prefetch()). Each computation name is mapped to a vector
+      * of tuples <accessed_name, level, distance>: the data accessed by
+      * the computation in the buffer or the computation \p accessed_name
+      * is prefetched \p distance iterations of the loop level \p level
+      * ahead. An empty \p accessed_name means all the streaming accesses
+      * of the computation.
+      */
+    std::unordered_map<std::string, std::vector<std::tuple<std::string, int, int>>> prefetch_dimensions;
+
+    /**
+      * The loop levels of each computation in which the buffer accesses
+      * that do not depend on the loop are promoted to registers (scalar
+      * replacement, see computation::unroll_and_jam()).
+      */
+    std::unordered_map<std::string, std::unordered_set<int>> scalar_replacement_dimensions;
+
+    /**
+      * The computations whose stores are non-temporal (see
+      * computation::tag_streaming_store()).
+      */
+    std::unordered_set<std::string> streaming_store_computations;
+
+    /**
+      * The specialized versions of the function (see specialize_on()).
+      * Each specialization is a set of constraints over the parameters of
+      * the function and the schedule used when these constraints hold.
+      */
+    std::vector<std::pair<std::string, std::function<void()>>> specializations;
+
     /**
       * Body of the function (a vector of computations).
       * The order of the computations in the vector does not have any
@@ -363,6 +436,12 @@ private:
       */
     std::vector<computation *> body;
 
+    /**
+      * Index of the computations of body by name, used by get_computation_by_name().
+      * It is maintained by add_computation() and computation::set_name().
+      */
+    std::unordered_map<std::string, std::vector<computation *>> computations_index;
+
     /**
       * A Halide statement that represents the whole function.
       * This value stored in halide_stmt is generated by the code generator
@@ -396,6 +475,38 @@ private:
 
     std::shared_ptr<cuda_ast::compiler> nvcc_compiler;
 
+    /**
+      * True if gen_halide_obj generates one version of the function per
+      * x86 instruction set and a dispatcher (see set_multi_isa_codegen()).
+      */
+    bool multi_isa_codegen;
+
+    /**
+      * True if the storage of the temporary buffers is folded during the
+      * lowering of the Halide statement (see set_native_storage_folding()).
+      */
+    bool native_storage_folding;
+
+    /**
+      * True if the accesses that are invariant in the innermost loop of
+      * each computation are promoted to registers automatically (see
+      * set_automatic_scalar_replacement()).
+      */
+    bool automatic_scalar_replacement;
+
+    /**
+      * True if scalar replacement also promotes the invariant loads of the
+      * buffers that are not written in the loop (see
+      * set_read_only_scalar_replacement()).
+      */
+    bool read_only_scalar_replacement;
+
+    /**
+      * True if the temporary buffers allocated by Tiramisu are packed in
+      * one arena according to their live ranges (see set_memory_planning()).
+      */
+    bool memory_planning;
+
     /**
       * Tag the dimension \p dim of the computation \p computation_name to
       * be parallelized.
@@ -412,6 +523,12 @@ private:
       */
     void add_vector_dimension(std::string computation_name, int vec_dim, int len);
 
+    /**
+      * Set how the last partial vector of the vectorized dimension \p vec_dim
+      * of the computation \p computation_name is handled.
+      */
+    void set_vector_tail(std::string computation_name, int vec_dim, tiramisu::vector_tail_t tail);
+
     /**
       * Tag the dimension \p dim of the computation \p computation_name to
       * be distributed.
@@ -428,6 +545,80 @@ private:
       * \p factor in the unrolling factor.
       */
     void add_unroll_dimension(std::string stmt_name, int L, int factor);
+
+    /**
+      * Prefetch the data of \p accessed_name accessed by the computation
+      * \p stmt_name, \p distance iterations of the loop level \p L ahead.
+      * \p accessed_name is the name of a buffer or of a computation, or an
+      * empty string for all the streaming accesses of the computation.
+      */
+    void add_prefetch_dimension(std::string stmt_name, std::string accessed_name, int L, int distance);
+
+    /**
+      * Promote to registers the accesses of the computation \p stmt_name
+      * that are invariant in the loop level \p L.
+      */
+    void add_scalar_replacement_dimension(std::string stmt_name, int L);
+
+    /**
+      * Tag for scalar replacement the innermost sequential loop of each
+      * computation, if the access relation of the computation proves that
+      * the element written by the computation does not depend on that loop
+      * (e.g. the loop over k of C(i,j) = C(i,j) + A(i,k)*B(k,j)).
+      * This is called by gen_halide_stmt() if automatic scalar replacement
+      * is enabled.
+      */
+    void gen_scalar_replacement_tags();
+
+    /**
+      * Make the stores of the computation \p stmt_name non-temporal.
+      */
+    void add_streaming_store(std::string stmt_name);
+
+    /**
+      * Generate the loop nest of each specialization of the function (see
+      * specialize_on()) and return a statement that runs the first
+      * specialization whose constraints hold, or \p generic if none holds.
+      * The schedule and the buffers of the function are restored after
+      * each specialization, and the computations created by its schedule
+      * are deleted.
+      */
+    Halide::Internal::Stmt gen_specializations(const Halide::Internal::Stmt &generic);
+
+    /**
+      * Report an error if the schedule of the specialization \p constraints
+      * created a temporary buffer allocated by the function, or changed the
+      * storage of one of them (\p generic_buffers are the buffers of the
+      * generic version). These buffers are allocated once, with the storage
+      * of the generic version, for all the versions of the function.
+      */
+    void check_specialized_temporaries(
+            const std::string &constraints,
+            const std::vector<std::pair<tiramisu::buffer *, tiramisu::buffer>> &generic_buffers) const;
+
+    /**
+      * Return true if the storage of the buffer \p src can be reused for
+      * the buffer \p dst in the loop nest where src is last used and dst
+      * is first used: the buffers have the same type and size, and the
+      * access relations show that each element of src is only read by the
+      * instance that writes the element of dst at the same address.
+      * \p concurrent_buffers are the buffers written in that loop nest.
+      */
+    bool can_write_in_place(const buffer *src, const buffer *dst,
+                            const std::unordered_set<std::string> &concurrent_buffers) const;
+
+    /**
+      * Compute the live range of the temporary buffers of the function in
+      * \p s (the loop nests at the root of \p s where each buffer is used)
+      * and place the buffers in one arena: buffers whose live ranges do not
+      * overlap share storage, and a buffer may overwrite in place a buffer
+      * that dies in the loop nest where it is produced (see
+      * can_write_in_place()). Return \p s wrapped in the allocation of the
+      * arena and add the names of the buffers placed in the arena to
+      * \p planned.
+      */
+    Halide::Internal::Stmt plan_temporary_buffers(const Halide::Internal::Stmt &s,
+                                                  std::unordered_set<std::string> &planned);
     
     /**
      * \brief Remove parallel, vectorized, distributed, unrolled and GPU tags
@@ -557,6 +748,12 @@ protected:
       */
     void add_computation(computation *cpt);
 
+    /**
+      * Update the index of computations after the computation \p cpt
+      * was renamed from \p old_name.
+      */
+    void update_computation_name(computation *cpt, const std::string &old_name);
+
     /**
       * Tag the dimensions \p dim0, \p dim1 and \p dim2 of the computation
       * \p computation_name to be mapped to GPU blocks.
@@ -764,12 +961,30 @@ protected:
      */
     int get_vector_length(const std::string &comp, int lev) const;
 
+    /**
+      * Return how the last partial vector of the loop level \p lev of
+      * the computation \p comp is handled, if that level is vectorized.
+      */
+    tiramisu::vector_tail_t get_vector_tail(const std::string &comp, int lev) const;
+
     /**
      * If the computation \p comp is unrolled at the loop level \p lev,
      * return its unrolling factor.
      */
     int get_unrolling_factor(const std::string &comp, int lev) const;
 
+    /**
+      * Return the prefetches requested for the computation \p comp as
+      * tuples <accessed_name, level, distance> (see add_prefetch_dimension()).
+      */
+    std::vector<std::tuple<std::string, int, int>> get_prefetches(const std::string &comp) const;
+
+    /**
+      * Return true if the accesses of the computation \p comp that are
+      * invariant in the loop level \p lev should be promoted to registers.
+      */
+    bool should_scalar_replace(const std::string &comp, int lev) const;
+
    /**
      * Return true if the usage of high level scheduling comments is valid; i.e. if
      * the scheduling relations formed using before, after, compute_at, etc.. form a tree.
@@ -982,9 +1197,61 @@ public:
      *    is _C_buffer.
      *  - Map the computation to the allocated buffer (one-to-one mapping).
      *    For more details about one-to-one mapping, see computation::store_in.
+     *
+     * If memory planning is enabled (see set_memory_planning()), the
+     * storage of these buffers is shared when their live ranges do not
+     * overlap.
      */
     void allocate_and_map_buffers_automatically();
 
+    /**
+     * \brief Fold the storage of the temporary buffers automatically.
+     *
+     * \details For each temporary buffer written by a single computation
+     * (each element being written once), compute, under the current
+     * schedule, how far along each dimension of the buffer the elements
+     * written while an element is still live (i.e. before its last read)
+     * can be. If this reuse distance is bounded by a constant d, the
+     * dimension can be folded by a factor d + 1 (see
+     * computation::storage_fold()). The dimension that reduces the
+     * size of the buffer the most is folded, e.g. the temporary of a
+     * stencil computed at the loop level of its consumer becomes a
+     * rolling buffer of a few rows.
+     *
+     * The dependences are computed with performe_full_dependency_analysis(),
+     * so this method must be called once the schedule and the buffers
+     * of the computations are final (before codegen()). Buffers accessed
+     * by computations whose loops are parallel, vectorized, distributed or
+     * mapped to GPU are not folded.
+     */
+    void fold_storage_automatically();
+
+    /**
+     * \brief Pad the buffers whose accesses conflict in the cache.
+     *
+     * \details For each computation, find the dimensions of the buffers
+     * that its innermost loop walks through (consecutive iterations access
+     * different rows, e.g. the columns of a transposed matrix). With the
+     * model of a cache of \p cache_size bytes, of associativity
+     * \p associativity and with lines of \p line_size bytes, rows whose
+     * stride is a multiple of a large power of two (e.g. N = 1024 floats)
+     * are mapped to a few sets of the cache. The innermost dimension of
+     * such buffers is padded by the smallest number of elements that lets
+     * the walks use at least half of the cache (up to two lines).
+     *
+     * Only temporary and input buffers of constant size that are not
+     * already padded (see buffer::set_padding()) are padded. The padding
+     * is recorded in the buffer (see buffer::get_extra_padding()). The
+     * data of padded input buffers must be stored with the padded size.
+     *
+     * Return the number of elements added to the innermost dimension of
+     * each padded buffer, so that the wrappers of the function can allocate
+     * the inputs accordingly. This must be called once the schedule and
+     * the buffers of the computations are final (before codegen()).
+     */
+    std::map<std::string, int> pad_buffers_automatically(int cache_size = 32 * 1024, int associativity = 8,
+                                                         int line_size = 64);
+
     /**
       * \brief Compute the bounds of each computation.
       *
@@ -1112,6 +1379,29 @@ public:
       */
     void gen_c_code() const;
 
+    /**
+      * \brief Generate a self-contained C file that implements the function.
+      * \details The C code is generated from the Halide statement of the
+      * function (gen_halide_stmt() should be called first), so it contains
+      * the same loop nests, statement bodies and linearized accesses as the
+      * object file generated by gen_halide_obj(). The generated function
+      * takes a pointer to the data of each argument buffer (declared
+      * \c restrict) and returns 0, or -1 if an assertion failed.
+      * Temporary buffers of a small constant size are local arrays; the
+      * other buffers are allocated with malloc.
+      * Parallel loops are annotated with \c "#pragma omp parallel for",
+      * vectorized loops with \c "#pragma omp simd" (with an \c aligned
+      * clause for the buffers that have an alignment, see
+      * buffer::set_alignment()) and unrolled loops with an unroll pragma.
+      * The file should be compiled with OpenMP enabled (e.g. -fopenmp)
+      * for the pragmas to take effect.
+      * codegen() calls this function instead of gen_halide_obj() when the
+      * name of the output file ends with ".c".
+      * GPU and distributed code, and extern functions that take a
+      * halide_buffer_t, are not supported.
+      */
+    void gen_c_code(const std::string &c_file_name) const;
+
     // ADD:FLEXNLP
     /**
       * \brief Generate autocopy statements for FlexNLP.
@@ -1203,9 +1493,127 @@ public:
       */
     void set_arguments(const std::vector<tiramisu::buffer *> &buffer_vec);
 
+    /**
+      * If \p multi_isa is true, gen_halide_obj (and codegen) generate three
+      * versions of the function for x86 CPUs: one for AVX-512 (Skylake), one
+      * for AVX2 + FMA and a baseline version for AVX + SSE4.1. A dispatcher
+      * named after the function checks the features of the CPU at runtime
+      * (using cpuid) and calls the best version.
+      * All the versions and the dispatcher are written in a single static
+      * library (an ar archive) instead of an object file: the path given to
+      * codegen must therefore end with ".a", e.g.
+      * \code
+      * f.set_multi_isa_codegen(true);
+      * tiramisu::codegen({&b_A, &b_B}, "build/generated_fct.a");
+      * \endcode
+      * This is ignored for non-x86 targets and for GPU and FlexNLP code,
+      * which still write an object file (at the same path).
+      */
+    void set_multi_isa_codegen(bool multi_isa);
+
+    /**
+      * If \p enable is true, the temporary buffers whose uses are all inside
+      * one sequential loop, and whose accessed range moves forward with that
+      * loop, are folded during the lowering of the Halide statement: they
+      * are reallocated with the size of the range accessed by one iteration
+      * (rounded up to a power of two) and accessed modulo that size (e.g. a
+      * line buffer for fused stencils). Buffers with vector accesses are
+      * folded only if the vector accesses remain dense.
+      * This is disabled by default. fold_storage_automatically() folds
+      * storage at the schedule level instead, from the dependences.
+      */
+    void set_native_storage_folding(bool enable);
+
+    /**
+      * If \p enable is true, the loads and stores that the
+      * access relations of a computation prove invariant in its innermost
+      * sequential loop (typically the accumulator of a reduction) are
+      * promoted to registers: they are loaded before the loop and stored
+      * after it, instead of relying on LLVM to prove that the accesses do
+      * not alias the other accesses of the loop. This is disabled by
+      * default: each promoted access costs a register, which can cause
+      * spills in loops that already use many of them.
+      */
+    void set_automatic_scalar_replacement(bool enable);
+
+    /**
+      * If \p enable is true, scalar replacement (automatic or requested by
+      * computation::unroll_and_jam()) also loads into registers, before the
+      * loop, the invariant elements of the buffers that are only read in
+      * the loop. This is disabled by default: only the buffers written in
+      * the loop are promoted, LLVM hoists the invariant read-only loads.
+      */
+    void set_read_only_scalar_replacement(bool enable);
+
+    /**
+      * If \p enable is true, the temporary buffers that Tiramisu allocates
+      * (including the buffers of allocate_and_map_buffers_automatically())
+      * are placed in a single arena allocated at the entry of the function.
+      * The live range of each buffer is computed from the final schedule
+      * (the loop nests where the buffer is used), buffers whose live ranges
+      * do not overlap share the same storage, and a buffer can reuse in
+      * place the storage of a buffer that dies in the loop nest that
+      * produces it when the access relations allow it (e.g. an element-wise
+      * operation). The plan is printed at debug level 3.
+      *
+      * This is disabled by default: the buffers of the arena are pointers
+      * into the same allocation, so LLVM cannot assume that they do not
+      * alias. When native storage folding is enabled (see
+      * set_native_storage_folding()), the buffers that it folds are not
+      * placed in the arena.
+      */
+    void set_memory_planning(bool enable);
+
+    /**
+      * \brief Generate a version of the function specialized for the values
+      * of the parameters that satisfy \p constraints.
+      *
+      * \details \p constraints is an ISL set over the parameters of the
+      * function (the same syntax as add_context_constraints()), for example
+      *     "[N]->{: N % 64 = 0 and N >= 512}".
+      * During code generation, the schedule \p schedule is applied on top
+      * of the schedule of the function (the generic version) and the loop
+      * nest of the specialized version is generated assuming that
+      * \p constraints hold. This alone removes the tails and the guards
+      * that the constraints make useless (e.g. the tail of a vectorized
+      * loop when N is a multiple of the vector length). The schedule and
+      * the buffers of the function are restored after the specialized
+      * version is generated. The computations created by \p schedule
+      * (e.g. by separate() or allocate_at()) are deleted at that point, so
+      * \p schedule should create computations with new.
+      *
+      * The temporary buffers allocated by the function are allocated once
+      * for all the versions: it is an error for \p schedule to create such
+      * a buffer or to change its storage (sizes, set_layout(),
+      * set_padding() or set_alignment()). Buffers allocated with
+      * buffer::allocate_at() in \p schedule are allocated by the
+      * specialized version itself.
+      *
+      * All the versions are generated in one function. At runtime, the
+      * function runs the first specialization (in the order of the calls
+      * to specialize_on()) whose constraints hold, or the generic version
+      * if none holds.
+      *
+      * Example:
+      *
+      * \code
+      * C.vectorize(j, 8);
+      * f.specialize_on("[N]->{: N % 64 = 0 and N >= 512}", [&]() {
+      *     C.tile(i, j, 64, 64, i0, j0, i1, j1);
+      *     C.parallelize(i0);
+      * });
+      * \endcode
+      *
+      * This is only supported for CPU code.
+      */
+    void specialize_on(const std::string &constraints,
+                       std::function<void()> schedule = std::function<void()>());
+
     /**
      * Wrapper for all the functions required to run code generation of a
      * tiramisu program.
+     * If \p obj_filename ends with ".c", a C file is generated instead of
+     * an object file (see gen_c_code()).
      */
     void codegen(const std::vector<tiramisu::buffer *> &arguments, const std::string obj_filename, const bool gen_cuda_stmt = false);
     void codegen(const std::vector<tiramisu::buffer *> &arguments, const std::string obj_filename, const tiramisu::hardware_architecture_t gen_architecture_flag);
@@ -1434,6 +1842,28 @@ private:
      */
     cuda_ast::memory_location location;
 
+    /**
+      * The alignment in bytes of the host data of the buffer, or 0 if
+      * it is unknown (see set_alignment()).
+      */
+    int alignment = 0;
+
+    /**
+      * The size of the innermost dimension is padded to a multiple of
+      * \p padding elements, then \p extra_padding elements are added
+      * (see set_padding()). unpadded_innermost_size is the size of the
+      * innermost dimension before padding.
+      */
+    int padding = 1;
+    int extra_padding = 0;
+    tiramisu::expr unpadded_innermost_size;
+
+    /**
+      * True if the layout of the buffer was changed by set_layout(). No
+      * computation can be stored in the buffer afterwards.
+      */
+    bool has_layout = false;
+
 protected:
     /**
      * Set the type of the argument. Three possible types exist:
@@ -1600,6 +2030,13 @@ public:
      *      }
      * \endcode
      *
+     * Buffers of constant size up to 16 KiB (without alignment) are
+     * allocated on the stack. Other buffers are allocated in an arena
+     * owned by the thread that runs the loop: the allocation is a bump of
+     * a pointer and the memory is released at the end of the scope of the
+     * allocation, without calling malloc and free at each iteration. The
+     * memory of the arenas can be supplied with
+     * tiramisu_set_thread_arena_allocator() (see tiramisu/externs.h).
      */
     //@{
     tiramisu::computation *allocate_at(tiramisu::computation &C, tiramisu::var level);
@@ -1745,6 +2182,85 @@ public:
      */
     bool has_constant_extents();
 
+    /**
+      * Declare that the host data of the buffer is aligned to \p alignment
+      * bytes (a power of two).
+      *
+      * For buffers passed as arguments, the generated code checks the
+      * alignment of the data at the entry of the function: if all the
+      * aligned arguments are aligned, it runs a version of the code that
+      * assumes the alignment (and can use aligned vector loads and stores),
+      * otherwise it runs a generic version.
+      * Temporary buffers are allocated with this alignment.
+      *
+      * Combined with set_padding(), this allows aligned vector accesses
+      * to every row of the buffer.
+      */
+    void set_alignment(int alignment);
+
+    /**
+      * Return the alignment of the buffer in bytes, or 0 if it is unknown.
+      */
+    int get_alignment() const;
+
+    /**
+      * Pad the innermost dimension of the buffer to a multiple of
+      * \p padding elements: the stride of the other dimensions is rounded
+      * up to a multiple of \p padding, e.g. buf[N][M] is stored as
+      * buf[N][M'] where M' = ceil(M / padding) * padding.
+      * \p extra_elements elements are then added to the innermost
+      * dimension, e.g. set_padding(1, 16) stores buf[N][M] as
+      * buf[N][M + 16] (see function::pad_buffers_automatically()).
+      * Temporary buffers are allocated with the padded size. The data of
+      * buffers passed as arguments must be stored with the padded size.
+      */
+    void set_padding(int padding, int extra_elements = 0);
+
+    /**
+      * Return the multiple to which the innermost dimension of the buffer
+      * is padded (1 if the buffer is not padded).
+      */
+    int get_padding() const;
+
+    /**
+      * Return the number of elements added to the innermost dimension of
+      * the buffer after rounding it up to a multiple of get_padding().
+      */
+    int get_extra_padding() const;
+
+    /**
+      * Return true if the innermost dimension of the buffer is padded.
+      */
+    bool is_padded() const;
+
+    /**
+      * Change the layout of the buffer and rewrite the access relations
+      * of all the computations stored in the buffer accordingly.
+      *
+      * The layout is built in three steps:
+      *  - each pair (d, f) of \p blocks splits the dimension d of size N
+      *    into an outer dimension of size ceil(N / f), which takes the
+      *    place of d, and an inner dimension of size f, which is added
+      *    after the last dimension (in the order of \p blocks),
+      *  - the dimension i of the new layout is the dimension \p order[i]
+      *    of the blocked buffer (an empty \p order keeps the order),
+      *  - the innermost dimension is padded to a multiple of \p padding
+      *    elements (see set_padding()).
+      *
+      * For example, for buf[N][C][H][W], set_layout({}, {{1, 16}}) stores
+      * the buffer as buf[N][C/16][H][W][16] (NCHWc16) and
+      * set_layout({0, 2, 3, 1}) stores it as buf[N][H][W][C] (NHWC).
+      *
+      * This must be called once the computations are stored in the
+      * buffer (see computation::store_in()): it is an error to call it on a
+      * buffer that stores no computation, or to store a computation in the
+      * buffer afterwards. The data of buffers passed as arguments must be
+      * stored in the new layout.
+      */
+    void set_layout(const std::vector<int> &order,
+                    const std::vector<std::pair<int, int>> &blocks = {},
+                    int padding = 1);
+
     /**
      * Return true if a statement that allocates the buffer was
      * already generated.
@@ -1809,6 +2325,7 @@ class computation
     friend auto_scheduler::evaluate_by_execution;
     
     friend void auto_scheduler::unroll_innermost_levels(std::vector<tiramisu::computation*> const& comps_list, int unroll_fact);
+    friend void auto_scheduler::vectorize_innermost_levels(std::vector<tiramisu::computation*> const& comps_list, int vector_width);
 
 private:
 
@@ -2659,12 +3176,6 @@ private:
      */
     void set_iterators_map(std::map<std::string, isl_ast_expr *> map);
 
-    /**
-      * Identical to
-      *      void shift(tiramisu::var L0, int n);
-      */
-    void shift(int L0, int n);
-
     /**
       * Simplify \p set using the context and by calling
       * set coalescing.
@@ -3299,6 +3810,8 @@ public:
     computation(std::vector<var> iterator_variables, primitive_t t)
             : computation(iterator_variables, expr(t)) {}
 
+    virtual ~computation() {}
+
     virtual bool is_send() const;
 
     virtual bool is_recv() const;
@@ -4244,7 +4757,10 @@ public:
       * number means a shift forward of the loop iterations while
       * a negative value would mean a shift backward.
       */
+    // @{
     virtual void shift(var L0, int n);
+    virtual void shift(int L0, int n);
+    // @}
     
 
     /*
@@ -4410,6 +4926,12 @@ public:
      */
     virtual void storage_fold(var dim, int f);
 
+    /**
+     * Fold the dimension \p dim of the buffer of the computation by a
+     * factor \p f: the buffer is accessed modulo \p f along \p dim.
+     */
+    void storage_fold(int dim, int f);
+
     /**
      * Allocate the storage of this computation in the loop level \p L0.
      *
@@ -4505,6 +5027,64 @@ public:
      */
     void tag_unroll_level(int L, int F);
 
+    /**
+      * Write the results of this computation with non-temporal (streaming)
+      * stores, which bypass the cache. This is useful for large outputs
+      * that are written once and not read again soon: the output does not
+      * evict the data that is reused from the cache, and the lines written
+      * are not read from memory before being written (read for ownership).
+      *
+      * The stores of this computation (and not the stores of the other
+      * computations that write the same buffer) are marked as
+      * non-temporal in the LLVM code, and a store fence is added at the end
+      * of each function that contains them (in particular at the end of
+      * each task of a parallel loop), so that the data is visible once the
+      * parallel loop is over. LLVM only generates non-temporal instructions
+      * for the stores that it can prove aligned, which is usually the case
+      * of the stores of a vectorized loop over an aligned buffer. Other
+      * stores are regular stores.
+      *
+      * The stores are identified in the LLVM code by calls placed around
+      * the statement of the computation, which are removed once LLVM has
+      * optimized the code. The stores keep the alias information of their
+      * buffer, so the computation can read what it wrote (e.g. a reduction
+      * or a recurrence), but LLVM does not move accesses across the
+      * statement (use computation::vectorize() to vectorize the loop).
+      *
+      * Streaming stores are not used when code is generated for several
+      * instruction sets (function::set_multi_isa_codegen()) or for GPUs.
+      */
+    void tag_streaming_store();
+
+    /**
+      * Insert software prefetches for the data that this computation reads
+      * from \p b. The data read at the iteration i + \p distance of the loop
+      * level \p L is prefetched at the iteration i, so that it is in cache
+      * when it is used. This is useful for memory-bound loops whose access
+      * patterns are not handled by the hardware prefetcher (indirect or
+      * strided accesses for example).
+      *
+      * Prefetches are emitted in the innermost loop around the computation.
+      * If an inner loop level is vectorized, the data used by the first
+      * lane of the vector is prefetched.
+      */
+    void prefetch(tiramisu::buffer *b, tiramisu::var L, int distance);
+
+    /**
+      * Identical to
+      *     void prefetch(tiramisu::buffer *b, tiramisu::var L, int distance);
+      * except that the data read from the computation (or input) \p c
+      * is prefetched.
+      */
+    void prefetch(tiramisu::computation &c, tiramisu::var L, int distance);
+
+    /**
+      * Prefetch all the streaming accesses of this computation, i.e. all
+      * the data it reads from buffers with an index that depends on the
+      * loop level \p L, \p distance iterations ahead.
+      */
+    void prefetch(tiramisu::var L, int distance);
+
     /**
       * \brief Schedule this computation to run before the computation \p next_computation
       * at the loop level \p L and return \p next_computation.
@@ -4631,6 +5211,68 @@ public:
     virtual void unroll(int L, int fac);
     //@}
 
+    /**
+      * Unroll the loop level \p L by \p fac and jam the unrolled copies
+      * into the innermost loop (register tiling).
+      *
+      * The loop level \p L is split by \p fac (as in unroll()) and the
+      * inner loop is interchanged down to the innermost level, where it is
+      * unrolled: its copies are jammed in the loop that was innermost
+      * before the interchange (the jammed loop). The accesses that do not
+      * depend on the jammed loop are then promoted to registers (scalar
+      * replacement): they are loaded before the jammed loop and stored
+      * after it.
+      * For example, the matrix multiplication
+      *
+      * \code
+      * for (int i = 0; i < N; i++)
+      *   for (int j = 0; j < M; j++)
+      *     for (int k = 0; k < K; k++)
+      *       C[i][j] += A[i][k] * B[k][j];
+      * \endcode
+      *
+      * unrolled and jammed with unroll_and_jam(i, 2) is first split and
+      * interchanged into
+      *
+      * \code
+      * for (int i0 = 0; i0 < N/2; i0++)
+      *   for (int j = 0; j < M; j++)
+      *     for (int k = 0; k < K; k++)      // jammed loop
+      *       for (int i1 = 0; i1 < 2; i1++) // unrolled
+      *         C[2*i0 + i1][j] += A[2*i0 + i1][k] * B[k][j];
+      * \endcode
+      *
+      * and the accesses to C, which do not depend on k, are promoted to
+      * registers:
+      *
+      * \code
+      * for (int i0 = 0; i0 < N/2; i0++)
+      *   for (int j = 0; j < M; j++)
+      *   {
+      *     c0 = C[2*i0][j];
+      *     c1 = C[2*i0 + 1][j];
+      *     for (int k = 0; k < K; k++)
+      *     {
+      *       c0 += A[2*i0][k] * B[k][j];
+      *       c1 += A[2*i0 + 1][k] * B[k][j];
+      *     }
+      *     C[2*i0][j] = c0;
+      *     C[2*i0 + 1][j] = c1;
+      *   }
+      * \endcode
+      *
+      * where the remainder of the loop over i (if N is not a multiple of 2)
+      * is separated. As with interchange(), the user is responsible for
+      * the legality of moving the unrolled loop to the innermost level.
+      *
+      * \p L_outer and \p L_inner are the names of the new loops created
+      * after splitting. If not provided, default names will be assigned.
+      */
+    //@{
+    void unroll_and_jam(var L, int fac);
+    void unroll_and_jam(var L, int fac, var L_outer, var L_inner);
+    //@}
+
     /**
       * Vectorize the loop level \p L.  Use the vector length \p v.
       *
@@ -4697,6 +5339,45 @@ public:
     // @{
     virtual void vectorize(var L, int v);
     virtual void vectorize(var L, int v, var L_outer, var L_inner);
+    virtual void vectorize(int L, int v);
+    // @}
+
+    /**
+      * Vectorize the loop level \p L by a factor \p v, handling the last
+      * partial vector as indicated by \p tail:
+      *   - vector_tail_t::separate is identical to vectorize(L, v): the
+      *     loop is separated into full vectors and a scalar remainder;
+      *   - vector_tail_t::masked generates a single loop over vectors.
+      *     The loads and the stores of the last vector are masked (using
+      *     masked vector instructions on targets that support them, such
+      *     as AVX2 and AVX-512 for 32-bit types, and scalarized otherwise).
+      *   - vector_tail_t::padded generates a single loop over full vectors
+      *     without any mask: the last vector reads and writes up to
+      *     \p v - 1 elements past the end of the loop. The innermost
+      *     dimension of all the buffers accessed by the computation must be
+      *     padded to a multiple of \p v (see buffer::set_padding()), or
+      *     have a constant size that is a multiple of \p v; code generation
+      *     fails otherwise. The elements of the padding are read and written.
+      *
+      * For example, vectorizing the loop
+      *
+      * \code
+      * for (int i=0; i<23; i++)
+      *   S0;
+      * \endcode
+      *
+      * with v = 4 and a masked tail produces
+      *
+      * \code
+      * for (int i1=0; i1<6; i1++)
+      *   for (int i2=0; i2<4; i2++) // vectorized
+      *     if (i1*4 + i2 < 23)      // mask
+      *       S0;
+      * \endcode
+      */
+    // @{
+    void vectorize(var L, int v, tiramisu::vector_tail_t tail);
+    void vectorize(var L, int v, var L_outer, var L_inner, tiramisu::vector_tail_t tail);
     // @}
 
     /**
@@ -5311,6 +5992,9 @@ protected:
       *     - a function \p fct for which we are generating code,
       *     - a \p node,
       *     - \p level represents the current loop level being traversed (0 means the outer level.
+      *     - \p enclosing_loops, the loops around \p node, from the outermost
+      *     to the innermost: the name of the iterator of each loop and its
+      *     lower bound,
       *     - \p is_a_child_block indicates whether the block that is ging to be
       *     generated is a child block for an other block. In such a case, allocate
       *     and let statements should not be generate. Allocate and let statements
@@ -5320,14 +6004,73 @@ protected:
     static Halide::Internal::Stmt halide_stmt_from_isl_node(const tiramisu::function &fct, isl_ast_node *node,
                                                             int level,
                                                             std::vector<std::pair<std::string, std::string>> &tagged_stmts,
+                                                            std::vector<std::pair<std::string, Halide::Expr>> &enclosing_loops,
                                                             bool is_a_child_block);
 
     // TODO doc
     static Halide::Internal::Stmt make_halide_block(const Halide::Internal::Stmt &first,
             const Halide::Internal::Stmt &second);
 
+    /**
+      * Return a statement that allocates the buffer \p b with the extents
+      * \p extents (from innermost to outermost) around \p stmt.
+      * \p in_loop is true for the buffers allocated inside a loop (see
+      * buffer::allocate_at()): they are allocated on the stack if they are
+      * small, and in the arena of the thread otherwise (see
+      * uses_thread_arena()).
+      */
     static Halide::Internal::Stmt make_buffer_alloc(buffer *b, const std::vector<Halide::Expr> &extents,
-                                                    Halide::Internal::Stmt &stmt);
+                                                    Halide::Internal::Stmt &stmt, bool in_loop = false);
+
+    /**
+      * Return true if the buffer \p b, allocated inside a loop, is
+      * allocated in the arena of the thread (tiramisu_thread_arena_malloc)
+      * rather than on the stack, i.e. if its size is not a constant of at
+      * most 16 KiB or if it has an alignment.
+      */
+    static bool uses_thread_arena(buffer *b);
+
+    /**
+      * Report an error if a buffer accessed by the computation
+      * \p comp_name, vectorized by \p vector_length with
+      * vector_tail_t::padded, is not padded to a multiple of
+      * \p vector_length (see computation::vectorize()).
+      */
+    static void check_padding_for_vector_tail(const tiramisu::function &fct, const std::string &comp_name,
+                                              int vector_length);
+
+    /**
+      * Insert before \p s, the statement generated for the computation
+      * \p comp, the prefetches requested for \p comp using
+      * computation::prefetch(). \p enclosing_loops are the loops around
+      * \p s (see halide_stmt_from_isl_node()).
+      */
+    static Halide::Internal::Stmt add_prefetches(const tiramisu::function &fct, tiramisu::computation *comp,
+                                                 const std::vector<std::pair<std::string, Halide::Expr>> &enclosing_loops,
+                                                 const Halide::Internal::Stmt &s);
+
+    /**
+      * Scalar replacement: promote to registers the loads and stores of the
+      * body of the loop \p s whose index does not depend on the loop (e.g.
+      * the accumulators of a reduction). Each promoted element is loaded
+      * into a scalar before the loop, accessed through that scalar in the
+      * loop and stored back after the loop. The unrolled loops of constant
+      * extent in the body are unrolled first, so that each copy of an
+      * unrolled and jammed loop gets its own registers.
+      * The buffers that are only read in the loop are promoted only if
+      * \p promote_read_only is true.
+      */
+    static Halide::Internal::Stmt scalar_replace_invariant_accesses(const Halide::Internal::Stmt &s,
+                                                                    bool promote_read_only);
+
+    /**
+      * If some arguments of \p fct are declared aligned (see
+      * buffer::set_alignment()), return a statement that checks their
+      * alignment and runs a version of \p s that assumes it, or \p s if
+      * the check fails. Otherwise, return \p s.
+      */
+    static Halide::Internal::Stmt add_alignment_checks(const tiramisu::function &fct,
+                                                       const Halide::Internal::Stmt &s);
     static Halide::Internal::Stmt make_buffer_free(buffer *b);
 
     /**
@@ -5662,12 +6405,55 @@ public:
 
 void halide_stmt_dump(Halide::Internal::Stmt s);
 
+/**
+  * Return \p s, the statement of a computation that stores in the buffer
+  * \p buffer, between markers that identify its stores as non-temporal
+  * (see computation::tag_streaming_store()). The markers are calls to
+  * the extern functions nontemporal_stores_marker(true) and
+  * nontemporal_stores_marker(false) with the name of the buffer as
+  * argument. Unless lower_halide_pipeline() is asked to keep them, they
+  * are removed during lowering.
+  */
+Halide::Internal::Stmt mark_nontemporal_stores(const std::string &buffer, const Halide::Internal::Stmt &s);
+
+/**
+  * Return the name of the function called by the marker of the beginning
+  * (if \p begin is true) or of the end of non-temporal stores (see
+  * mark_nontemporal_stores()).
+  */
+std::string nontemporal_stores_marker(bool begin);
+
+/**
+  * Return \p s without the markers inserted by mark_nontemporal_stores().
+  */
+Halide::Internal::Stmt remove_nontemporal_stores_markers(const Halide::Internal::Stmt &s);
+
+/**
+  * Return true if the native storage folding of lower_halide_pipeline()
+  * (see function::set_native_storage_folding()) can fold the buffer
+  * \p buffer, of type \p type and extents \p extents, allocated around
+  * the statement \p s.
+  */
+bool can_fold_storage(const std::string &buffer, const Halide::Type &type,
+                      const std::vector<Halide::Expr> &extents, const Halide::Internal::Stmt &s);
+
+/**
+  * Lower the Halide statement \p s of a function to a Halide module.
+  * If \p fold_storage is true, the storage of the temporary buffers is
+  * folded during lowering (see function::set_native_storage_folding()).
+  * If \p keep_nontemporal_markers is true, the markers of non-temporal
+  * stores (see mark_nontemporal_stores()) are kept in the lowered code,
+  * and the generated code must be annotated and the calls removed before
+  * it is linked. Otherwise the markers are removed.
+  */
 Halide::Module lower_halide_pipeline(
     const std::string &pipeline_name,
     const Halide::Target &t,
     const std::vector<Halide::Argument> &args,
     const Halide::Internal::LoweredFunc::LinkageType linkage_type,
-    Halide::Internal::Stmt s);
+    Halide::Internal::Stmt s,
+    bool fold_storage = false,
+    bool keep_nontemporal_markers = false);
 
 int loop_level_into_dynamic_dimension(int level);
 int loop_level_into_static_dimension(int level);
@@ -11,6 +11,7 @@
 #include <isl/space.h>
 
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <string.h>
@@ -37,6 +38,125 @@ class var;
 class sync;
 class global;
 
+/**
+  * A vector of sub-expressions shared between the copies of an expression.
+  * Copying a shared_vector only copies a reference counted pointer to its
+  * elements, so copying an expression takes a constant time whatever the
+  * size of the expression tree. The elements are copied the first time a
+  * shared vector is modified (copy-on-write), so copies never observe the
+  * modifications of each other.
+  */
+template <typename T>
+class shared_vector
+{
+private:
+    /**
+      * The elements of the vector. Null if the vector is empty.
+      */
+    std::shared_ptr<std::vector<T>> elements;
+
+    /**
+      * Return the elements of the vector after making sure that
+      * they are not shared with any other copy.
+      */
+    std::vector<T> &unshared_elements()
+    {
+        if (elements == nullptr)
+            elements = std::make_shared<std::vector<T>>();
+        else if (elements.use_count() > 1)
+            elements = std::make_shared<std::vector<T>>(*elements);
+
+        return *elements;
+    }
+
+public:
+    shared_vector() {}
+
+    shared_vector(const std::vector<T> &v)
+    {
+        if (!v.empty())
+            elements = std::make_shared<std::vector<T>>(v);
+    }
+
+    shared_vector &operator=(const std::vector<T> &v)
+    {
+        if (v.empty())
+            elements = nullptr;
+        else
+            elements = std::make_shared<std::vector<T>>(v);
+        return *this;
+    }
+
+    size_t size() const
+    {
+        return (elements == nullptr) ? 0 : elements->size();
+    }
+
+    bool empty() const
+    {
+        return this->size() == 0;
+    }
+
+    /**
+      * Read the i-th element. This never copies the vector.
+      */
+    const T &operator[](size_t i) const
+    {
+        return (*elements)[i];
+    }
+
+    /**
+      * Return a reference to the i-th element that can be modified
+      * without affecting the other copies of the vector.
+      * The reference is invalidated if the vector is copied.
+      */
+    T &mutable_at(size_t i)
+    {
+        return unshared_elements()[i];
+    }
+
+    /**
+      * Replace the i-th element with \p e.
+      */
+    void set(size_t i, const T &e)
+    {
+        this->mutable_at(i) = e;
+    }
+
+    void push_back(const T &e)
+    {
+        unshared_elements().push_back(e);
+    }
+
+    /**
+      * Return the elements as a standard vector.
+      */
+    const std::vector<T> &get() const
+    {
+        static const std::vector<T> empty_vector;
+        return (elements == nullptr) ? empty_vector : *elements;
+    }
+
+    typename std::vector<T>::const_iterator begin() const
+    {
+        return this->get().begin();
+    }
+
+    typename std::vector<T>::const_iterator end() const
+    {
+        return this->get().end();
+    }
+
+    /**
+      * Return true if this vector and \p other share their elements,
+      * in which case they are equal without comparing the elements.
+      */
+    bool shares_elements_with(const shared_vector &other) const
+    {
+        return elements == other.elements;
+    }
+};
+
 template <typename T>
 using only_integral = typename std::enable_if<std::is_integral<T>::value, expr>::type;
 
@@ -66,6 +186,12 @@ private:
       */
     static function *implicit_fct;
 
+    /**
+      * Directory where the objects generated by function::codegen are cached.
+      * Empty if objects are not cached.
+      */
+    static std::string object_cache_directory;
+
 public:
 
     /**
@@ -142,6 +268,27 @@ public:
         return global::loop_iterator_type;
     }
 
+    /**
+      * Cache the objects generated by function::codegen in the directory
+      * \p directory (which must exist). Objects are identified by a hash of
+      * the generated Halide statement, of the target and of the function
+      * arguments: when codegen generates a statement that was already
+      * compiled, the cached object and header are copied instead of
+      * lowering the statement and running LLVM again.
+      * An empty \p directory disables the cache.
+      * The default is the value of the environment variable
+      * TIRAMISU_OBJECT_CACHE_DIR, or no cache if it is not set.
+      */
+    static void set_object_cache_directory(const std::string &directory)
+    {
+        global::object_cache_directory = directory;
+    }
+
+    static const std::string &get_object_cache_directory()
+    {
+        return global::object_cache_directory;
+    }
+
     global()
     {
         set_default_tiramisu_options();
@@ -169,8 +316,9 @@ class expr
     /**
       * The value of the 1st, 2nd and 3rd operands of the expression.
       * op[0] is the 1st operand, op[1] is the 2nd, ...
+      * The operands are shared between the copies of the expression.
       */
-    std::vector<tiramisu::expr> op;
+    tiramisu::shared_vector<tiramisu::expr> op;
 
     /**
       * The value of the expression.
@@ -195,7 +343,7 @@ class expr
       * For example for the computation C0(i,j), the access is
       * the vector {i, j}.
       */
-    std::vector<tiramisu::expr> access_vector;
+    tiramisu::shared_vector<tiramisu::expr> access_vector;
 
     /**
       * A vector of expressions representing arguments of an
@@ -206,7 +354,7 @@ class expr
       *     the computation C0 (i.e., its buffer).
       * \p vector should be {tiramisu::expr(1), C1(0,0), tiramisu::expr(o_address, tiramisu::var("C0"))}.
       */
-    std::vector<tiramisu::expr> argument_vector;
+    tiramisu::shared_vector<tiramisu::expr> argument_vector;
 
     /**
       * Is this expression defined?
@@ -758,7 +906,7 @@ public:
         }
         for (int i = 0; i < this->op.size(); i++) {
             tiramisu::expr operand = this->get_operand(i);
-            this->op[i] = operand.replace_op_in_expr(to_replace, replace_with);
+            this->op.set(i, operand.replace_op_in_expr(to_replace, replace_with));
         }
         return *this;
     }
@@ -786,7 +934,7 @@ public:
                this->get_op_type() == tiramisu::o_address_of || this->get_op_type() == tiramisu::o_dummy ||
                        this->get_op_type() == tiramisu::o_buffer);
 
-        return access_vector;
+        return access_vector.get();
     }
 
     /**
@@ -797,7 +945,7 @@ public:
         assert(this->get_expr_type() == tiramisu::e_op);
         assert(this->get_op_type() == tiramisu::o_call);
 
-        return argument_vector;
+        return argument_vector.get();
     }
 
     /**
@@ -839,14 +987,19 @@ public:
             return equal;
         }
 
-        for (int i = 0; i < this->access_vector.size(); i++)
-            equal = equal && this->access_vector[i].is_equal(e.access_vector[i]);
+        // Sub-expressions shared by the two expressions are equal and
+        // do not need to be compared.
+        if (!this->access_vector.shares_elements_with(e.access_vector))
+            for (int i = 0; equal && i < this->access_vector.size(); i++)
+                equal = this->access_vector[i].is_equal(e.access_vector[i]);
 
-        for (int i = 0; i < this->op.size(); i++)
-            equal = equal && this->op[i].is_equal(e.op[i]);
+        if (!this->op.shares_elements_with(e.op))
+            for (int i = 0; equal && i < this->op.size(); i++)
+                equal = this->op[i].is_equal(e.op[i]);
 
-        for (int i = 0; i < this->argument_vector.size(); i++)
-            equal = equal && this->argument_vector[i].is_equal(e.argument_vector[i]);
+        if (!this->argument_vector.shares_elements_with(e.argument_vector))
+            for (int i = 0; equal && i < this->argument_vector.size(); i++)
+                equal = this->argument_vector[i].is_equal(e.argument_vector[i]);
 
         if ((this->etype == e_val) && (e.etype == e_val))
         {
@@ -1011,7 +1164,7 @@ public:
     void set_access_dimension(int i, tiramisu::expr acc)
     {
         assert((i < (int)this->access_vector.size()) && "index is out of bounds.");
-        access_vector[i] = acc;
+        access_vector.set(i, acc);
     }
 
     /**
@@ -1665,11 +1818,11 @@ public:
     {
         tiramisu::expr e{*this};
         for (int i = 0; i < access_vector.size(); i++)
-            e.access_vector[i] = f(e.access_vector[i]);
+            e.access_vector.set(i, f(access_vector[i]));
         for (int i = 0; i < op.size(); i++)
-            e.op[i] = f(e.op[i]);
+            e.op.set(i, f(op[i]));
         for (int i = 0; i < argument_vector.size(); i++)
-            e.argument_vector[i] = f(e.argument_vector[i]);
+            e.argument_vector.set(i, f(argument_vector[i]));
 
         return e;
     }
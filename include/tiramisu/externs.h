@@ -25,6 +25,60 @@ float *tiramisu_address_of_float32(halide_buffer_t *buffer, unsigned long index)
 
 double *tiramisu_address_of_float64(halide_buffer_t *buffer, unsigned long index);
 
+/**
+  * Allocate \p size bytes aligned to \p alignment bytes (and at least to
+  * the alignment that Halide assumes for allocations). This is used to
+  * allocate the temporary buffers that have an alignment (see
+  * tiramisu::buffer::set_alignment()).
+  */
+void *tiramisu_aligned_malloc(uint64_t size, uint64_t alignment);
+
+/**
+  * Free a buffer allocated with tiramisu_aligned_malloc. Always returns 0.
+  */
+int32_t tiramisu_aligned_free(void *ptr);
+
+/**
+  * Return the address \p offset bytes after the start of \p arena. This is
+  * used to place the temporary buffers packed by the memory planner in
+  * their arena (see tiramisu::function::set_memory_planning()).
+  */
+void *tiramisu_arena_address(void *arena, uint64_t offset);
+
+/**
+  * Allocate \p size bytes aligned to \p alignment bytes in the arena of
+  * the calling thread. This is used for the temporary buffers allocated
+  * inside loops (see tiramisu::buffer::allocate_at()) that do not fit on
+  * the stack. The arena is a bump allocator: allocations are released in
+  * the reverse order of allocation with tiramisu_thread_arena_free, so
+  * each iteration of a loop reuses the same memory. Allocations that do
+  * not fit in the arena fall back to tiramisu_aligned_malloc.
+  */
+void *tiramisu_thread_arena_malloc(uint64_t size, uint64_t alignment);
+
+/**
+  * Release a buffer allocated with tiramisu_thread_arena_malloc, and all
+  * the buffers allocated after it by the same thread. Always returns 0.
+  */
+int32_t tiramisu_thread_arena_free(void *ptr);
+
+typedef void *(*tiramisu_arena_allocator_t)(uint64_t size);
+typedef void (*tiramisu_arena_deallocator_t)(void *arena);
+
+/**
+  * Set the functions that allocate and free the memory of the arena of
+  * each thread (e.g. to use huge pages or memory local to a NUMA node),
+  * and the initial size of the arenas in bytes. The memory returned by
+  * \p allocate must be aligned to 128 bytes. An arena grows (it is
+  * reallocated with \p allocate) when it is empty and too small for an
+  * allocation. Arenas created before the call keep their functions.
+  * By default, arenas are allocated with tiramisu_aligned_malloc and
+  * start with 1 MiB.
+  */
+void tiramisu_set_thread_arena_allocator(tiramisu_arena_allocator_t allocate,
+                                         tiramisu_arena_deallocator_t deallocate,
+                                         uint64_t initial_size);
+
 #ifdef WITH_MPI
 void *tiramisu_address_of_wait(halide_buffer_t *buffer, unsigned long index);
 #endif
@@ -0,0 +1,156 @@
+#ifndef _H_TIRAMISU_PROFILER_
+#define _H_TIRAMISU_PROFILER_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace tiramisu
+{
+
+/**
+  * A profiler for the compilation phases of Tiramisu (function::codegen).
+  *
+  * When profiling is enabled, each phase of the code generator
+  * (lift_dist_comps, gen_time_space_domain, gen_isl_ast, gen_halide_stmt,
+  * lower_halide_pipeline and the LLVM code emission in gen_halide_obj)
+  * records its wall time and the peak resident set size (RSS) of the
+  * process at the end of the phase. Phases that process computations one
+  * by one also record one event per computation.
+  *
+  * Profiling is enabled either by calling compile_profiler::enable() or by
+  * setting the environment variable TIRAMISU_COMPILE_PROFILE to the path of
+  * the report file. At the end of each call to function::codegen the report
+  * is written in the Chrome trace event format (a JSON file that can be
+  * loaded in chrome://tracing or https://ui.perfetto.dev).
+  *
+  * Example:
+  *
+  * \code
+  * tiramisu::compile_profiler::enable("compile_profile.json");
+  * tiramisu::codegen({&b_A, &b_B}, "generated.o");
+  * \endcode
+  */
+class compile_profiler
+{
+public:
+    /**
+      * A profiled phase.
+      */
+    struct event
+    {
+        /**
+          * The name of the phase.
+          */
+        std::string name;
+
+        /**
+          * The name of the function being compiled.
+          */
+        std::string function_name;
+
+        /**
+          * The name of the computation processed by this phase, or an
+          * empty string if the phase processes the whole function.
+          */
+        std::string computation_name;
+
+        /**
+          * Start time in microseconds since the profiler was enabled.
+          */
+        double start_us;
+
+        /**
+          * Wall time of the phase in microseconds.
+          */
+        double duration_us;
+
+        /**
+          * Peak RSS of the process (in kilobytes) at the end of the phase.
+          */
+        long peak_rss_kb;
+
+        /**
+          * Increase of the peak RSS of the process (in kilobytes) during the phase.
+          */
+        long peak_rss_growth_kb;
+    };
+
+    /**
+      * An object that profiles the phase running between its construction
+      * and its destruction. It does nothing if profiling is disabled.
+      *
+      * \code
+      * {
+      *     compile_profiler::scope s("gen_isl_ast", this->get_name());
+      *     ...
+      * }
+      * \endcode
+      */
+    class scope
+    {
+    private:
+        bool active;
+        event e;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        scope(const std::string &phase, const std::string &function_name,
+              const std::string &computation_name = "");
+        ~scope();
+
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+    };
+
+    /**
+      * Enable profiling. The report is written to \p report_file_name.
+      */
+    static void enable(const std::string &report_file_name);
+
+    /**
+      * Disable profiling. The events recorded so far are kept.
+      */
+    static void disable();
+
+    /**
+      * Return true if profiling is enabled, either through enable() or
+      * through the environment variable TIRAMISU_COMPILE_PROFILE.
+      */
+    static bool is_enabled();
+
+    /**
+      * Return the events recorded so far.
+      */
+    static const std::vector<event> &get_events();
+
+    /**
+      * Remove all the recorded events.
+      */
+    static void clear();
+
+    /**
+      * Write all the events recorded so far in the report file (Chrome
+      * trace event format). Does nothing if profiling is disabled.
+      * This is called at the end of function::codegen.
+      */
+    static void write_report();
+
+    /**
+      * Return the peak RSS of the process in kilobytes.
+      */
+    static long get_peak_rss_kb();
+
+private:
+    static bool enabled;
+    static bool environment_checked;
+    static std::string report_file_name;
+    static std::vector<event> events;
+    static std::chrono::steady_clock::time_point origin;
+
+    static void record(const event &e);
+};
+
+}
+
+#endif
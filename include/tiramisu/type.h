@@ -138,6 +138,17 @@ enum argument_t
     a_temporary
 };
 
+/**
+  * How the last, partial vector of a vectorized loop is handled
+  * (see computation::vectorize()).
+  */
+enum class vector_tail_t
+{
+    separate, // Split the loop into a vectorized loop over full vectors and a scalar remainder loop.
+    masked,   // A single vectorized loop; the loads and stores of the last vector are masked.
+    padded    // A single vectorized loop that computes full vectors (the buffers must be padded).
+};
+
 /**
   * Types of ranks in a distributed communication
   * "r_" stands for rank.
@@ -1,6 +1,8 @@
 #include <tiramisu/auto_scheduler/ast.h>
 #include <tiramisu/auto_scheduler/evaluator.h>
 
+#include <algorithm>
+
 namespace tiramisu::auto_scheduler
 {
 
@@ -248,6 +250,22 @@ void syntax_tree::transform_ast(optimization_info const& opt)
             transform_ast_by_unrolling(opt);
             break;
             
+        case optimization_type::VECTORIZATION:
+            transform_ast_by_vectorization(opt);
+            break;
+            
+        case optimization_type::PARALLELIZATION:
+            transform_ast_by_parallelization(opt);
+            break;
+            
+        case optimization_type::SKEWING:
+            transform_ast_by_skewing(opt);
+            break;
+            
+        case optimization_type::SHIFTING:
+            transform_ast_by_shifting(opt);
+            break;
+            
         default:
             break;
     }
@@ -492,6 +510,99 @@ void syntax_tree::transform_ast_by_unrolling(optimization_info const& opt)
     }
 }
 
+void syntax_tree::transform_ast_by_vectorization(optimization_info const& opt)
+{
+    std::vector<ast_node*> nodes_list;
+    
+    // Apply vectorization on the node provided by opt
+    if (opt.l0 != -1)
+        nodes_list = {opt.node};
+        
+    // Apply vectorization on every innermost loop level
+    else
+        nodes_list = get_innermost_nodes();
+    
+    for (ast_node *node : nodes_list)
+    {
+        if (node->get_extent() <= opt.l0_fact)
+            node->vectorized = true;
+            
+        else 
+        {
+            // Create the new loop structure
+            ast_node *i_outer = node;
+            ast_node *i_inner = new ast_node();
+            
+            // Chain the nodes
+            i_inner->computations = i_outer->computations;
+            i_inner->children = i_outer->children;
+            
+            for (ast_node *child : i_inner->children)
+                child->parent = i_inner;
+            
+            i_outer->computations.clear();
+            i_outer->children.clear();
+            i_outer->children.push_back(i_inner);
+            
+            i_inner->parent = i_outer;
+            
+            // Location of computations have changed, update computations_mapping
+            for (computation_info& comp_info : i_inner->computations)
+            {
+                computations_mapping[comp_info.comp_ptr] = i_inner;
+            }
+            
+            // Rename the nodes
+            i_inner->name = i_outer->name + "_inner";
+            i_outer->name = i_outer->name + "_outer";
+            
+            // Set lower and upper bounds
+            i_outer->low_bound = 0;
+            i_outer->up_bound = i_outer->get_extent() / opt.l0_fact - 1;
+            
+            i_inner->low_bound = 0;
+            i_inner->up_bound = opt.l0_fact - 1;
+            
+            // Finalize vectorization
+            i_inner->vectorized = true;
+            i_inner->update_depth(i_outer->depth + 1);
+        }
+    }
+}
+
+void syntax_tree::transform_ast_by_parallelization(optimization_info const& opt)
+{
+    opt.node->parallelized = true;
+}
+
+void syntax_tree::transform_ast_by_skewing(optimization_info const& opt)
+{
+    ast_node *i_node = opt.node;
+    ast_node *j_node = i_node->children[0];
+    
+    // The outer loop level becomes a*i + b*j.
+    // The inner loop level keeps its extent, which is an upper bound
+    // of the extent of the new inner loop.
+    int j_low = opt.l1_fact * j_node->low_bound;
+    int j_up = opt.l1_fact * j_node->up_bound;
+    
+    i_node->low_bound = opt.l0_fact * i_node->low_bound + std::min(j_low, j_up);
+    i_node->up_bound = opt.l0_fact * i_node->up_bound + std::max(j_low, j_up);
+    
+    // Rename the nodes
+    i_node->name = i_node->name + "_skewed";
+    j_node->name = j_node->name + "_skewed";
+}
+
+void syntax_tree::transform_ast_by_shifting(optimization_info const& opt)
+{
+    // The loop level now covers the iterations of the shifted computations
+    if (opt.l0_fact > 0)
+        opt.node->up_bound += opt.l0_fact;
+    else
+        opt.node->low_bound += opt.l0_fact;
+}
+
 syntax_tree* syntax_tree::copy_ast() const
 {
     syntax_tree *ast = new syntax_tree();
@@ -572,6 +683,8 @@ ast_node* ast_node::copy_and_return_node(ast_node *new_node, ast_node *node_to_f
     new_node->low_bound = low_bound;
     new_node->up_bound = up_bound;
     new_node->unrolled = unrolled;
+    new_node->vectorized = vectorized;
+    new_node->parallelized = parallelized;
     new_node->computations = computations;
 
     return ret_node;
@@ -603,6 +716,19 @@ std::vector<optimization_info> syntax_tree::get_schedule() const
     return schedule;
 }
 
+bool syntax_tree::has_optimization(optimization_type type) const
+{
+    for (optimization_info const& optim_info : previous_optims)
+        if (optim_info.type == type)
+            return true;
+            
+    for (optimization_info const& optim_info : new_optims)
+        if (optim_info.type == type)
+            return true;
+            
+    return false;
+}
+
 void syntax_tree::clear_new_optimizations()
 {
     for (optimization_info const& optim_info : new_optims)
@@ -787,6 +913,120 @@ int ast_node::get_loop_levels_chain_depth() const
     return ret;
 }
 
+/**
+ * Return a textual representation of the given optimization : its type,
+ * the loop levels and the factors it uses, and the names of the computations
+ * it is applied to, in alphabetical order.
+ */
+static std::string represent_optimization(optimization_info const& optim_info)
+{
+    int nb_facts = 0;
+    switch (optim_info.type)
+    {
+        case optimization_type::TILING:
+            nb_facts = optim_info.nb_l;
+            break;
+            
+        case optimization_type::SKEWING:
+            nb_facts = 2;
+            break;
+            
+        case optimization_type::UNROLLING:
+        case optimization_type::VECTORIZATION:
+        case optimization_type::SHIFTING:
+            nb_facts = 1;
+            break;
+            
+        default:
+            break;
+    }
+    
+    int levels[3] = {optim_info.l0, optim_info.l1, optim_info.l2};
+    int facts[3] = {optim_info.l0_fact, optim_info.l1_fact, optim_info.l2_fact};
+    
+    std::string repr = "[" + std::to_string(optim_info.type);
+    
+    for (int i = 0; i < optim_info.nb_l && i < 3; ++i)
+        repr += ",l" + std::to_string(levels[i]);
+        
+    for (int i = 0; i < nb_facts; ++i)
+        repr += ",f" + std::to_string(facts[i]);
+        
+    std::vector<std::string> comps_names;
+    for (tiramisu::computation *comp : optim_info.comps)
+        comps_names.push_back(comp->get_name());
+        
+    std::sort(comps_names.begin(), comps_names.end());
+    for (std::string const& comp_name : comps_names)
+        repr += "," + comp_name;
+        
+    return repr + "]";
+}
+
+uint64_t syntax_tree::get_hash() const
+{
+    std::string repr = fct->get_name() + ";";
+    
+    // Represent the program, so that changing the program changes the hash
+    for (tiramisu::computation *comp : computations_list)
+    {
+        char *domain_str = isl_set_to_str(comp->get_iteration_domain());
+        char *access_str = isl_map_to_str(comp->access);
+        
+        repr += comp->get_name() + ":" + domain_str + ":" + access_str + ":" + comp->get_expr().to_str() + ";";
+        
+        free(domain_str);
+        free(access_str);
+    }
+    
+    // Represent the loop structure, it contains the effect of all the optimizations
+    for (ast_node *root : roots)
+        root->represent_node(repr);
+        
+    // The loop structure does not contain the skewing factors and the shifts,
+    // so also represent the optimizations. They are sorted so that the hash
+    // does not depend on the order in which they were applied.
+    std::vector<std::string> optims_repr;
+    for (optimization_info const& optim_info : get_schedule())
+        optims_repr.push_back(represent_optimization(optim_info));
+        
+    std::sort(optims_repr.begin(), optims_repr.end());
+    for (std::string const& optim_repr : optims_repr)
+        repr += optim_repr;
+        
+    // Use FNV-1a to hash the representation
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : repr)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+    
+    return hash;
+}
+
+void ast_node::represent_node(std::string& repr) const
+{
+    repr += "{" + name + "," + std::to_string(low_bound) + "," + std::to_string(up_bound);
+    
+    if (unrolled)
+        repr += ",unrolled";
+        
+    if (vectorized)
+        repr += ",vectorized";
+        
+    if (parallelized)
+        repr += ",parallelized";
+        
+    for (computation_info const& comp_info : computations)
+        repr += "," + comp_info.comp_ptr->get_name();
+        
+    for (ast_node *child : children)
+        child->represent_node(repr);
+        
+    repr += "}";
+}
+
 void syntax_tree::print_ast() const
 {
     for (ast_node *root : roots)
@@ -800,7 +1040,7 @@ void ast_node::print_node() const
         for (int i = 0; i < depth; ++i)
             std::cout << "\t";
             
-        std::cout << "for " << low_bound << " <= " << name << " < " << up_bound + 1 << " | " << unrolled << std::endl;
+        std::cout << "for " << low_bound << " <= " << name << " < " << up_bound + 1 << " | " << unrolled << " " << vectorized << " " << parallelized << std::endl;
     }
     
     for (computation_info const& comp_info : computations) 
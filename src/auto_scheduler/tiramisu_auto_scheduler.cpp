@@ -50,7 +50,13 @@ void auto_scheduler::apply_best_schedule()
     // to apply the best schedule.
     if (exec_evaluator != nullptr)
     {
+        // Bypass the cache, as the program must be compiled with the best schedule
+        evaluation_cache *cache = exec_evaluator->get_cache();
+        exec_evaluator->set_cache(nullptr);
+        
         float best_sched_exec_time = exec_evaluator->evaluate(*best_ast);
+        exec_evaluator->set_cache(cache);
+        
         std::cout << "Best schedule exec time : " << best_sched_exec_time << std::endl;
         std::cout << "Speedup : " << initial_exec_time / best_sched_exec_time << std::endl;
     }
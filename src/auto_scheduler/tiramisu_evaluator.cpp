@@ -1,16 +1,103 @@
 #include <tiramisu/auto_scheduler/evaluator.h>
+#include <tiramisu/utils.h>
 
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/file.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cfloat>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <chrono>
 
 namespace tiramisu::auto_scheduler
 {
 
+evaluation_cache::evaluation_cache(std::string const& filename)
+{
+    // The file can be shared by several autotuning processes : records are
+    // appended with O_APPEND, one write per record, under an exclusive lock.
+    cache_fd = open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (cache_fd < 0)
+        ERROR("Cannot open the evaluation cache " + filename, true);
+        
+    flock(cache_fd, LOCK_EX);
+    
+    // Load the evaluations already stored in the file
+    char record[record_size];
+    off_t file_size = 0;
+    
+    while (pread(cache_fd, record, record_size, file_size) == record_size)
+    {
+        uint64_t hash;
+        float evaluation;
+        
+        std::memcpy(&hash, record, sizeof(hash));
+        std::memcpy(&evaluation, record + sizeof(hash), sizeof(evaluation));
+        
+        evaluations[hash] = evaluation;
+        file_size += record_size;
+    }
+    
+    // Drop the incomplete record left by an interrupted process, so that
+    // the next records stay aligned
+    if (lseek(cache_fd, 0, SEEK_END) != file_size)
+        ftruncate(cache_fd, file_size);
+        
+    flock(cache_fd, LOCK_UN);
+}
+
+evaluation_cache::~evaluation_cache()
+{
+    close(cache_fd);
+}
+
+bool evaluation_cache::find(syntax_tree const& ast, float& evaluation) const
+{
+    auto it = evaluations.find(ast.get_hash());
+    if (it == evaluations.end())
+        return false;
+        
+    evaluation = it->second;
+    return true;
+}
+
+void evaluation_cache::insert(syntax_tree const& ast, float evaluation)
+{
+    uint64_t hash = ast.get_hash();
+    evaluations[hash] = evaluation;
+    
+    // Write the evaluation now, so that it is kept even if the search is interrupted
+    char record[record_size];
+    std::memcpy(record, &hash, sizeof(hash));
+    std::memcpy(record + sizeof(hash), &evaluation, sizeof(evaluation));
+    
+    flock(cache_fd, LOCK_EX);
+    ssize_t written;
+    do
+        written = write(cache_fd, record, record_size);
+    while (written < 0 && errno == EINTR);
+    flock(cache_fd, LOCK_UN);
+}
+
+// ------------------------------------------------------------------------------------------ //
+
+std::vector<float> evaluation_function::evaluate_batch(std::vector<syntax_tree*> const& asts)
+{
+    std::vector<float> evals;
+    
+    for (syntax_tree *ast : asts)
+        evals.push_back(evaluate(*ast));
+        
+    return evals;
+}
+
 evaluate_by_execution::evaluate_by_execution(std::vector<tiramisu::buffer*> const& arguments, 
                                              std::string const& obj_filename, 
                                              std::string const& wrapper_cmd,
@@ -35,22 +122,46 @@ evaluate_by_execution::evaluate_by_execution(std::vector<tiramisu::buffer*> cons
     }
 }
 
-float evaluate_by_execution::evaluate(syntax_tree& ast)
+Halide::Module evaluate_by_execution::lower_to_halide_module(syntax_tree& ast, Halide::Target const& target)
 {
     // Apply all the optimizations
     apply_optimizations(ast);
-    parallelize_outermost_levels(ast.computations_list);
     
-    // Compile the program to an object file
+    // If the schedule does not specify which loop levels to parallelize,
+    // parallelize the outermost loop levels.
+    if (!ast.has_optimization(optimization_type::PARALLELIZATION))
+        parallelize_outermost_levels(ast.computations_list);
+    
+    // Generate the Halide statement of the program and lower it
     fct->lift_dist_comps();
     fct->gen_time_space_domain();
     fct->gen_isl_ast();
     fct->gen_halide_stmt();
     
-    Halide::Module m = lower_halide_pipeline(fct->get_name(), halide_target, halide_arguments,
-                                             Halide::Internal::LoweredFunc::External,
-                                             fct->get_halide_stmt());
-                                             
+    return lower_halide_pipeline(fct->get_name(), target, halide_arguments,
+                                 Halide::Internal::LoweredFunc::External,
+                                 fct->get_halide_stmt());
+}
+
+float evaluate_by_execution::run_wrapper()
+{
+    double exec_time = 0.f;
+    FILE *pipe = popen(wrapper_cmd.c_str(), "r");
+    
+    fscanf(pipe, "%lf", &exec_time);
+    pclose(pipe);
+    
+    return exec_time;
+}
+
+float evaluate_by_execution::evaluate(syntax_tree& ast)
+{
+    float exec_time;
+    if (cache != nullptr && cache->find(ast, exec_time))
+        return exec_time;
+        
+    // Compile the program to an object file
+    Halide::Module m = lower_to_halide_module(ast, halide_target);
     m.compile(Halide::Outputs().object(obj_filename));
     
     // Turn the object file to a shared library
@@ -58,15 +169,228 @@ float evaluate_by_execution::evaluate(syntax_tree& ast)
     int status = system(gcc_cmd.c_str());
     
     // Execute the wrapper and get execution time
-    double exec_time = 0.f;
-    FILE *pipe = popen(wrapper_cmd.c_str(), "r");
+    exec_time = run_wrapper();
     
-    fscanf(pipe, "%lf", &exec_time);
-    pclose(pipe);
+    // Remove all the optimizations
+    fct->reset_schedules();
+    
+    if (cache != nullptr)
+        cache->insert(ast, exec_time);
+        
+    return exec_time;
+}
+
+std::vector<float> evaluate_by_execution::evaluate_batch(std::vector<syntax_tree*> const& asts)
+{
+    if (nb_compile_workers <= 1)
+        return evaluation_function::evaluate_batch(asts);
+        
+    std::vector<float> evals(asts.size(), FLT_MAX);
+    std::vector<bool> cached(asts.size(), false);
+    std::vector<bool> compiled(asts.size(), false);
+    std::unordered_map<pid_t, int> workers;
+    
+    // Wait for a worker to finish, and record whether its schedule was compiled.
+    // Only the workers started here are waited for, so that the children of
+    // other parts of the program are not reaped.
+    auto wait_worker = [&]() {
+        while (!workers.empty())
+        {
+            // Collect a worker that already finished, or block on one of them
+            pid_t pid = 0;
+            int status = 0;
+            
+            for (auto const& worker : workers)
+            {
+                pid = waitpid(worker.first, &status, WNOHANG);
+                if (pid != 0)
+                    break;
+            }
+            
+            if (pid == 0)
+            {
+                pid = workers.begin()->first;
+                pid = waitpid(pid, &status, 0);
+            }
+            
+            if (pid > 0)
+            {
+                compiled[workers[pid]] = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+                workers.erase(pid);
+                return ;
+            }
+            
+            if (errno == EINTR)
+                continue;
+                
+            // The workers can't be waited for (for example, SIGCHLD is ignored
+            // and the children were reaped automatically) : their schedules
+            // are considered as not compiled.
+            for (auto const& worker : workers)
+                compiled[worker.second] = false;
+                
+            workers.clear();
+        }
+    };
+    
+    // Compile the schedules concurrently.
+    // Each schedule is compiled by a forked process, that applies the schedule
+    // on its own copy of the Tiramisu function. So there is no need to reset
+    // the schedules in this process.
+    std::cout << std::flush;
+    fflush(stdout);
+    
+    for (int i = 0; i < asts.size(); ++i)
+    {
+        // No need to compile schedules that were already evaluated
+        if (cache != nullptr && cache->find(*asts[i], evals[i]))
+        {
+            cached[i] = true;
+            continue;
+        }
+        
+        while (workers.size() >= nb_compile_workers)
+            wait_worker();
+            
+        std::string cand_obj_filename = obj_filename + "." + std::to_string(i);
+        
+        pid_t pid = fork();
+        
+        // If no process can be created, wait for the running workers and retry
+        while (pid < 0 && !workers.empty())
+        {
+            wait_worker();
+            pid = fork();
+        }
+        
+        if (pid < 0)
+        {
+            // Compile the schedule in this process
+            Halide::Module m = lower_to_halide_module(*asts[i], halide_target);
+            m.compile(Halide::Outputs().object(cand_obj_filename));
+            fct->reset_schedules();
+            
+            std::string gcc_cmd = "g++ -shared -o " + cand_obj_filename + ".so " + cand_obj_filename;
+            compiled[i] = system(gcc_cmd.c_str()) == 0;
+        }
+        
+        else if (pid == 0)
+        {
+            Halide::Module m = lower_to_halide_module(*asts[i], halide_target);
+            m.compile(Halide::Outputs().object(cand_obj_filename));
+            
+            std::string gcc_cmd = "g++ -shared -o " + cand_obj_filename + ".so " + cand_obj_filename;
+            int status = system(gcc_cmd.c_str());
+            
+            std::cout << std::flush;
+            _exit(status == 0 ? 0 : 1);
+        }
+        
+        else
+            workers[pid] = i;
+    }
+    
+    while (!workers.empty())
+        wait_worker();
+        
+    // Execute the schedules one by one.
+    // The wrapper is linked against obj_filename.so, so we move the shared
+    // library of each schedule to obj_filename.so before executing the wrapper.
+    for (int i = 0; i < asts.size(); ++i)
+    {
+        if (cached[i])
+            continue;
+            
+        std::string cand_obj_filename = obj_filename + "." + std::to_string(i);
+        
+        if (compiled[i])
+        {
+            std::rename(cand_obj_filename.c_str(), obj_filename.c_str());
+            std::rename((cand_obj_filename + ".so").c_str(), (obj_filename + ".so").c_str());
+            
+            evals[i] = run_wrapper();
+            
+            if (cache != nullptr)
+                cache->insert(*asts[i], evals[i]);
+        }
+        
+        else
+        {
+            std::remove(cand_obj_filename.c_str());
+            std::remove((cand_obj_filename + ".so").c_str());
+        }
+    }
+    
+    return evals;
+}
+
+evaluate_by_jit::evaluate_by_jit(std::vector<tiramisu::buffer*> const& arguments,
+                                 int nb_warmups, int nb_executions,
+                                 tiramisu::function *fct)
+    : evaluate_by_execution(arguments, "", "", fct), 
+      nb_warmups(nb_warmups), nb_executions(nb_executions)
+{
+    // The JIT feature tells Halide to not generate the legacy buffer_t wrapper
+    halide_target = halide_target.with_feature(Halide::Target::JIT);
+    
+    // Allocate the argument buffers once, they are reused by every evaluation.
+    // Halide stores dimensions from innermost to outermost, while Tiramisu
+    // stores them from outermost to innermost.
+    for (tiramisu::buffer *buf : arguments)
+    {
+        if (!buf->has_constant_extents())
+            ERROR("evaluate_by_jit needs buffers with constant extents, " + buf->get_name() + " has symbolic extents.", true);
+            
+        std::vector<int> sizes;
+        std::vector<tiramisu::expr> const& dim_sizes = buf->get_dim_sizes();
+        
+        for (int i = dim_sizes.size() - 1; i >= 0; --i)
+            sizes.push_back(dim_sizes[i].get_int_val());
+            
+        Halide::Buffer<> halide_buf(halide_type_from_tiramisu_type(buf->get_elements_type()), sizes, buf->get_name());
+        
+        // Avoid timing computations on denormals or NaNs
+        memset(halide_buf.data(), 0, halide_buf.size_in_bytes());
+        arguments_buffers.push_back(halide_buf);
+    }
+    
+    for (Halide::Buffer<>& halide_buf : arguments_buffers)
+        arguments_ptrs.push_back(halide_buf.raw_buffer());
+}
+
+float evaluate_by_jit::evaluate(syntax_tree& ast)
+{
+    float exec_time;
+    if (cache != nullptr && cache->find(ast, exec_time))
+        return exec_time;
+        
+    // Compile the program in memory
+    Halide::Module m = lower_to_halide_module(ast, halide_target);
+    
+    Halide::Internal::JITModule jit_module(m, m.functions().back());
+    int (*fct_ptr)(const void**) = jit_module.argv_function();
+    
+    // Execute the program and get its execution time
+    for (int i = 0; i < nb_warmups; ++i)
+        fct_ptr(arguments_ptrs.data());
+        
+    std::vector<std::chrono::duration<double, std::milli>> durations;
+    for (int i = 0; i < nb_executions; ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        fct_ptr(arguments_ptrs.data());
+        auto end = std::chrono::high_resolution_clock::now();
+        
+        durations.push_back(end - start);
+    }
     
     // Remove all the optimizations
     fct->reset_schedules();
     
+    exec_time = median(durations);
+    if (cache != nullptr)
+        cache->insert(ast, exec_time);
+        
     return exec_time;
 }
 
@@ -117,20 +441,180 @@ evaluate_by_learning_model::evaluate_by_learning_model(std::string const& cmd_pa
 
 float evaluate_by_learning_model::evaluate(syntax_tree& ast)
 {
-    // Get JSON representations for the program, and for the schedule
-    std::string prog_json = get_program_json(ast);
-    std::string sched_json = get_schedule_json(ast);
+    return evaluate_batch({&ast})[0];
+}
+
+std::vector<float> evaluate_by_learning_model::evaluate_batch(std::vector<syntax_tree*> const& asts)
+{
+    std::vector<float> evals(asts.size(), 0.f);
+    std::vector<int> to_evaluate;
     
-    // Write the program JSON and the schedule JSON to model_write
-    fputs(prog_json.c_str(), model_write);
-    fputs(sched_json.c_str(), model_write);
+    for (int i = 0; i < asts.size(); ++i)
+        if (cache == nullptr || !cache->find(*asts[i], evals[i]))
+            to_evaluate.push_back(i);
+            
+    if (to_evaluate.empty())
+        return evals;
+        
+    // The program is sent only once, schedules refer to it
+    if (asts[0]->fct != program_sent)
+        write_program(*asts[0]);
+        
+    // The schedules of a search step mostly share a few tree structures :
+    // each distinct tree structure is sent once, and schedules refer to it by index.
+    std::vector<std::string const*> tree_structures;
+    std::unordered_map<std::string, int32_t> tree_indices;
+    std::vector<int32_t> schedule_trees;
+    
+    for (int i : to_evaluate)
+    {
+        std::string const& tree_structure = asts[i]->tree_structure_json;
+        auto it = tree_indices.find(tree_structure);
+        
+        if (it == tree_indices.end())
+        {
+            it = tree_indices.insert({tree_structure, (int32_t)tree_structures.size()}).first;
+            tree_structures.push_back(&it->first);
+        }
+        
+        schedule_trees.push_back(it->second);
+    }
+    
+    // Send all the schedules in one frame
+    int32_t header[3] = {SCHEDULES_FRAME, (int32_t)to_evaluate.size(), (int32_t)tree_structures.size()};
+    fwrite(header, sizeof(int32_t), 3, model_write);
+    
+    for (std::string const* tree_structure : tree_structures)
+    {
+        int32_t size = tree_structure->size();
+        fwrite(&size, sizeof(int32_t), 1, model_write);
+        fwrite(tree_structure->data(), 1, size, model_write);
+    }
+    
+    for (int i = 0; i < to_evaluate.size(); ++i)
+        write_schedule(*asts[to_evaluate[i]], schedule_trees[i]);
+        
     fflush(model_write);
     
-    // Read the evaluation from model_read.
-    float speedup = 0.f;
-    fscanf(model_read, "%f", &speedup);
+    // Read the evaluations from model_read.
+    int32_t nb_evals = 0;
+    fread(&nb_evals, sizeof(int32_t), 1, model_read);
+    
+    if (nb_evals != to_evaluate.size())
+        ERROR("The model returned " + std::to_string(nb_evals) + " evaluations instead of " + std::to_string(to_evaluate.size()), true);
+        
+    std::vector<float> speedups(nb_evals);
+    fread(speedups.data(), sizeof(float), nb_evals, model_read);
+    
+    for (int i = 0; i < to_evaluate.size(); ++i)
+    {
+        evals[to_evaluate[i]] = -speedups[i];
+        
+        if (cache != nullptr)
+            cache->insert(*asts[to_evaluate[i]], -speedups[i]);
+    }
+    
+    return evals;
+}
+
+void evaluate_by_learning_model::write_program(syntax_tree const& ast)
+{
+    std::string prog_json = get_program_json(ast);
+    
+    int32_t header[2] = {PROGRAM_FRAME, (int32_t)prog_json.size()};
+    fwrite(header, sizeof(int32_t), 2, model_write);
+    fwrite(prog_json.data(), 1, prog_json.size(), model_write);
+    
+    program_sent = ast.fct;
+}
+
+void evaluate_by_learning_model::write_schedule(syntax_tree const& ast, int32_t tree_index)
+{
+    int32_t unfuse_l0 = -1;
+    int32_t int_l0 = -1, int_l1 = -1;
+    int32_t tile_nb_l = 0, tile_l0 = -1;
+    int32_t tile_facts[3] = {0, 0, 0};
+    int32_t unrolling_fact = 0;
+    int32_t par_l0 = -1;
+    int32_t vector_width = 0;
+    int32_t skew_l0 = -1;
+    int32_t skew_facts[2] = {0, 0};
+    std::vector<int32_t> shiftings;
+    
+    // Computations are identified by their absolute order in the JSON of the program
+    std::vector<tiramisu::computation*> comps_order;
+    for (ast_node *root : ast.roots)
+        root->get_all_computations(comps_order);
+    
+    // Get information about the schedule, as in get_schedule_json()
+    for (optimization_info const& optim_info : ast.new_optims)
+    {
+        switch (optim_info.type)
+        {
+            case optimization_type::UNFUSE:
+                unfuse_l0 = optim_info.l0;
+                break;
+                
+            case optimization_type::TILING:
+                tile_nb_l = optim_info.nb_l;
+                tile_l0 = optim_info.l0;
+                tile_facts[0] = optim_info.l0_fact;
+                tile_facts[1] = optim_info.l1_fact;
+                tile_facts[2] = optim_info.nb_l == 3 ? optim_info.l2_fact : 0;
+                break;
+                
+            case optimization_type::INTERCHANGE:
+                int_l0 = optim_info.l0;
+                int_l1 = optim_info.l1;
+                break;
+                
+            case optimization_type::UNROLLING:
+                unrolling_fact = optim_info.l0_fact;
+                break;
+                
+            case optimization_type::PARALLELIZATION:
+                par_l0 = optim_info.l0;
+                break;
+                
+            case optimization_type::VECTORIZATION:
+                vector_width = optim_info.l0_fact;
+                break;
+                
+            case optimization_type::SKEWING:
+                skew_l0 = optim_info.l0;
+                skew_facts[0] = optim_info.l0_fact;
+                skew_facts[1] = optim_info.l1_fact;
+                break;
+                
+            case optimization_type::SHIFTING:
+                for (tiramisu::computation *comp : optim_info.comps)
+                {
+                    int32_t comp_order = std::find(comps_order.begin(), comps_order.end(), comp) - comps_order.begin() + 1;
+                    shiftings.insert(shiftings.end(), {comp_order, optim_info.l0, optim_info.l0_fact});
+                }
+                break;
+                
+            default:
+                break;
+        }
+    }
+    
+    int32_t record[15] = {
+        unfuse_l0, 
+        int_l0, int_l1, 
+        tile_nb_l, tile_l0, tile_facts[0], tile_facts[1], tile_facts[2],
+        unrolling_fact,
+        par_l0,
+        vector_width,
+        skew_l0, skew_facts[0], skew_facts[1],
+        tree_index
+    };
+    
+    fwrite(record, sizeof(int32_t), 15, model_write);
     
-    return -speedup;
+    int32_t nb_shiftings = shiftings.size() / 3;
+    fwrite(&nb_shiftings, sizeof(int32_t), 1, model_write);
+    fwrite(shiftings.data(), sizeof(int32_t), shiftings.size(), model_write);
 }
 
 std::string evaluate_by_learning_model::get_program_json(syntax_tree const& ast)
@@ -249,11 +733,17 @@ std::string evaluate_by_learning_model::get_schedule_json(syntax_tree const& ast
     bool interchanged = false;
     bool tiled = false;
     bool unrolled = false;
+    bool vectorized = false;
+    bool skewed = false;
     
     int unfuse_l0 = -1;
     int int_l0, int_l1;
     int tile_nb_l, tile_l0, tile_l0_fact, tile_l1_fact, tile_l2_fact;
     int unrolling_fact;
+    int par_l0 = -1;
+    int vector_width;
+    int skew_l0, skew_l0_fact, skew_l1_fact;
+    std::unordered_map<tiramisu::computation*, std::vector<std::pair<int, int>>> shiftings;
     
     // Get information about the schedule
     for (optimization_info const& optim_info : ast.new_optims)
@@ -295,6 +785,27 @@ std::string evaluate_by_learning_model::get_schedule_json(syntax_tree const& ast
                 unrolling_fact = optim_info.l0_fact;
                 break;
                 
+            case optimization_type::PARALLELIZATION:
+                par_l0 = optim_info.l0;
+                break;
+                
+            case optimization_type::VECTORIZATION:
+                vectorized = true;
+                vector_width = optim_info.l0_fact;
+                break;
+                
+            case optimization_type::SKEWING:
+                skewed = true;
+                skew_l0 = optim_info.l0;
+                skew_l0_fact = optim_info.l0_fact;
+                skew_l1_fact = optim_info.l1_fact;
+                break;
+                
+            case optimization_type::SHIFTING:
+                for (tiramisu::computation *comp : optim_info.comps)
+                    shiftings[comp].push_back(std::make_pair(optim_info.l0, optim_info.l0_fact));
+                break;
+                
             default:
                 break;
         }
@@ -378,6 +889,57 @@ std::string evaluate_by_learning_model::get_schedule_json(syntax_tree const& ast
             comp_sched_json += "null";
         }
         
+        comp_sched_json += ",";
+        
+        // JSON for parallelization
+        comp_sched_json += "\"parallelized_dim\" : ";
+        
+        if (par_l0 != -1)
+            comp_sched_json += "\"" + iterators_list[par_l0].name + "\"";
+        else
+            comp_sched_json += "null";
+            
+        comp_sched_json += ",";
+        
+        // JSON for vectorization
+        comp_sched_json += "\"vectorization_factor\" : ";
+        
+        if (vectorized)
+            comp_sched_json += "\"" + std::to_string(vector_width) + "\"";
+        else
+            comp_sched_json += "null";
+            
+        comp_sched_json += ",";
+        
+        // JSON for skewing
+        comp_sched_json += "\"skewing\" : {";
+        
+        if (skewed)
+        {
+            comp_sched_json += "\"skewed_dims\" : [";
+            comp_sched_json += "\"" + iterators_list[skew_l0].name + "\", " + "\"" + iterators_list[skew_l0 + 1].name + "\"";
+            comp_sched_json += "],";
+            
+            comp_sched_json += "\"skewing_factors\" : [";
+            comp_sched_json += "\"" + std::to_string(skew_l0_fact) + "\", " + "\"" + std::to_string(skew_l1_fact) + "\"";
+            comp_sched_json += "]";
+        }
+        
+        comp_sched_json += "},";
+        
+        // JSON for shifting
+        comp_sched_json += "\"shiftings\" : [";
+        
+        std::vector<std::pair<int, int>> const& comp_shiftings = shiftings[comp];
+        for (int i = 0; i < comp_shiftings.size(); ++i)
+        {
+            comp_sched_json += "[\"" + iterators_list[comp_shiftings[i].first].name + "\", \"" + std::to_string(comp_shiftings[i].second) + "\"]";
+            if (i != comp_shiftings.size() - 1)
+                comp_sched_json += ",";
+        }
+        
+        comp_sched_json += "]";
+        
         sched_json += "\"" + comp->get_name() + "\" : {" + comp_sched_json + "},";
     }
     
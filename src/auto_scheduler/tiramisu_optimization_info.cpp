@@ -24,6 +24,19 @@ void unroll_innermost_levels(std::vector<tiramisu::computation*> const& comps_li
         comps_list[i]->unroll(innermost_indices[i], unroll_fact);
 }
 
+void vectorize_innermost_levels(std::vector<tiramisu::computation*> const& comps_list, int vector_width)
+{
+    std::vector<int> innermost_indices; 
+    
+    // For each computation, get the indice of its innermost loop level.
+    for (tiramisu::computation *comp : comps_list)
+        innermost_indices.push_back(comp->get_loop_levels_number() - 1);
+                
+    // Apply vectorization to innermost loop levels.
+    for (int i = 0; i < innermost_indices.size(); ++i)
+        comps_list[i]->vectorize(innermost_indices[i], vector_width);
+}
+
 void apply_optimizations(syntax_tree const& ast)
 {
     // Check ast.h for the difference between ast.previous_optims and ast.new_optims
@@ -68,6 +81,29 @@ void apply_optimizations(optimization_info const& optim_info)
             else
                 unroll_innermost_levels(optim_info.comps, optim_info.l0_fact);
             break;
+            
+        case optimization_type::VECTORIZATION:
+            // Apply vectorization on the level indicated by l0
+            if (optim_info.l0 != -1)
+                block.vectorize(optim_info.l0, optim_info.l0_fact);
+                
+            // Apply vectorization on all innermost levels
+            else
+                vectorize_innermost_levels(optim_info.comps, optim_info.l0_fact);
+            break;
+            
+        case optimization_type::PARALLELIZATION:
+            for (tiramisu::computation *comp : optim_info.comps)
+                comp->tag_parallel_level(optim_info.l0);
+            break;
+            
+        case optimization_type::SKEWING:
+            block.skew(optim_info.l0, optim_info.l1, optim_info.l0_fact, optim_info.l1_fact);
+            break;
+            
+        case optimization_type::SHIFTING:
+            block.shift(optim_info.l0, optim_info.l0_fact);
+            break;
                 
         default:
             break;
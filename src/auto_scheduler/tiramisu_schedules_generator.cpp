@@ -1,9 +1,235 @@
 #include <tiramisu/auto_scheduler/schedules_generator.h>
 #include <tiramisu/auto_scheduler/evaluator.h>
+#include <algorithm>
 
 namespace tiramisu::auto_scheduler
 {
 
+void schedules_generator::compute_dependences(syntax_tree const& ast)
+{
+    if (analyzed_fct == ast.fct)
+        return ;
+        
+    // Dependences are computed on the original order of the computations
+    ast.fct->reset_schedules();
+    apply_fusions(ast);
+    ast.fct->performe_full_dependency_analysis();
+    ast.fct->reset_schedules();
+    
+    analyzed_fct = ast.fct;
+}
+
+/**
+ * Fill nodes with the parallelized loop levels of the subtree rooted at the given node.
+ */
+static void get_parallelized_nodes(ast_node *node, std::vector<ast_node*>& nodes)
+{
+    if (node->parallelized)
+        nodes.push_back(node);
+        
+    for (ast_node *child : node->children)
+        get_parallelized_nodes(child, nodes);
+}
+
+/**
+ * Return true if the loop levels of the AST still have the names of the iterators
+ * of the computations. This is needed by the queries of the dependence analysis,
+ * that take loop levels as tiramisu::var.
+ */
+static bool loop_levels_have_original_names(syntax_tree const& ast)
+{
+    return !ast.has_optimization(optimization_type::TILING) &&
+           !ast.has_optimization(optimization_type::UNROLLING) &&
+           !ast.has_optimization(optimization_type::VECTORIZATION) &&
+           !ast.has_optimization(optimization_type::SKEWING);
+}
+
+bool schedules_generator::is_legal(syntax_tree const& ast)
+{
+    tiramisu::function *fct = ast.fct;
+    
+    fct->reset_schedules();
+    apply_optimizations(ast);
+    fct->prepare_schedules_for_legality_checks();
+    
+    bool legal = fct->check_legality_for_function();
+    
+    std::vector<ast_node*> parallelized_nodes;
+    for (ast_node *root : ast.roots)
+        get_parallelized_nodes(root, parallelized_nodes);
+    
+    // Check that the parallelized loop levels can be parallelized
+    for (int i = 0; legal && i < parallelized_nodes.size(); ++i)
+    {
+        std::vector<tiramisu::computation*> comps;
+        parallelized_nodes[i]->get_all_computations(comps);
+        
+        legal = fct->loop_parallelization_is_legal(parallelized_nodes[i]->depth, comps);
+    }
+    
+    // If no loop level is parallelized, evaluation functions parallelize the
+    // outermost loop level of each loop nest.
+    for (int i = 0; legal && parallelized_nodes.empty() && i < ast.roots.size(); ++i)
+    {
+        std::vector<tiramisu::computation*> comps;
+        ast.roots[i]->get_all_computations(comps);
+        
+        if (!comps.empty())
+            legal = fct->loop_parallelization_is_legal(0, comps);
+    }
+    
+    fct->reset_schedules();
+    return legal;
+}
+
+void schedules_generator::prune_illegal_schedules(syntax_tree const& ast, std::vector<syntax_tree*>& states)
+{
+    compute_dependences(ast);
+    
+    std::vector<syntax_tree*> legal_states;
+    for (syntax_tree *state : states)
+    {
+        // Generated ASTs are transformed later by search methods, so we check
+        // a transformed copy of each AST.
+        optimization_info& last_optim = state->new_optims.back();
+        
+        // Optimizations applied to all innermost levels have no node,
+        // the other ones can't be transformed without it.
+        bool on_innermost_levels = (last_optim.type == optimization_type::UNROLLING ||
+                                    last_optim.type == optimization_type::VECTORIZATION) &&
+                                   last_optim.l0 == -1;
+                                   
+        if (last_optim.node == nullptr && !on_innermost_levels)
+        {
+            legal_states.push_back(state);
+            continue;
+        }
+        
+        syntax_tree checked_ast;
+        ast_node *node = state->copy_and_return_node(checked_ast, last_optim.node);
+        
+        checked_ast.new_optims.back().node = node;
+        checked_ast.transform_ast();
+        
+        if (is_legal(checked_ast))
+            legal_states.push_back(state);
+        else
+            delete state;
+    }
+    
+    states = legal_states;
+}
+
+void schedules_generator::prepare_dependence_queries(syntax_tree const& ast)
+{
+    ast.fct->reset_schedules();
+    apply_optimizations(ast);
+    ast.fct->prepare_schedules_for_legality_checks();
+}
+
+void schedules_generator::generate_skewings(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast)
+{
+    if (node->children.size() != 1 || !node->computations.empty())
+        return ;
+        
+    ast_node *inner_node = node->children[0];
+    if (node->get_extent() <= 1 || inner_node->get_extent() <= 1 ||
+        inner_node->unrolled || inner_node->vectorized)
+        return ;
+        
+    if (!loop_levels_have_original_names(ast))
+        return ;
+        
+    std::vector<tiramisu::computation*> comps;
+    node->get_all_computations(comps);
+    
+    compute_dependences(ast);
+    prepare_dependence_queries(ast);
+    
+    auto solutions = ast.fct->skewing_local_solver(comps, tiramisu::var(node->name), 
+                                                   tiramisu::var(inner_node->name), 1);
+    ast.fct->reset_schedules();
+    
+    // Solutions that parallelize the outer level, the inner level, and that improve locality
+    std::vector<std::pair<int, int>> factors_list = std::get<0>(solutions);
+    factors_list.insert(factors_list.end(), std::get<1>(solutions).begin(), std::get<1>(solutions).end());
+    factors_list.insert(factors_list.end(), std::get<2>(solutions).begin(), std::get<2>(solutions).end());
+    
+    std::sort(factors_list.begin(), factors_list.end());
+    factors_list.erase(std::unique(factors_list.begin(), factors_list.end()), factors_list.end());
+    
+    for (std::pair<int, int> const& factors : factors_list)
+    {
+        // Copy the AST, and add skewing to the list of optimizations
+        syntax_tree *new_ast = new syntax_tree();
+        ast_node *new_node = ast.copy_and_return_node(*new_ast, node);
+        
+        optimization_info optim_info;
+        optim_info.type = optimization_type::SKEWING;
+        optim_info.node = new_node;
+        
+        optim_info.nb_l = 2;
+        optim_info.l0 = node->depth;
+        optim_info.l1 = node->depth + 1;
+        
+        optim_info.l0_fact = factors.first;
+        optim_info.l1_fact = factors.second;
+        
+        new_node->get_all_computations(optim_info.comps);
+        
+        new_ast->new_optims.push_back(optim_info);
+        states.push_back(new_ast);
+    }
+}
+
+void schedules_generator::generate_shiftings(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast)
+{
+    if (node->get_extent() <= 1 || node->unrolled || node->vectorized)
+        return ;
+        
+    std::vector<tiramisu::computation*> comps;
+    node->get_all_computations(comps);
+    
+    if (comps.size() <= 1 || !loop_levels_have_original_names(ast))
+        return ;
+        
+    compute_dependences(ast);
+    prepare_dependence_queries(ast);
+    
+    std::vector<std::pair<tiramisu::computation*, int>> shifts;
+    for (int i = 1; i < comps.size(); ++i)
+    {
+        std::vector<tiramisu::computation*> previous_comps(comps.begin(), comps.begin() + i);
+        auto shifts_list = ast.fct->correcting_loop_fusion_with_shifting(previous_comps, *comps[i], {tiramisu::var(node->name)});
+        
+        // An empty list means that the fusion is impossible,
+        // and a shift of 0 means that it does not need shifting.
+        if (!shifts_list.empty() && std::get<1>(shifts_list[0]) != 0)
+            shifts.push_back(std::make_pair(comps[i], std::get<1>(shifts_list[0])));
+    }
+    
+    ast.fct->reset_schedules();
+    
+    for (std::pair<tiramisu::computation*, int> const& shift : shifts)
+    {
+        // Copy the AST, and add shifting to the list of optimizations
+        syntax_tree *new_ast = new syntax_tree();
+        ast_node *new_node = ast.copy_and_return_node(*new_ast, node);
+        
+        optimization_info optim_info;
+        optim_info.type = optimization_type::SHIFTING;
+        optim_info.node = new_node;
+        
+        optim_info.nb_l = 1;
+        optim_info.l0 = node->depth;
+        optim_info.l0_fact = shift.second;
+        optim_info.comps = {shift.first};
+        
+        new_ast->new_optims.push_back(optim_info);
+        states.push_back(new_ast);
+    }
+}
+
 std::vector<syntax_tree*> exhaustive_generator::generate_schedules(syntax_tree const& ast, optimization_type optim)
 {
     std::vector<syntax_tree*> states;
@@ -31,11 +257,40 @@ std::vector<syntax_tree*> exhaustive_generator::generate_schedules(syntax_tree c
                 generate_unrollings(root, states, ast);
                     
             break;
+            
+        case optimization_type::VECTORIZATION:
+            for (ast_node *root : ast.roots)
+                generate_vectorizations(root, states, ast);
+                    
+            break;
+            
+        case optimization_type::PARALLELIZATION:
+            for (ast_node *root : ast.roots)
+                generate_parallelizations(root, states, ast);
+                    
+            break;
+            
+        case optimization_type::SKEWING:
+            for (ast_node *root : ast.roots)
+                for (ast_node *node = root; node->children.size() == 1; node = node->children[0])
+                    generate_skewings(node, states, ast);
+                    
+            break;
+            
+        case optimization_type::SHIFTING:
+            for (ast_node *root : ast.roots)
+                for (ast_node *node = root; node != nullptr; node = node->children.size() == 1 ? node->children[0] : nullptr)
+                    generate_shiftings(node, states, ast);
+                    
+            break;
 
         default:
             break;
     }
     
+    if (check_legality && !states.empty())
+        prune_illegal_schedules(ast, states);
+        
     return states;
 }
 
@@ -187,7 +442,8 @@ void exhaustive_generator::generate_interchanges(ast_node *node, std::vector<syn
 
 void exhaustive_generator::generate_unrollings(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast)
 {
-    if (!node->unrolled && node->get_extent() > 1)
+    // Vectorized loop levels are not unrolled
+    if (!node->unrolled && !node->vectorized && node->get_extent() > 1)
     {
         for (int unrolling_factor : unrolling_factors_list)
         {
@@ -217,6 +473,66 @@ void exhaustive_generator::generate_unrollings(ast_node *node, std::vector<synta
         generate_unrollings(child, states, ast);
 }
 
+void exhaustive_generator::generate_vectorizations(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast)
+{
+    if (node->children.empty() && !node->unrolled && !node->vectorized)
+    {
+        for (int vector_width : vectorization_factors_list)
+        {
+            if (node->get_extent() != vector_width && 
+                !can_split_iterator(node->get_extent(), vector_width))
+                continue;
+                
+            // Copy the AST, and add vectorization to the list of optimizations
+            syntax_tree* new_ast = new syntax_tree();
+            ast_node *new_node = ast.copy_and_return_node(*new_ast, node);
+
+            optimization_info optim_info;
+            optim_info.type = optimization_type::VECTORIZATION;
+            optim_info.node = new_node;
+                
+            optim_info.nb_l = 1;
+            optim_info.l0 = node->depth;
+            optim_info.l0_fact = vector_width;
+            new_node->get_all_computations(optim_info.comps);
+                
+            new_ast->new_optims.push_back(optim_info);
+            states.push_back(new_ast);
+        }
+    }
+    
+    for (ast_node *child : node->children)
+        generate_vectorizations(child, states, ast);
+}
+
+void exhaustive_generator::generate_parallelizations(ast_node *node, std::vector<syntax_tree*>& states, syntax_tree const& ast)
+{
+    // Loop levels inside a parallelized loop level are not parallelized
+    if (node->parallelized)
+        return ;
+        
+    if (!node->unrolled && !node->vectorized && node->get_extent() > 1)
+    {
+        // Copy the AST, and add parallelization to the list of optimizations
+        syntax_tree* new_ast = new syntax_tree();
+        ast_node *new_node = ast.copy_and_return_node(*new_ast, node);
+        
+        optimization_info optim_info;
+        optim_info.type = optimization_type::PARALLELIZATION;
+        optim_info.node = new_node;
+            
+        optim_info.nb_l = 1;
+        optim_info.l0 = node->depth;
+        new_node->get_all_computations(optim_info.comps);
+            
+        new_ast->new_optims.push_back(optim_info);
+        states.push_back(new_ast);
+    }
+    
+    for (ast_node *child : node->children)
+        generate_parallelizations(child, states, ast);
+}
+
 std::vector<syntax_tree*> ml_model_schedules_generator::generate_schedules(syntax_tree const& ast, optimization_type optim)
 {
     // This method generates schedules applied on shared loops, so it does not
@@ -378,6 +694,11 @@ std::vector<syntax_tree*> ml_model_schedules_generator::generate_schedules(synta
 
         case optimization_type::UNROLLING:
             innermost_extents = ast.get_innermost_extents();
+            
+            // Do not unroll loop levels that are already unrolled or vectorized
+            for (ast_node *innermost_node : ast.get_innermost_nodes())
+                if (innermost_node->unrolled || innermost_node->vectorized)
+                    return states;
                
             // Apply all possible unrolling factors to all innermost iterators
             for (int unrolling_fact : unrolling_factors_list)
@@ -411,11 +732,99 @@ std::vector<syntax_tree*> ml_model_schedules_generator::generate_schedules(synta
                 states.push_back(new_ast);
             }
             break;
+            
+        case optimization_type::VECTORIZATION:
+            innermost_extents = ast.get_innermost_extents();
+            
+            // Do not vectorize loop levels that are already unrolled or vectorized
+            for (ast_node *innermost_node : ast.get_innermost_nodes())
+                if (innermost_node->unrolled || innermost_node->vectorized)
+                    return states;
+               
+            // Apply all possible vector widths to all innermost iterators
+            for (int vector_width : vectorization_factors_list)
+            {
+                bool use_factor = true;
+                for (int extent : innermost_extents)
+                {
+                    if (extent != vector_width && !can_split_iterator(extent, vector_width))
+                    {
+                        use_factor = false;
+                        break;
+                    }
+                }
+                
+                if (!use_factor)
+                    continue;
+                    
+                // Copy the AST and add vectorization to the list of optimizations
+                syntax_tree* new_ast = ast.copy_ast();
+
+                optimization_info optim_info;
+                optim_info.type = optimization_type::VECTORIZATION;
+                optim_info.nb_l = 1;
+                
+                // When l0 is set to -1, vectorization is applied to all innermost levels
+                optim_info.l0 = -1;
+                optim_info.l0_fact = vector_width;
+                    
+                optim_info.comps = new_ast->get_innermost_computations();
+                new_ast->new_optims.push_back(optim_info);
+                states.push_back(new_ast);
+            }
+            break;
+            
+        case optimization_type::PARALLELIZATION:
+            // Only one loop level is parallelized
+            if (ast.has_optimization(optimization_type::PARALLELIZATION))
+                return states;
+                
+            shared_levels_extents = ast.get_shared_levels_extents();
+            nb_shared_iterators = std::min((int)shared_levels_extents.size(), max_nb_iterators);
+            
+            for (int i = 0; i < nb_shared_iterators; ++i)
+            {
+                if (!node->unrolled && !node->vectorized && node->get_extent() > 1)
+                {
+                    // Copy the AST and add parallelization to the list of optimizations
+                    syntax_tree* new_ast = new syntax_tree();
+                    ast_node *new_node = ast.copy_and_return_node(*new_ast, node);
+                    
+                    optimization_info optim_info;
+                    optim_info.type = optimization_type::PARALLELIZATION;
+                    optim_info.node = new_node;
+                        
+                    optim_info.nb_l = 1;
+                    optim_info.l0 = node->depth;
+                    new_node->get_all_computations(optim_info.comps);
+                    new_ast->new_optims.push_back(optim_info);
+                    states.push_back(new_ast);
+                }
+                
+                if (node->children.size() > 0)
+                    node = node->children[0];
+            }
+            break;
+            
+        case optimization_type::SKEWING:
+            shared_levels_extents = ast.get_shared_levels_extents();
+            nb_shared_iterators = std::min((int)shared_levels_extents.size(), max_nb_iterators);
+            
+            // Skew each pair of consecutive shared loop levels
+            for (int i = 0; i < nb_shared_iterators - 1; ++i)
+            {
+                generate_skewings(node, states, ast);
+                node = node->children[0];
+            }
+            break;
 
         default:
             break;
     }
     
+    if (check_legality && !states.empty())
+        prune_illegal_schedules(ast, states);
+        
     return states;
 }
 
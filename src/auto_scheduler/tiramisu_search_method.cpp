@@ -6,7 +6,7 @@ namespace tiramisu::auto_scheduler
 
 void beam_search::search(syntax_tree& ast)
 {
-    if (ast.nb_explored_optims % NB_OPTIMIZATIONS == 0)
+    if (ast.nb_explored_optims % optimizations_order.size() == 0)
         ast.clear_new_optimizations();
        
     std::vector<syntax_tree*> children;
@@ -15,9 +15,9 @@ void beam_search::search(syntax_tree& ast)
     int nb_optims_tried = 0;
     int nb_explored_optims = ast.nb_explored_optims;
     
-    while (children.size() == 0 && nb_optims_tried < NB_OPTIMIZATIONS && nb_explored_optims < max_depth)
+    while (children.size() == 0 && nb_optims_tried < optimizations_order.size() && nb_explored_optims < max_depth)
     {
-        optimization_type optim_type = DEFAULT_OPTIMIZATIONS_ORDER[nb_explored_optims % NB_OPTIMIZATIONS];
+        optimization_type optim_type = optimizations_order[nb_explored_optims % optimizations_order.size()];
         children = scheds_gen->generate_schedules(ast, optim_type);
         
         nb_explored_optims++;
@@ -33,8 +33,14 @@ void beam_search::search(syntax_tree& ast)
     {
         child->nb_explored_optims = nb_explored_optims;
         child->transform_ast();
-            
-        child->evaluation = eval_func->evaluate(*child);
+    }
+    
+    std::vector<float> children_evals = eval_func->evaluate_batch(children);
+    
+    for (int i = 0; i < children.size(); ++i)
+    {
+        syntax_tree *child = children[i];
+        child->evaluation = children_evals[i];
         
         child->print_ast();
         std::cout << "Evaluation : " << child->evaluation << std::endl << std::endl;
@@ -89,21 +95,21 @@ void mcts::search(syntax_tree& ast)
         syntax_tree *ast_sample = &ast;
         for (int depth = 0; depth < max_depth; ++depth)
         {
-            optimization_type optim_type = DEFAULT_OPTIMIZATIONS_ORDER[depth % NB_OPTIMIZATIONS];
+            optimization_type optim_type = optimizations_order[depth % optimizations_order.size()];
             children = scheds_gen->generate_schedules(*ast_sample, optim_type);
                         
             if (children.empty())
                 continue;
                 
-            children_evals.clear();
-            
             for (syntax_tree *child : children)
-            {
                 child->transform_ast();
-                    
-                child->evaluation = eval_func->evaluate(*child);
-                children_evals.push_back(child->evaluation);
                 
+            std::vector<float> evals = eval_func->evaluate_batch(children);
+            children_evals.assign(evals.begin(), evals.end());
+            
+            for (int i = 0; i < children.size(); ++i)
+            {
+                children[i]->evaluation = evals[i];
                 nb_explored_schedules++;
             }
             
@@ -165,7 +171,7 @@ void beam_search_topk::search(syntax_tree& ast)
     
 void beam_search_topk::beam_search_subroutine(syntax_tree& ast)
 {
-    if (ast.nb_explored_optims % NB_OPTIMIZATIONS == 0)
+    if (ast.nb_explored_optims % optimizations_order.size() == 0)
         ast.clear_new_optimizations();
        
     std::vector<syntax_tree*> children;
@@ -174,9 +180,9 @@ void beam_search_topk::beam_search_subroutine(syntax_tree& ast)
     int nb_optims_tried = 0;
     int nb_explored_optims = ast.nb_explored_optims;
     
-    while (children.size() == 0 && nb_optims_tried < NB_OPTIMIZATIONS && nb_explored_optims < max_depth)
+    while (children.size() == 0 && nb_optims_tried < optimizations_order.size() && nb_explored_optims < max_depth)
     {
-        optimization_type optim_type = DEFAULT_OPTIMIZATIONS_ORDER[nb_explored_optims % NB_OPTIMIZATIONS];
+        optimization_type optim_type = optimizations_order[nb_explored_optims % optimizations_order.size()];
         children = scheds_gen->generate_schedules(ast, optim_type);
         
         nb_explored_optims++;
@@ -192,9 +198,13 @@ void beam_search_topk::beam_search_subroutine(syntax_tree& ast)
     {
         child->nb_explored_optims = nb_explored_optims;
         child->transform_ast();
-            
-        child->evaluation = eval_func->evaluate(*child);
-        
+    }
+    
+    std::vector<float> children_evals = eval_func->evaluate_batch(children);
+    
+    for (int i = 0; i < children.size(); ++i)
+    {
+        children[i]->evaluation = children_evals[i];
         nb_explored_schedules++;
     }
         
@@ -230,7 +240,7 @@ void beam_search_topk::beam_search_subroutine(syntax_tree& ast)
 
 void beam_search_accuracy_evaluator::search(syntax_tree& ast)
 {
-    if (ast.nb_explored_optims % NB_OPTIMIZATIONS == 0)
+    if (ast.nb_explored_optims % optimizations_order.size() == 0)
         ast.clear_new_optimizations();
        
     std::vector<syntax_tree*> children;
@@ -239,9 +249,9 @@ void beam_search_accuracy_evaluator::search(syntax_tree& ast)
     int nb_optims_tried = 0;
     int nb_explored_optims = ast.nb_explored_optims;
     
-    while (children.size() == 0 && nb_optims_tried < NB_OPTIMIZATIONS && nb_explored_optims < max_depth)
+    while (children.size() == 0 && nb_optims_tried < optimizations_order.size() && nb_explored_optims < max_depth)
     {
-        optimization_type optim_type = DEFAULT_OPTIMIZATIONS_ORDER[nb_explored_optims % NB_OPTIMIZATIONS];
+        optimization_type optim_type = optimizations_order[nb_explored_optims % optimizations_order.size()];
         children = scheds_gen->generate_schedules(ast, optim_type);
         
         nb_explored_optims++;
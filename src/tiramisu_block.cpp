@@ -59,6 +59,12 @@ void block::shift(var L0, int n) {
     }
 }
 
+void block::shift(int L0, int n) {
+    for (auto &child : this->children) {
+        child->shift(L0, n);
+    }
+}
+
 /*
 void block::skew(var i, var j, int f, var ni, var nj) {
     for (auto &child : this->children) {
@@ -221,5 +227,11 @@ void block::vectorize(var L, int v, var L_outer, var L_inner) {
     }
 }
 
+void block::vectorize(int L, int v) {
+    for (auto &child : this->children) {
+        child->vectorize(L, v);
+    }
+}
+
 
 }  // namespace tiramisu
@@ -10,6 +10,13 @@
 #include <tiramisu/debug.h>
 #include <tiramisu/core.h>
 
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
 #include <string>
 
 
@@ -24,3 +31,880 @@ void tiramisu::function::gen_c_code() const
     isl_printer_free(p);
     tiramisu::str_dump("\n\n");
 }
+
+namespace tiramisu
+{
+
+namespace
+{
+
+/**
+  * Helpers used by the generated C code. Division and modulo follow the
+  * Halide semantics (the result of the modulo is never negative), and
+  * min/max are functions so that nested bounds are not duplicated.
+  */
+const char *c_code_prelude =
+    "#ifndef _POSIX_C_SOURCE\n"
+    "#define _POSIX_C_SOURCE 200112L\n"
+    "#endif\n"
+    "\n"
+    "#include <math.h>\n"
+    "#include <stdbool.h>\n"
+    "#include <stddef.h>\n"
+    "#include <stdint.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "#if defined(__clang__) || defined(__INTEL_COMPILER)\n"
+    "#define TIRAMISU_UNROLL _Pragma(\"unroll\")\n"
+    "#elif defined(__GNUC__) && (__GNUC__ >= 8)\n"
+    "#define TIRAMISU_UNROLL _Pragma(\"GCC unroll 64\")\n"
+    "#else\n"
+    "#define TIRAMISU_UNROLL\n"
+    "#endif\n"
+    "\n"
+    "#if defined(__GNUC__)\n"
+    "#define TIRAMISU_PREFETCH(address) __builtin_prefetch(address)\n"
+    "#define TIRAMISU_ALIGNED(alignment) __attribute__((aligned(alignment)))\n"
+    "#else\n"
+    "#define TIRAMISU_PREFETCH(address)\n"
+    "#define TIRAMISU_ALIGNED(alignment)\n"
+    "#endif\n"
+    "\n"
+    "static inline int64_t tiramisu_div_i64(int64_t a, int64_t b)\n"
+    "{\n"
+    "    int64_t q = a / b;\n"
+    "    int64_t r = a - q * b;\n"
+    "    if (r < 0)\n"
+    "        q = (b > 0) ? q - 1 : q + 1;\n"
+    "    return q;\n"
+    "}\n"
+    "\n"
+    "static inline int64_t tiramisu_mod_i64(int64_t a, int64_t b)\n"
+    "{\n"
+    "    int64_t r = a % b;\n"
+    "    if (r < 0)\n"
+    "        r = (b > 0) ? r + b : r - b;\n"
+    "    return r;\n"
+    "}\n"
+    "\n"
+    "static inline double tiramisu_mod_f64(double a, double b)\n"
+    "{\n"
+    "    return a - b * floor(a / b);\n"
+    "}\n"
+    "\n"
+    "static inline int64_t tiramisu_min_i64(int64_t a, int64_t b) { return (a < b) ? a : b; }\n"
+    "static inline int64_t tiramisu_max_i64(int64_t a, int64_t b) { return (a > b) ? a : b; }\n"
+    "static inline uint64_t tiramisu_min_u64(uint64_t a, uint64_t b) { return (a < b) ? a : b; }\n"
+    "static inline uint64_t tiramisu_max_u64(uint64_t a, uint64_t b) { return (a > b) ? a : b; }\n"
+    "static inline double tiramisu_min_f64(double a, double b) { return (a < b) ? a : b; }\n"
+    "static inline double tiramisu_max_f64(double a, double b) { return (a > b) ? a : b; }\n"
+    "\n"
+    "static inline void *tiramisu_c_malloc(size_t size, size_t alignment)\n"
+    "{\n"
+    "    void *ptr = NULL;\n"
+    "    if (posix_memalign(&ptr, alignment, (size > 0) ? size : 1) != 0)\n"
+    "        abort();\n"
+    "    return ptr;\n"
+    "}\n"
+    "\n"
+    "/* The error code of the function is shared by the threads of parallel loops. */\n"
+    "static inline void tiramisu_c_set_error(int *error)\n"
+    "{\n"
+    "    _Pragma(\"omp atomic write\")\n"
+    "    *error = -1;\n"
+    "}\n"
+    "\n"
+    "static inline int tiramisu_c_get_error(int *error)\n"
+    "{\n"
+    "    int value;\n"
+    "    _Pragma(\"omp atomic read\")\n"
+    "    value = *error;\n"
+    "    return value;\n"
+    "}\n";
+
+/**
+  * Allocations of a constant size of at most this number of bytes are
+  * local arrays (on the stack) instead of calls to malloc.
+  */
+const int64_t max_stack_allocation_size = 16 * 1024;
+
+/**
+  * Return the C type that corresponds to the Halide type \p t.
+  */
+std::string c_type(const Halide::Type &t)
+{
+    if (t.is_vector())
+        ERROR("Vector types are not supported by the C code generator.", true);
+
+    if (t.is_bool())
+        return "bool";
+    if (t.is_int())
+        return "int" + std::to_string(t.bits()) + "_t";
+    if (t.is_uint())
+        return "uint" + std::to_string(t.bits()) + "_t";
+    if (t.is_float())
+        return (t.bits() == 32) ? "float" : "double";
+    if (t.is_handle())
+        return "void *";
+
+    ERROR("Type not supported by the C code generator.", true);
+    return "";
+}
+
+/**
+  * Return \p name as a valid C identifier.
+  */
+std::string c_name(const std::string &name)
+{
+    std::string result = name;
+
+    for (char &c : result)
+        if (!isalnum((unsigned char) c) && (c != '_'))
+            c = '_';
+    if (result.empty() || isdigit((unsigned char) result[0]))
+        result = "_" + result;
+
+    return result;
+}
+
+/**
+  * Return the name of the C function called for the extern (non intrinsic)
+  * call \p op.
+  */
+std::string c_function_name(const Halide::Internal::Call *op)
+{
+    if (op->call_type != Halide::Internal::Call::PureExtern)
+        return op->name;
+
+    // Halide math functions are named after the libm function with the
+    // type as a suffix (e.g. sqrt_f32).
+    std::string name = op->name;
+    std::string suffix = (name.size() > 4) ? name.substr(name.size() - 4) : "";
+    if (suffix == "_f32" || suffix == "_f64")
+    {
+        name = name.substr(0, name.size() - 4);
+        if (name == "is_nan")
+            return "isnan";
+        if (suffix == "_f32")
+            name += "f";
+    }
+
+    return name;
+}
+
+bool is_address_of_call(const Halide::Internal::Call *op)
+{
+    return (op->name.compare(0, 20, "tiramisu_address_of_") == 0) && (op->args.size() == 2);
+}
+
+/**
+  * Return true if \p op is a call to one of the functions that allocate
+  * temporary buffers (see generator::make_buffer_alloc() and
+  * function::plan_temporary_buffers()). They are replaced by C code.
+  */
+bool is_allocation_call(const Halide::Internal::Call *op)
+{
+    return (op->name == "tiramisu_aligned_malloc") || (op->name == "tiramisu_aligned_free") ||
+           (op->name == "tiramisu_arena_address") || (op->name == "tiramisu_thread_arena_malloc") ||
+           (op->name == "tiramisu_thread_arena_free");
+}
+
+/**
+  * Return the type of the elements loaded from or stored in the buffer
+  * \p name in \p s, or a handle type if \p s does not access the buffer.
+  */
+Halide::Type get_element_type(const std::string &name, const Halide::Internal::Stmt &s)
+{
+    class FindAccessType : public Halide::Internal::IRVisitor
+    {
+        using Halide::Internal::IRVisitor::visit;
+
+        const std::string &name;
+
+        void visit(const Halide::Internal::Load *op)
+        {
+            if (op->name == name)
+                type = op->type;
+            Halide::Internal::IRVisitor::visit(op);
+        }
+
+        void visit(const Halide::Internal::Store *op)
+        {
+            if (op->name == name)
+                type = op->value.type();
+            Halide::Internal::IRVisitor::visit(op);
+        }
+
+    public:
+        Halide::Type type = Halide::Handle();
+
+        FindAccessType(const std::string &name) : name(name) {}
+    } find_type(name);
+    s.accept(&find_type);
+
+    return find_type.type;
+}
+
+/**
+  * Return true if \p s contains an assertion.
+  */
+bool has_assertion(const Halide::Internal::Stmt &s)
+{
+    class FindAssertion : public Halide::Internal::IRVisitor
+    {
+        using Halide::Internal::IRVisitor::visit;
+
+        void visit(const Halide::Internal::AssertStmt *op)
+        {
+            found = true;
+        }
+
+    public:
+        bool found = false;
+    } find_assertion;
+    s.accept(&find_assertion);
+
+    return find_assertion.found;
+}
+
+/**
+  * Collect the prototypes of the extern functions called by a statement.
+  */
+class CollectExternCalls : public Halide::Internal::IRVisitor
+{
+    using Halide::Internal::IRVisitor::visit;
+
+    void visit(const Halide::Internal::Call *op)
+    {
+        Halide::Internal::IRVisitor::visit(op);
+
+        if ((op->call_type != Halide::Internal::Call::Extern) &&
+            (op->call_type != Halide::Internal::Call::ExternCPlusPlus))
+            return;
+        if (is_address_of_call(op) || is_allocation_call(op) || (prototypes.count(op->name) > 0))
+            return;
+
+        std::string prototype = c_type(op->type) + " " + op->name + "(";
+        for (size_t i = 0; i < op->args.size(); i++)
+            prototype += ((i > 0) ? ", " : "") + c_type(op->args[i].type());
+        prototype += (op->args.empty() ? "void);" : ");");
+
+        prototypes[op->name] = prototype;
+    }
+
+public:
+    std::map<std::string, std::string> prototypes;
+};
+
+/**
+  * Collect the buffers whose accesses have a known alignment (see
+  * buffer::set_alignment() and generator::add_alignment_checks()).
+  */
+class CollectAlignedBuffers : public Halide::Internal::IRVisitor
+{
+    using Halide::Internal::IRVisitor::visit;
+
+    void add(const std::string &name, const Halide::Internal::Parameter &param, const Halide::Type &type)
+    {
+        if (param.defined() && (param.host_alignment() > type.bytes()))
+            alignments[name] = param.host_alignment();
+    }
+
+    void visit(const Halide::Internal::Load *op)
+    {
+        Halide::Internal::IRVisitor::visit(op);
+        add(op->name, op->param, op->type);
+    }
+
+    void visit(const Halide::Internal::Store *op)
+    {
+        Halide::Internal::IRVisitor::visit(op);
+        add(op->name, op->param, op->value.type());
+    }
+
+public:
+    std::map<std::string, int> alignments;
+};
+
+/**
+  * Print a Halide statement (as generated by function::gen_halide_stmt(),
+  * i.e., before Halide lowering) in C.
+  */
+class CodeGenC : public Halide::Internal::IRVisitor
+{
+    using Halide::Internal::IRVisitor::visit;
+
+    std::ostream &stream;
+    int indent;
+
+    /**
+      * The C code of the last printed expression.
+      */
+    std::string id;
+
+    void do_indent()
+    {
+        stream << std::string(indent, ' ');
+    }
+
+    std::string print_binary(const Halide::Expr &a, const std::string &op, const Halide::Expr &b)
+    {
+        return "(" + print(a) + " " + op + " " + print(b) + ")";
+    }
+
+    /**
+      * Print a call to one of the min/max/div/mod helpers of the prelude.
+      */
+    std::string print_helper(const std::string &helper, const Halide::Type &t,
+                             const Halide::Expr &a, const Halide::Expr &b)
+    {
+        std::string suffix = t.is_float() ? "_f64" : (t.is_uint() ? "_u64" : "_i64");
+        return "((" + c_type(t) + ")tiramisu_" + helper + suffix + "(" + print(a) + ", " + print(b) + "))";
+    }
+
+    /**
+      * Print a statement in its own scope if it declares a variable.
+      */
+    void print_scoped(const Halide::Internal::Stmt &s)
+    {
+        if (s.as<Halide::Internal::LetStmt>() || s.as<Halide::Internal::Allocate>())
+        {
+            do_indent();
+            stream << "{\n";
+            indent += 4;
+            print(s);
+            indent -= 4;
+            do_indent();
+            stream << "}\n";
+        }
+        else
+            print(s);
+    }
+
+    void visit(const Halide::Internal::IntImm *op)
+    {
+        if (op->value == std::numeric_limits<int64_t>::min())
+            id = "((" + c_type(op->type) + ")INT64_MIN)";
+        else if (op->type.bits() == 64)
+            id = "INT64_C(" + std::to_string(op->value) + ")";
+        else if ((op->type.bits() == 32) && (op->value != std::numeric_limits<int32_t>::min()))
+            id = std::to_string(op->value);
+        else
+            id = "((" + c_type(op->type) + ")" + std::to_string(op->value) + ")";
+    }
+
+    void visit(const Halide::Internal::UIntImm *op)
+    {
+        if (op->type.is_bool())
+            id = (op->value ? "true" : "false");
+        else if (op->type.bits() == 64)
+            id = "UINT64_C(" + std::to_string(op->value) + ")";
+        else
+            id = "((" + c_type(op->type) + ")" + std::to_string(op->value) + "u)";
+    }
+
+    void visit(const Halide::Internal::FloatImm *op)
+    {
+        std::ostringstream value;
+        if (std::isnan(op->value))
+            value << "NAN";
+        else if (std::isinf(op->value))
+            value << ((op->value > 0) ? "INFINITY" : "(-INFINITY)");
+        else
+            value << std::setprecision(std::numeric_limits<double>::max_digits10) << op->value;
+        id = "((" + c_type(op->type) + ")" + value.str() + ")";
+    }
+
+    void visit(const Halide::Internal::StringImm *op)
+    {
+        std::ostringstream value;
+        value << "\"";
+        for (char c : op->value)
+        {
+            if (c == '"' || c == '\\')
+                value << '\\' << c;
+            else if (c == '\n')
+                value << "\\n";
+            else
+                value << c;
+        }
+        value << "\"";
+        id = value.str();
+    }
+
+    void visit(const Halide::Internal::Cast *op)
+    {
+        id = "((" + c_type(op->type) + ")" + print(op->value) + ")";
+    }
+
+    void visit(const Halide::Internal::Variable *op)
+    {
+        id = c_name(op->name);
+    }
+
+    void visit(const Halide::Internal::Add *op)
+    {
+        id = print_binary(op->a, "+", op->b);
+    }
+
+    void visit(const Halide::Internal::Sub *op)
+    {
+        id = print_binary(op->a, "-", op->b);
+    }
+
+    void visit(const Halide::Internal::Mul *op)
+    {
+        id = print_binary(op->a, "*", op->b);
+    }
+
+    void visit(const Halide::Internal::Div *op)
+    {
+        if (op->type.is_int())
+            id = print_helper("div", op->type, op->a, op->b);
+        else
+            id = print_binary(op->a, "/", op->b);
+    }
+
+    void visit(const Halide::Internal::Mod *op)
+    {
+        if (op->type.is_int() || op->type.is_float())
+            id = print_helper("mod", op->type, op->a, op->b);
+        else
+            id = print_binary(op->a, "%", op->b);
+    }
+
+    void visit(const Halide::Internal::Min *op)
+    {
+        id = print_helper("min", op->type, op->a, op->b);
+    }
+
+    void visit(const Halide::Internal::Max *op)
+    {
+        id = print_helper("max", op->type, op->a, op->b);
+    }
+
+    void visit(const Halide::Internal::EQ *op)
+    {
+        id = print_binary(op->a, "==", op->b);
+    }
+
+    void visit(const Halide::Internal::NE *op)
+    {
+        id = print_binary(op->a, "!=", op->b);
+    }
+
+    void visit(const Halide::Internal::LT *op)
+    {
+        id = print_binary(op->a, "<", op->b);
+    }
+
+    void visit(const Halide::Internal::LE *op)
+    {
+        id = print_binary(op->a, "<=", op->b);
+    }
+
+    void visit(const Halide::Internal::GT *op)
+    {
+        id = print_binary(op->a, ">", op->b);
+    }
+
+    void visit(const Halide::Internal::GE *op)
+    {
+        id = print_binary(op->a, ">=", op->b);
+    }
+
+    void visit(const Halide::Internal::And *op)
+    {
+        id = print_binary(op->a, "&&", op->b);
+    }
+
+    void visit(const Halide::Internal::Or *op)
+    {
+        id = print_binary(op->a, "||", op->b);
+    }
+
+    void visit(const Halide::Internal::Not *op)
+    {
+        id = "(!" + print(op->a) + ")";
+    }
+
+    void visit(const Halide::Internal::Select *op)
+    {
+        id = "(" + print(op->condition) + " ? " + print(op->true_value) + " : " + print(op->false_value) + ")";
+    }
+
+    void visit(const Halide::Internal::Load *op)
+    {
+        id = c_name(op->name) + "[" + print(op->index) + "]";
+    }
+
+    void visit(const Halide::Internal::Ramp *op)
+    {
+        ERROR("Vector expressions are not supported by the C code generator.", true);
+    }
+
+    void visit(const Halide::Internal::Broadcast *op)
+    {
+        ERROR("Vector expressions are not supported by the C code generator.", true);
+    }
+
+    void visit(const Halide::Internal::Let *op)
+    {
+        id = print(Halide::Internal::substitute(op->name, op->value, op->body));
+    }
+
+    void visit(const Halide::Internal::Call *op)
+    {
+        const std::string &name = op->name;
+
+        if ((op->call_type == Halide::Internal::Call::Intrinsic) ||
+            (op->call_type == Halide::Internal::Call::PureIntrinsic))
+        {
+            if (name == "likely" || name == "likely_if_innermost" || name == "promise_clamped")
+                id = print(op->args[0]);
+            else if (name == "return_second")
+                id = print(op->args[1]);
+            else if (name == "bitwise_and")
+                id = print_binary(op->args[0], "&", op->args[1]);
+            else if (name == "bitwise_or")
+                id = print_binary(op->args[0], "|", op->args[1]);
+            else if (name == "bitwise_xor")
+                id = print_binary(op->args[0], "^", op->args[1]);
+            else if (name == "bitwise_not")
+                id = "(~" + print(op->args[0]) + ")";
+            else if (name == "shift_left")
+                id = print_binary(op->args[0], "<<", op->args[1]);
+            else if (name == "shift_right")
+                id = print_binary(op->args[0], ">>", op->args[1]);
+            else if (name == "abs")
+            {
+                std::string a = print(op->args[0]);
+                id = "((" + c_type(op->type) + ")(" + a + " < 0 ? -" + a + " : " + a + "))";
+            }
+            else if (name == "if_then_else")
+                id = "(" + print(op->args[0]) + " ? " + print(op->args[1]) + " : " + print(op->args[2]) + ")";
+            else if (name == "reinterpret" &&
+                     (op->type.is_handle() || op->args[0].type().is_handle()))
+            {
+                std::string pointer_type = op->type.is_handle() ? "(void *)" : "(" + c_type(op->type) + ")";
+                id = "(" + pointer_type + "(uintptr_t)" + print(op->args[0]) + ")";
+            }
+            else if (name == "prefetch")
+            {
+                id = "TIRAMISU_PREFETCH(&" + print(op->args[0]) + "[" + print(op->args[1]) + "])";
+            }
+            else
+                ERROR("The intrinsic " + name + " is not supported by the C code generator.", true);
+        }
+        else if (is_address_of_call(op))
+        {
+            // The first argument is the halide_buffer_t of the buffer ("name.buffer").
+            const Halide::Internal::Variable *buffer = op->args[0].as<Halide::Internal::Variable>();
+            if (buffer == NULL)
+                ERROR("Unsupported call to " + name + " in the C code generator.", true);
+
+            std::string buffer_name = buffer->name;
+            if (buffer_name.size() > 7 && buffer_name.compare(buffer_name.size() - 7, 7, ".buffer") == 0)
+                buffer_name = buffer_name.substr(0, buffer_name.size() - 7);
+            id = "(&" + c_name(buffer_name) + "[" + print(op->args[1]) + "])";
+        }
+        else if ((name == "tiramisu_aligned_malloc" || name == "tiramisu_thread_arena_malloc") &&
+                 op->args.size() == 2)
+            id = "tiramisu_c_malloc((size_t)" + print(op->args[0]) + ", (size_t)tiramisu_max_u64(64, " +
+                 print(op->args[1]) + "))";
+        else if ((name == "tiramisu_aligned_free" || name == "tiramisu_thread_arena_free") &&
+                 op->args.size() == 1)
+            id = "(free(" + print(op->args[0]) + "), 0)";
+        else if (name == "tiramisu_arena_address" && op->args.size() == 2)
+            id = "((void *)((char *)" + print(op->args[0]) + " + " + print(op->args[1]) + "))";
+        else
+        {
+            std::string args;
+            for (size_t i = 0; i < op->args.size(); i++)
+            {
+                // The C code has no halide_buffer_t, only the data of the buffers.
+                const Halide::Internal::Variable *arg = op->args[i].as<Halide::Internal::Variable>();
+                if ((arg != NULL) && arg->type.is_handle() && (arg->name.size() > 7) &&
+                    (arg->name.compare(arg->name.size() - 7, 7, ".buffer") == 0))
+                    ERROR("The extern function " + name + " takes the halide_buffer_t " + arg->name +
+                          ", which is not supported by the C code generator.", true);
+
+                args += ((i > 0) ? ", " : "") + print(op->args[i]);
+            }
+            id = c_function_name(op) + "(" + args + ")";
+        }
+    }
+
+    void visit(const Halide::Internal::LetStmt *op)
+    {
+        do_indent();
+        if (op->value.type().is_handle())
+        {
+            // A pointer to a temporary buffer (see generator::make_buffer_alloc()
+            // and function::plan_temporary_buffers()).
+            Halide::Type element = get_element_type(op->name, op->body);
+            std::string type = element.is_handle() ? "void" : c_type(element);
+            stream << type << " *const " << c_name(op->name) << " = (" << type << " *)"
+                   << print(op->value) << ";\n";
+        }
+        else
+            stream << "const " << c_type(op->value.type()) << " " << c_name(op->name) << " = "
+                   << print(op->value) << ";\n";
+        print(op->body);
+    }
+
+    void visit(const Halide::Internal::AssertStmt *op)
+    {
+        // The function cannot return from a parallel loop, and returning
+        // would leak the buffers allocated in the enclosing scopes: a failed
+        // assertion sets the error code of the function, and the statements
+        // that follow it are skipped (see visit(const Block *)).
+        do_indent();
+        stream << "if (!(" << print(op->condition) << "))\n";
+        do_indent();
+        stream << "    tiramisu_c_set_error(&tiramisu_error);\n";
+    }
+
+    void visit(const Halide::Internal::ProducerConsumer *op)
+    {
+        print(op->body);
+    }
+
+    void visit(const Halide::Internal::For *op)
+    {
+        std::string name = c_name(op->name);
+        std::string type = c_type(op->min.type());
+        std::string min = print(op->min);
+        std::string extent = print(op->extent);
+
+        switch (op->for_type)
+        {
+            case Halide::Internal::ForType::Serial:
+                break;
+            case Halide::Internal::ForType::Parallel:
+                do_indent();
+                stream << "#pragma omp parallel for\n";
+                break;
+            case Halide::Internal::ForType::Vectorized:
+            {
+                CollectAlignedBuffers aligned;
+                op->body.accept(&aligned);
+
+                do_indent();
+                stream << "#pragma omp simd";
+                for (const auto &buffer : aligned.alignments)
+                    stream << " aligned(" << c_name(buffer.first) << ":" << buffer.second << ")";
+                stream << "\n";
+                break;
+            }
+            case Halide::Internal::ForType::Unrolled:
+                do_indent();
+                stream << "TIRAMISU_UNROLL\n";
+                break;
+            default:
+                ERROR("GPU loops are not supported by the C code generator.", true);
+        }
+
+        do_indent();
+        stream << "for (" << type << " " << name << " = " << min << "; "
+               << name << " < " << min << " + " << extent << "; " << name << "++)\n";
+        do_indent();
+        stream << "{\n";
+        indent += 4;
+        print(op->body);
+        indent -= 4;
+        do_indent();
+        stream << "}\n";
+    }
+
+    void visit(const Halide::Internal::Store *op)
+    {
+        std::string value = print(op->value);
+        std::string index = print(op->index);
+
+        do_indent();
+        if (!Halide::Internal::is_one(op->predicate))
+            stream << "if (" << print(op->predicate) << ") ";
+        stream << c_name(op->name) << "[" << index << "] = " << value << ";\n";
+    }
+
+    void visit(const Halide::Internal::Provide *op)
+    {
+        ERROR("Provide statements are not supported by the C code generator.", true);
+    }
+
+    void visit(const Halide::Internal::Allocate *op)
+    {
+        std::string name = c_name(op->name);
+        std::string type = c_type(op->type);
+
+        // Small allocations of a constant size (e.g. the registers of
+        // scalar replacement) are local arrays.
+        bool local_array = true;
+        int64_t elements = 1;
+        for (const auto &extent : op->extents)
+        {
+            const int64_t *constant = Halide::Internal::as_const_int(Halide::Internal::simplify(extent));
+            local_array = local_array && (constant != NULL) && (*constant > 0) &&
+                          (*constant <= max_stack_allocation_size / (elements * op->type.bytes()));
+            if (local_array)
+                elements *= *constant;
+        }
+        if (local_array)
+        {
+            do_indent();
+            stream << type << " " << name << "[" << elements << "]"
+                   << ((elements > 1) ? " TIRAMISU_ALIGNED(64)" : "") << ";\n";
+            print(op->body);
+            return;
+        }
+
+        std::string size = "sizeof(" + type + ")";
+        for (const auto &extent : op->extents)
+            size += " * (size_t)" + print(extent);
+
+        do_indent();
+        stream << type << " *restrict " << name << " = (" << type << " *)tiramisu_c_malloc("
+               << size << ", 64);\n";
+        print(op->body);
+        do_indent();
+        stream << "free(" << name << ");\n";
+    }
+
+    void visit(const Halide::Internal::Free *op)
+    {
+        // Buffers are freed at the end of the scope of their allocation.
+    }
+
+    void visit(const Halide::Internal::Realize *op)
+    {
+        ERROR("Realize statements are not supported by the C code generator.", true);
+    }
+
+    void visit(const Halide::Internal::Block *op)
+    {
+        print_scoped(op->first);
+        if (!op->rest.defined())
+            return;
+
+        if (has_assertion(op->first))
+        {
+            // Skip the rest of the block if an assertion failed.
+            do_indent();
+            stream << "if (tiramisu_c_get_error(&tiramisu_error) == 0)\n";
+            do_indent();
+            stream << "{\n";
+            indent += 4;
+            print(op->rest);
+            indent -= 4;
+            do_indent();
+            stream << "}\n";
+        }
+        else
+            print_scoped(op->rest);
+    }
+
+    void visit(const Halide::Internal::IfThenElse *op)
+    {
+        do_indent();
+        stream << "if (" << print(op->condition) << ")\n";
+        do_indent();
+        stream << "{\n";
+        indent += 4;
+        print(op->then_case);
+        indent -= 4;
+        do_indent();
+        stream << "}\n";
+
+        if (op->else_case.defined())
+        {
+            do_indent();
+            stream << "else\n";
+            do_indent();
+            stream << "{\n";
+            indent += 4;
+            print(op->else_case);
+            indent -= 4;
+            do_indent();
+            stream << "}\n";
+        }
+    }
+
+    void visit(const Halide::Internal::Evaluate *op)
+    {
+        std::string value = print(op->value);
+        do_indent();
+        stream << value << ";\n";
+    }
+
+public:
+    CodeGenC(std::ostream &stream, int indent) : stream(stream), indent(indent) {}
+
+    std::string print(const Halide::Expr &e)
+    {
+        e.accept(this);
+        return id;
+    }
+
+    void print(const Halide::Internal::Stmt &s)
+    {
+        if (s.defined())
+            s.accept(this);
+    }
+};
+
+}
+
+void function::gen_c_code(const std::string &c_file_name) const
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    compile_profiler::scope s("gen_c_code", this->get_name());
+
+    Halide::Internal::Stmt stmt = this->get_halide_stmt();
+    if (!stmt.defined())
+        ERROR("gen_halide_stmt() should be called before generating C code.", true);
+
+    // Streaming stores are regular stores in C.
+    stmt = remove_nontemporal_stores_markers(stmt);
+
+    std::ostringstream body;
+    CodeGenC printer(body, 4);
+    printer.print(stmt);
+
+    CollectExternCalls externs;
+    stmt.accept(&externs);
+
+    std::ofstream out(c_file_name);
+    if (!out.is_open())
+        ERROR("Cannot open the file " + c_file_name + ".", true);
+
+    out << "/* Generated by the Tiramisu compiler for the function " << this->get_name() << ". */\n\n";
+    out << c_code_prelude << "\n";
+
+    for (const auto &prototype : externs.prototypes)
+        out << prototype.second << "\n";
+    if (!externs.prototypes.empty())
+        out << "\n";
+
+    // The arguments are passed as pointers to the data of the buffers.
+    out << "int " << c_name(this->get_name()) << "(";
+    const std::vector<tiramisu::buffer *> &arguments = this->get_arguments();
+    for (size_t i = 0; i < arguments.size(); i++)
+    {
+        tiramisu::buffer *b = arguments[i];
+        out << ((i > 0) ? ", " : "")
+            << ((b->get_argument_type() == tiramisu::a_input) ? "const " : "")
+            << c_type(halide_type_from_tiramisu_type(b->get_elements_type()))
+            << " *restrict " << c_name(b->get_name());
+    }
+    out << ((arguments.empty()) ? "void)\n" : ")\n");
+    out << "{\n    int tiramisu_error = 0;\n" << body.str() << "    return tiramisu_error;\n}\n";
+
+    DEBUG(3, tiramisu::str_dump("Generated C code in " + c_file_name));
+
+    DEBUG_INDENT(-4);
+}
+
+}
@@ -14,7 +14,15 @@
 #include <tiramisu/type.h>
 #include <tiramisu/expr.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
 #include <string>
+#include <unistd.h>
 #include "../include/tiramisu/expr.h"
 #include "../3rdParty/Halide/src/Expr.h"
 #include "../3rdParty/Halide/src/Parameter.h"
@@ -22,6 +30,21 @@
 #include "../3rdParty/Halide/src/IR.h"
 #include "../include/tiramisu/core.h"
 
+#include <llvm/ADT/Triple.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/Config/llvm-config.h>
+#if LLVM_VERSION_MAJOR >= 10
+#include <llvm/IR/IntrinsicsX86.h>
+#endif
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+
 namespace tiramisu
 {
 
@@ -59,12 +82,10 @@ std::vector<computation *> function::get_computation_by_name(std::string name) c
 
     std::vector<tiramisu::computation *> res_comp;
 
-    for (const auto &comp : this->get_computations())
+    auto found = this->computations_index.find(name);
+    if (found != this->computations_index.end())
     {
-        if (name == comp->get_name())
-        {
-            res_comp.push_back(comp);
-        }
+        res_comp = found->second;
     }
 
     if (res_comp.empty())
@@ -1724,6 +1745,7 @@ void tiramisu::generator::extract_tags_from_isl_node(const tiramisu::function &f
 Halide::Internal::Stmt
 tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, isl_ast_node *node, int level,
                                                std::vector<std::pair<std::string, std::string>> &tagged_stmts,
+                                               std::vector<std::pair<std::string, Halide::Expr>> &enclosing_loops,
                                                bool is_a_child_block)
 {
     assert(node != NULL);
@@ -1866,7 +1888,7 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
             {
                 DEBUG(3, tiramisu::str_dump("Generating block."));
                 // Generate a child block
-                block = tiramisu::generator::halide_stmt_from_isl_node(fct, child, level, tagged_stmts, true);
+                block = tiramisu::generator::halide_stmt_from_isl_node(fct, child, level, tagged_stmts, enclosing_loops, true);
             }
             isl_ast_node_free(child);
 
@@ -1974,7 +1996,7 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
 //                           buf->get_name(),
 //                           halide_type_from_tiramisu_type(buf->get_elements_type()),
 //                           halide_dim_sizes, Halide::Internal::const_true(), result);
-                    result = make_buffer_alloc(buf, halide_dim_sizes, result);
+                    result = make_buffer_alloc(buf, halide_dim_sizes, result, true);
 
 
                     buf->mark_as_allocated();
@@ -2100,10 +2122,14 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
             }
             DEBUG(3, tiramisu::str_dump("Upper bound expression: ");
                     std::cout << cond_upper_bound_halide_format);
+            enclosing_loops.push_back(std::make_pair(iterator_str, init_expr));
             Halide::Internal::Stmt halide_body =
-                    tiramisu::generator::halide_stmt_from_isl_node(fct, body, level + 1, tagged_stmts, false);
+                    tiramisu::generator::halide_stmt_from_isl_node(fct, body, level + 1, tagged_stmts, enclosing_loops, false);
+            enclosing_loops.pop_back();
             Halide::Internal::ForType fortype = Halide::Internal::ForType::Serial;
             Halide::DeviceAPI dev_api = Halide::DeviceAPI::Host;
+            tiramisu::vector_tail_t vector_tail = tiramisu::vector_tail_t::separate;
+            Halide::Expr loop_upper_bound = cond_upper_bound_halide_format;
 
             // Change the type from Serial to parallel or vector if the
             // current level was marked as such.
@@ -2126,6 +2152,9 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
                                                     tagged_stmts[tt].first));
 
                         int vector_length = fct.get_vector_length(tagged_stmts[tt].first, level);
+                        vector_tail = fct.get_vector_tail(tagged_stmts[tt].first, level);
+                        if (vector_tail == tiramisu::vector_tail_t::padded)
+                            generator::check_padding_for_vector_tail(fct, tagged_stmts[tt].first, vector_length);
 
                         for (auto vd: fct.vector_dimensions) {
                             DEBUG(3, "stmt = " + std::get<0>(vd) + ", level = " +
@@ -2263,10 +2292,33 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
                 tt++;
             }
 
+            // Scalar replacement does not change the type of the loop, it is
+            // checked independently from the other tags.
+            bool scalar_replace = false;
+            for (auto &ts : tagged_stmts)
+            {
+                if (ts.first != "" && ts.second == "scalar_replace" &&
+                    fct.should_scalar_replace(ts.first, level))
+                {
+                    scalar_replace = true;
+                    ts.first = "";
+                }
+            }
+
             DEBUG(10, tiramisu::str_dump("The full list of tagged statements is now:"));
             for (const auto &ts: tagged_stmts) DEBUG(10, tiramisu::str_dump(ts.first + " with tag " + ts.second));
             DEBUG(10, tiramisu::str_dump(""));
 
+            if (vector_tail == tiramisu::vector_tail_t::masked) {
+                // The loop always runs over a full vector, the iterations past the
+                // original upper bound are masked. Halide vectorizes the condition
+                // into masked loads and stores.
+                DEBUG(3, tiramisu::str_dump("Masking the last vector of the loop."));
+                Halide::Expr iterator_var = Halide::Internal::Variable::make(
+                        halide_type_from_tiramisu_type(global::get_loop_iterator_data_type()), iterator_str);
+                halide_body = Halide::Internal::IfThenElse::make(iterator_var < loop_upper_bound, halide_body);
+            }
+
             if (convert_to_conditional) {
                 DEBUG(3, tiramisu::str_dump("Converting for loop into a rank conditional."));
                 Halide::Expr rank_var =
@@ -2283,6 +2335,8 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
                 result = Halide::Internal::For::make(iterator_str, init_expr,
                                                      cond_upper_bound_halide_format - init_expr,
                                                      fortype, dev_api, halide_body);
+                if (scalar_replace)
+                    result = generator::scalar_replace_invariant_accesses(result, fct.read_only_scalar_replacement);
                 DEBUG(3, tiramisu::str_dump("For loop created."));
                 DEBUG(10, std::cout << result);
             }
@@ -2342,6 +2396,8 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
                     tagged_stmts.push_back(std::pair<std::string, std::string>(computation_name, "unroll"));
                 if (fct.should_distribute(computation_name, l))
                     tagged_stmts.push_back(std::pair<std::string, std::string>(computation_name, "distribute"));
+                if (fct.should_scalar_replace(computation_name, l))
+                    tagged_stmts.push_back(std::pair<std::string, std::string>(computation_name, "scalar_replace"));
 
                 DEBUG(10, tiramisu::str_dump("The full list of tagged statements is now"));
                 for (const auto &ts: tagged_stmts)
@@ -2354,6 +2410,10 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
 
             comp->create_halide_assignment();
             result = comp->get_generated_halide_stmt();
+            if ((fct.streaming_store_computations.count(comp->get_name()) > 0) &&
+                (comp->get_access_relation() != nullptr))
+                result = mark_nontemporal_stores(generator::get_buffer_name(comp), result);
+            result = generator::add_prefetches(fct, comp, enclosing_loops, result);
 
 
             for (const auto &l_stmt : comp->get_associated_let_stmts())
@@ -2422,7 +2482,7 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
             DEBUG(3, tiramisu::str_dump("Generating code for the if branch."));
 
             Halide::Internal::Stmt if_s =
-                    tiramisu::generator::halide_stmt_from_isl_node(fct, if_stmt, level, tagged_stmts, false);
+                    tiramisu::generator::halide_stmt_from_isl_node(fct, if_stmt, level, tagged_stmts, enclosing_loops, false);
 
             DEBUG(10, tiramisu::str_dump("If branch: "); std::cout << if_s);
 
@@ -2443,7 +2503,7 @@ tiramisu::generator::halide_stmt_from_isl_node(const tiramisu::function &fct, is
                 else
                 {
                     DEBUG(3, tiramisu::str_dump("Generating code for the else branch."));
-                    else_s = tiramisu::generator::halide_stmt_from_isl_node(fct, else_stmt, level, tagged_stmts, false);
+                    else_s = tiramisu::generator::halide_stmt_from_isl_node(fct, else_stmt, level, tagged_stmts, enclosing_loops, false);
                     DEBUG(10, tiramisu::str_dump("Else branch: "); std::cout << else_s);
                 }
             }
@@ -2476,17 +2536,27 @@ void function::gen_halide_stmt()
 
     Halide::Internal::set_always_upcast();
 
+    if (this->automatic_scalar_replacement)
+        this->gen_scalar_replacement_tags();
+
     // This vector is used in generate_Halide_stmt_from_isl_node to figure
     // out what are the statements that have already been visited in the
     // AST tree.
     std::vector<std::pair<std::string, std::string>> generated_stmts;
+    std::vector<std::pair<std::string, Halide::Expr>> enclosing_loops;
     Halide::Internal::Stmt stmt;
 
     // Generate the statement that represents the whole function
-    stmt = tiramisu::generator::halide_stmt_from_isl_node(*this, this->get_isl_ast(), 0, generated_stmts, false);
+    stmt = tiramisu::generator::halide_stmt_from_isl_node(*this, this->get_isl_ast(), 0, generated_stmts,
+                                                          enclosing_loops, false);
 
     DEBUG(3, tiramisu::str_dump("The following Halide statement was generated:\n"); std::cout << stmt << std::endl);
 
+    stmt = generator::add_alignment_checks(*this, stmt);
+
+    if (!this->specializations.empty())
+        stmt = this->gen_specializations(stmt);
+
     Halide::Internal::Stmt freestmts;
     for (const auto &b : this->get_buffers())
     {
@@ -2504,6 +2574,10 @@ void function::gen_halide_stmt()
     if (freestmts.defined())
         stmt = Halide::Internal::Block::make(stmt, freestmts);
 
+    // Pack the temporary buffers whose live ranges do not overlap in one arena.
+    std::unordered_set<std::string> planned_buffers;
+    stmt = this->plan_temporary_buffers(stmt, planned_buffers);
+
     // Allocate buffers that are not passed as an argument to the function
     for (const auto &b : this->get_buffers())
     {
@@ -2511,6 +2585,13 @@ void function::gen_halide_stmt()
         // Allocate only arrays that are not passed to the function as arguments.
         if (buf->get_argument_type() == tiramisu::a_temporary && buf->get_auto_allocate() == true)
         {
+            if (planned_buffers.count(buf->get_name()) > 0)
+            {
+                // The buffer is in the arena of the memory planner.
+                buf->mark_as_allocated();
+                continue;
+            }
+
             std::vector<Halide::Expr> halide_dim_sizes;
             // Create a vector indicating the size that should be allocated.
             // Tiramisu buffer is defined from outermost to innermost, whereas Halide is from
@@ -2575,229 +2656,1624 @@ void function::gen_halide_stmt()
     DEBUG_INDENT(-4);
 }
 
-Halide::Internal::Stmt generator::make_buffer_alloc(buffer *b, const std::vector<Halide::Expr> &extents,
-                                                    Halide::Internal::Stmt &stmt) {
-    using cuda_ast::memory_location;
-    auto h_type = halide_type_from_tiramisu_type(b->get_elements_type());
-    if (b->location == memory_location::host)
+Halide::Internal::Stmt function::gen_specializations(const Halide::Internal::Stmt &generic)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    // The state of a computation in the generic version.
+    struct computation_state
     {
-        return Halide::Internal::Allocate::make(
-                b->get_name(),
-                h_type,
-                extents, Halide::Internal::const_true(), stmt);
+        computation *comp;
+        std::string name;
+        isl_set *iteration_domain;
+        isl_set *time_processor_domain;
+        isl_map *schedule;
+        isl_map *access;
+        std::vector<computation *> updates;
+    };
+
+    // Save the generic version. Each specialization is applied on top of
+    // it and the generic version is restored once the specialization is
+    // generated.
+    std::vector<computation *> generic_body = this->body;
+    std::unordered_map<std::string, std::vector<computation *>> generic_computations_index = this->computations_index;
+    std::vector<computation_state> generic_computations;
+    std::unordered_set<computation *> generic_computations_set;
+    for (computation *comp : generic_body)
+    {
+        generic_computations.push_back({comp, comp->name,
+                                        isl_set_copy(comp->iteration_domain),
+                                        isl_set_copy(comp->time_processor_domain),
+                                        isl_map_copy(comp->schedule),
+                                        isl_map_copy(comp->access),
+                                        comp->updates});
+        generic_computations_set.insert(comp);
+        generic_computations_set.insert(comp->updates.begin(), comp->updates.end());
     }
-    else if (b->location == memory_location::global)
+
+    // The buffers are saved by value, so that the changes of a
+    // specialization to the buffers passed as arguments (store_in(),
+    // set_layout(), padding, alignment) are undone. The temporary buffers
+    // allocated by the function are allocated once for all the versions,
+    // so the specializations cannot change them.
+    std::map<std::string, tiramisu::buffer *> generic_buffers_list = this->buffers_list;
+    std::vector<std::pair<tiramisu::buffer *, tiramisu::buffer>> generic_buffers;
+    for (const auto &b : this->buffers_list)
+        generic_buffers.push_back({b.second, *b.second});
+
+    auto generic_sched_graph = this->sched_graph;
+    auto generic_sched_graph_reversed = this->sched_graph_reversed;
+    auto generic_starting_computations = this->starting_computations;
+    auto generic_automatically_allocated = this->automatically_allocated;
+    bool generic_use_low_level_scheduling_commands = this->use_low_level_scheduling_commands;
+
+    // The tags cleared by remove_dimension_tags().
+    auto generic_parallel_dimensions = this->parallel_dimensions;
+    auto generic_vector_dimensions = this->vector_dimensions;
+    auto generic_distributed_dimensions = this->distributed_dimensions;
+    auto generic_gpu_block_dimensions = this->gpu_block_dimensions;
+    auto generic_gpu_thread_dimensions = this->gpu_thread_dimensions;
+    auto generic_unroll_dimensions = this->unroll_dimensions;
+    auto generic_parallel_dimensions_index = this->parallel_dimensions_index;
+    auto generic_vector_dimensions_index = this->vector_dimensions_index;
+    auto generic_unroll_dimensions_index = this->unroll_dimensions_index;
+    auto generic_vector_tails = this->vector_tails;
+    auto generic_prefetch_dimensions = this->prefetch_dimensions;
+    auto generic_scalar_replacement_dimensions = this->scalar_replacement_dimensions;
+    auto generic_streaming_store_computations = this->streaming_store_computations;
+
+    isl_set *generic_context = this->get_program_context();
+    isl_ast_node *generic_ast = this->ast;
+
+    // The streaming stores of all the versions (the stores of a buffer are
+    // marked non-temporal in the whole object file).
+    std::unordered_set<std::string> streaming_computations;
+
+    Halide::Internal::Stmt result = generic;
+
+    // Build the specializations from the last one, so that the first one
+    // is checked first at runtime.
+    for (int i = this->specializations.size() - 1; i >= 0; i--)
     {
-        Halide::Expr size = extents[0];
-        for (int  i = 1; i < extents.size(); i++)
+        const std::string &constraints = this->specializations[i].first;
+        isl_set *constraints_set = isl_set_read_from_str(this->get_isl_ctx(), constraints.c_str());
+        if ((constraints_set == NULL) || !isl_set_is_params(constraints_set))
         {
-            size = size * extents[i];
+            ERROR("The constraints of a specialization should be a set over the parameters"
+                  " of the function: " + constraints, true);
         }
-        return Halide::Internal::LetStmt::make(
-                b->get_name(),
-                Halide::Internal::Call::make(Halide::type_of<void *>(), "tiramisu_cuda_malloc",
-                                             {Halide::cast(Halide::UInt(64), size * h_type.bytes())}, Halide::Internal::Call::Extern),
-                stmt
-        );
 
+        DEBUG(3, tiramisu::str_dump("Generating the specialization for " + constraints));
+
+        // Runtime check of the constraints.
+        isl_ast_build *build = isl_ast_build_from_context(isl_set_universe(isl_set_get_space(constraints_set)));
+        isl_ast_expr *check = isl_ast_build_expr_from_set(build, constraints_set);
+        Halide::Expr condition = halide_expr_from_isl_ast_expr(check);
+        isl_ast_expr_free(check);
+        isl_ast_build_free(build);
+
+        // Generate the loop nest of the specialization.
+        if (this->specializations[i].second)
+            this->specializations[i].second();
+        this->check_specialized_temporaries(constraints, generic_buffers);
+        this->add_context_constraints(constraints);
+        this->gen_time_space_domain();
+        this->gen_isl_ast();
+        if (this->automatic_scalar_replacement)
+            this->gen_scalar_replacement_tags();
+
+        std::vector<std::pair<std::string, std::string>> generated_stmts;
+        std::vector<std::pair<std::string, Halide::Expr>> enclosing_loops;
+        Halide::Internal::Stmt specialized =
+            generator::halide_stmt_from_isl_node(*this, this->get_isl_ast(), 0, generated_stmts,
+                                                 enclosing_loops, false);
+        specialized = generator::add_alignment_checks(*this, specialized);
+
+        DEBUG(3, tiramisu::str_dump("The specialized statement is:\n"); std::cout << specialized << std::endl);
+
+        result = Halide::Internal::IfThenElse::make(condition, specialized, result);
+
+        for (const auto &name : this->streaming_store_computations)
+            streaming_computations.insert(name);
+
+        // The computations created by the schedule of the specialization
+        // (e.g. separated computations) are deleted.
+        std::unordered_set<computation *> specialization_computations;
+        for (computation *comp : this->body)
+        {
+            specialization_computations.insert(comp);
+            specialization_computations.insert(comp->updates.begin(), comp->updates.end());
+        }
+        for (computation *comp : specialization_computations)
+            if (generic_computations_set.count(comp) == 0)
+                delete comp;
+
+        // Restore the generic version.
+        this->body = generic_body;
+        this->computations_index = generic_computations_index;
+
+        for (const computation_state &state : generic_computations)
+        {
+            computation *comp = state.comp;
+            comp->name = state.name;
+            isl_set_free(comp->iteration_domain);
+            comp->iteration_domain = isl_set_copy(state.iteration_domain);
+            isl_set_free(comp->time_processor_domain);
+            comp->time_processor_domain = isl_set_copy(state.time_processor_domain);
+            isl_map_free(comp->schedule);
+            comp->schedule = isl_map_copy(state.schedule);
+            isl_map_free(comp->access);
+            comp->access = isl_map_copy(state.access);
+            comp->updates = state.updates;
+        }
+
+        this->buffers_list = generic_buffers_list;
+        for (const auto &b : generic_buffers)
+            *b.first = b.second;
+
+        this->sched_graph = generic_sched_graph;
+        this->sched_graph_reversed = generic_sched_graph_reversed;
+        this->starting_computations = generic_starting_computations;
+        this->automatically_allocated = generic_automatically_allocated;
+        this->use_low_level_scheduling_commands = generic_use_low_level_scheduling_commands;
+
+        this->parallel_dimensions = generic_parallel_dimensions;
+        this->vector_dimensions = generic_vector_dimensions;
+        this->distributed_dimensions = generic_distributed_dimensions;
+        this->gpu_block_dimensions = generic_gpu_block_dimensions;
+        this->gpu_thread_dimensions = generic_gpu_thread_dimensions;
+        this->unroll_dimensions = generic_unroll_dimensions;
+        this->parallel_dimensions_index = generic_parallel_dimensions_index;
+        this->vector_dimensions_index = generic_vector_dimensions_index;
+        this->unroll_dimensions_index = generic_unroll_dimensions_index;
+        this->vector_tails = generic_vector_tails;
+        this->prefetch_dimensions = generic_prefetch_dimensions;
+        this->scalar_replacement_dimensions = generic_scalar_replacement_dimensions;
+        this->streaming_store_computations = generic_streaming_store_computations;
+
+        isl_set_free(this->context_set);
+        this->context_set = (generic_context != NULL) ? isl_set_copy(generic_context) : NULL;
+
+        isl_ast_node_free(this->ast);
+        this->ast = generic_ast;
     }
 
-    return stmt;
+    // Keep the streaming stores of the specializations whose computations
+    // exist in the generic version.
+    for (const computation_state &state : generic_computations)
+        if (streaming_computations.count(state.name) > 0)
+            this->streaming_store_computations.insert(state.name);
 
+    for (const computation_state &state : generic_computations)
+    {
+        isl_set_free(state.iteration_domain);
+        isl_set_free(state.time_processor_domain);
+        isl_map_free(state.schedule);
+        isl_map_free(state.access);
+    }
+    isl_set_free(generic_context);
+
+    DEBUG_INDENT(-4);
+
+    return result;
 }
 
-isl_ast_node *for_code_generator_after_for(isl_ast_node *node, isl_ast_build *build, void *user)
+void function::check_specialized_temporaries(
+        const std::string &constraints,
+        const std::vector<std::pair<tiramisu::buffer *, tiramisu::buffer>> &generic_buffers) const
 {
-    return node;
+    for (const auto &b : this->buffers_list)
+    {
+        const tiramisu::buffer *buf = b.second;
+        if ((buf->get_argument_type() != tiramisu::a_temporary) || !buf->auto_allocate)
+            continue;
+
+        auto generic = std::find_if(generic_buffers.begin(), generic_buffers.end(),
+                                    [&](const std::pair<tiramisu::buffer *, tiramisu::buffer> &g) {
+                                        return g.first == buf;
+                                    });
+        if (generic == generic_buffers.end())
+            ERROR("The schedule of the specialization " + constraints + " creates the temporary buffer " +
+                  buf->get_name() + ". Temporary buffers are allocated once for all the versions of the"
+                  " function: create it before calling specialize_on(), or allocate it with"
+                  " buffer::allocate_at().", true);
+
+        const tiramisu::buffer &g = generic->second;
+        bool same_storage = (buf->get_elements_type() == g.get_elements_type()) &&
+                            (buf->get_dim_sizes().size() == g.get_dim_sizes().size()) &&
+                            (buf->get_padding() == g.get_padding()) &&
+                            (buf->get_extra_padding() == g.get_extra_padding()) &&
+                            (buf->get_alignment() == g.get_alignment());
+        for (size_t d = 0; same_storage && d < buf->get_dim_sizes().size(); d++)
+            same_storage = buf->get_dim_sizes()[d].is_equal(g.get_dim_sizes()[d]);
+
+        if (!same_storage)
+            ERROR("The schedule of the specialization " + constraints + " changes the storage (sizes, layout,"
+                  " padding or alignment) of the temporary buffer " + buf->get_name() + ". Temporary"
+                  " buffers are allocated once for all the versions of the function: change it before"
+                  " calling specialize_on(), or allocate it with buffer::allocate_at().", true);
+    }
 }
 
-/**
-  * Linearize a multidimensional access to a Halide buffer.
-  * Supposing that we have buf[N1][N2][N3], transform buf[i][j][k]
-  * into buf[k + j*N3 + i*N3*N2].
-  * Note that the first arg in index_expr is the buffer name.  The other args
-  * are the indices for each dimension of the buffer.
-  */
+void generator::check_padding_for_vector_tail(const tiramisu::function &fct, const std::string &comp_name,
+                                              int vector_length)
+{
+    for (tiramisu::computation *comp : fct.get_computation_by_name(comp_name))
+    {
+        // The buffer written by the computation and the buffers it reads.
+        std::vector<std::string> buffer_names;
+        if (comp->get_access_relation() != nullptr)
+            buffer_names.push_back(generator::get_buffer_name(comp));
 
+        std::vector<isl_map *> accesses;
+        generator::get_rhs_accesses(&fct, comp, accesses, true);
+        for (isl_map *access : accesses)
+        {
+            buffer_names.push_back(isl_map_get_tuple_name(access, isl_dim_out));
+            isl_map_free(access);
+        }
 
-static inline Halide::Expr empty_index()
-{
-    if (global::get_loop_iterator_data_type() == p_int32)
-        return Halide::Expr(static_cast<int32_t >(0));
-    else
-        return Halide::Expr(static_cast<int64_t >(0));
+        for (const auto &name : buffer_names)
+        {
+            auto buf = fct.get_buffers().find(name);
+            if (buf == fct.get_buffers().end())
+                continue;
+
+            const tiramisu::expr &size = buf->second->get_dim_sizes().back();
+            bool padded = (buf->second->get_padding() % vector_length == 0 &&
+                           buf->second->get_extra_padding() % vector_length == 0) ||
+                          (size.is_constant() && (size.get_int_val() % vector_length == 0));
+            if (!padded)
+                ERROR("The computation " + comp_name + " is vectorized by " + std::to_string(vector_length) +
+                      " with vector_tail_t::padded but the innermost dimension of the buffer " + name +
+                      " is not padded to a multiple of " + std::to_string(vector_length) +
+                      " (see buffer::set_padding()).", true);
+        }
+    }
 }
 
-Halide::Expr generator::linearize_access(int dims, const halide_dimension_t *shape, isl_ast_expr *index_expr)
+Halide::Internal::Stmt generator::add_prefetches(const tiramisu::function &fct, tiramisu::computation *comp,
+                                                 const std::vector<std::pair<std::string, Halide::Expr>> &enclosing_loops,
+                                                 const Halide::Internal::Stmt &s)
 {
-    assert(isl_ast_expr_get_op_n_arg(index_expr) > 1);
+    std::vector<std::tuple<std::string, int, int>> prefetches = fct.get_prefetches(comp->get_name());
+    if (prefetches.empty() || !s.defined())
+        return s;
 
     DEBUG_FCT_NAME(3);
     DEBUG_INDENT(4);
 
-    // ISL dimension is ordered from outermost to innermost.
-
-    Halide::Expr index {empty_index()};
-    for (int i = dims; i >= 1; --i)
+    // Collect the loads of the statement.
+    class CollectLoads : public Halide::Internal::IRVisitor
     {
-        isl_ast_expr *operand = isl_ast_expr_get_op_arg(index_expr, i);
-        Halide::Expr operand_h = halide_expr_from_isl_ast_expr(operand);
-        index += operand_h * Halide::Expr(shape[dims - i].stride);
-        isl_ast_expr_free(operand);
-    }
+        using Halide::Internal::IRVisitor::visit;
 
-    DEBUG_INDENT(-4);
+        void visit(const Halide::Internal::Load *op)
+        {
+            Halide::Internal::IRVisitor::visit(op);
+            loads.push_back(op);
+        }
 
-    return index;
-}
+    public:
+        std::vector<const Halide::Internal::Load *> loads;
+    } collect_loads;
+    s.accept(&collect_loads);
 
-Halide::Expr generator::linearize_access(int dims, const halide_dimension_t *shape, std::vector<tiramisu::expr> index_expr)
-{
-    DEBUG_FCT_NAME(3);
-    DEBUG_INDENT(4);
+    Halide::Type iterator_type = halide_type_from_tiramisu_type(global::get_loop_iterator_data_type());
+    std::vector<Halide::Internal::Stmt> prefetch_stmts;
+    std::vector<std::pair<std::string, Halide::Expr>> prefetched;
 
-    assert(index_expr.size() > 0);
+    for (const auto &pf : prefetches)
+    {
+        std::string accessed_name = std::get<0>(pf);
+        int level = std::get<1>(pf);
+        int distance = std::get<2>(pf);
 
-    // ISL dimension is ordered from outermost to innermost.
+        if (level >= (int) enclosing_loops.size())
+        {
+            ERROR("The prefetch requested for " + comp->get_name() + " at the loop level " + std::to_string(level) +
+                  " is ignored: this level does not exist in the generated code (e.g. the loop was removed"
+                  " because it has a single iteration).", false);
+            continue;
+        }
 
-    Halide::Expr index {empty_index()};
-    for (int i = dims; i >= 1; --i)
-    {
-        std::vector<isl_ast_expr *> ie = {};
-        Halide::Expr operand_h = generator::halide_expr_from_tiramisu_expr(NULL, ie, index_expr[i-1]);
-        index += operand_h * Halide::Expr(shape[dims - i].stride);
+        // Data read from a computation are read from its buffer.
+        std::string buffer_name = accessed_name;
+        std::vector<tiramisu::computation *> accessed_comps = fct.get_computation_by_name(accessed_name);
+        if (!accessed_name.empty() && !accessed_comps.empty())
+            buffer_name = generator::get_buffer_name(accessed_comps[0]);
+
+        const std::string &loop_iterator = enclosing_loops[level].first;
+
+        for (const Halide::Internal::Load *load : collect_loads.loads)
+        {
+            if (!buffer_name.empty() && load->name != buffer_name)
+                continue;
+            if (!Halide::Internal::expr_uses_var(load->index, loop_iterator))
+                continue;
+
+            Halide::Expr index = Halide::Internal::substitute(
+                    loop_iterator, Halide::Internal::Variable::make(iterator_type, loop_iterator) + distance,
+                    load->index);
+
+            // Prefetch the data used by the first lane of vectorized loops.
+            for (int l = level + 1; l < (int) enclosing_loops.size(); l++)
+                if (fct.should_vectorize(comp->get_name(), l))
+                    index = Halide::Internal::substitute(enclosing_loops[l].first,
+                                                         enclosing_loops[l].second, index);
+            index = Halide::Internal::simplify(index);
+
+            bool already_prefetched = false;
+            for (const auto &p : prefetched)
+                if (p.first == load->name && Halide::Internal::equal(p.second, index))
+                    already_prefetched = true;
+            if (already_prefetched)
+                continue;
+            prefetched.push_back(std::make_pair(load->name, index));
+
+            DEBUG(3, tiramisu::str_dump("Prefetching " + load->name + " at ");
+                     std::cout << index);
+
+            // The arguments of the prefetch intrinsic are the base address of the
+            // buffer, the index of the first element and the extent and stride of
+            // the prefetched region.
+            Halide::Expr base = Halide::Internal::Variable::make(Halide::Handle(), load->name);
+            prefetch_stmts.push_back(Halide::Internal::Evaluate::make(
+                    Halide::Internal::Call::make(load->type, Halide::Internal::Call::prefetch,
+                                                 {base, index, 1, 1},
+                                                 Halide::Internal::Call::Intrinsic)));
+        }
     }
 
+    Halide::Internal::Stmt result = s;
+    for (int i = prefetch_stmts.size() - 1; i >= 0; i--)
+        result = Halide::Internal::Block::make(prefetch_stmts[i], result);
+
     DEBUG_INDENT(-4);
 
-    return index;
+    return result;
 }
 
-Halide::Expr generator::linearize_access(int dims, std::vector<Halide::Expr> &strides, std::vector<tiramisu::expr> index_expr)
+namespace
 {
-    DEBUG_FCT_NAME(3);
-    DEBUG_INDENT(4);
 
-    assert(index_expr.size() > 0);
-
-    // ISL dimension is ordered from outermost to innermost.
+/**
+  * Unroll the loops of constant extent that are tagged to be unrolled.
+  */
+class UnrollConstantLoops : public Halide::Internal::IRMutator
+{
+    using Halide::Internal::IRMutator::visit;
 
-    Halide::Expr index {empty_index()};
-    for (int i = dims; i >= 1; --i)
+    void visit(const Halide::Internal::For *op)
     {
-        std::vector<isl_ast_expr *> ie = {};
-        Halide::Expr operand_h = generator::halide_expr_from_tiramisu_expr(NULL, ie, index_expr[i-1]);
-        index += operand_h * strides[dims - i];
+        Halide::Internal::Stmt body = mutate(op->body);
+        const int64_t *extent = Halide::Internal::as_const_int(Halide::Internal::simplify(op->extent));
+
+        if (op->for_type != Halide::Internal::ForType::Unrolled || extent == nullptr || *extent <= 0)
+        {
+            if (body.same_as(op->body))
+                stmt = op;
+            else
+                stmt = Halide::Internal::For::make(op->name, op->min, op->extent, op->for_type,
+                                                   op->device_api, body);
+            return;
+        }
+
+        stmt = Halide::Internal::Stmt();
+        for (int64_t i = *extent - 1; i >= 0; i--)
+        {
+            Halide::Internal::Stmt iteration =
+                Halide::Internal::substitute(op->name, op->min + (int) i, body);
+            stmt = stmt.defined() ? Halide::Internal::Block::make(iteration, stmt) : iteration;
+        }
     }
+};
 
-    DEBUG_INDENT(-4);
+/**
+  * Return true if \p e reads memory.
+  */
+bool contains_load(const Halide::Expr &e)
+{
+    class FindLoads : public Halide::Internal::IRVisitor
+    {
+        using Halide::Internal::IRVisitor::visit;
 
-    return index;
+        void visit(const Halide::Internal::Load *op)
+        {
+            found = true;
+        }
+
+    public:
+        bool found = false;
+    } find_loads;
+    e.accept(&find_loads);
+
+    return find_loads.found;
 }
 
-Halide::Expr generator::linearize_access(int dims, std::vector<Halide::Expr> &strides, isl_ast_expr *index_expr)
+/**
+  * The accesses of the body of a loop to one buffer, grouped by index.
+  * An element of the buffer can be promoted to a register if all the
+  * accesses to the buffer in the loop are scalar, unconditional, use an
+  * index that does not depend on the loop, and if the indices of two
+  * different groups never alias.
+  */
+struct buffer_accesses
 {
-    assert(isl_ast_expr_get_op_n_arg(index_expr) > 1);
+    std::vector<Halide::Expr> indices;
+    std::vector<Halide::Type> types;
+    std::vector<bool> stored;
+    bool promotable = true;
+};
 
-    DEBUG_FCT_NAME(3);
-    DEBUG_INDENT(4);
+/**
+  * Collect the accesses of the body of the loop over \p loop_iterator.
+  */
+class CollectLoopAccesses : public Halide::Internal::IRVisitor
+{
+    using Halide::Internal::IRVisitor::visit;
 
-    // ISL dimension is ordered from outermost to innermost.
+    /**
+      * The variables that can change from one iteration of the loop to
+      * the next: the loop iterator and the variables defined in the body.
+      */
+    std::vector<std::string> loop_variables;
+    int conditional_depth = 0;
 
-    Halide::Expr index {empty_index()};
-    for (int i = dims; i >= 1; --i)
+    bool is_invariant(const Halide::Expr &index) const
     {
-        isl_ast_expr *operand = isl_ast_expr_get_op_arg(index_expr, i);
-        Halide::Expr operand_h = halide_expr_from_isl_ast_expr(operand);
-        index += operand_h * strides[dims - i];
-        isl_ast_expr_free(operand);
+        if (contains_load(index))
+            return false;
+
+        for (const auto &v : loop_variables)
+            if (Halide::Internal::expr_uses_var(index, v))
+                return false;
+
+        return true;
     }
 
-    DEBUG_INDENT(-4);
+    void add_access(const std::string &name, const Halide::Expr &index, const Halide::Type &type,
+                    const Halide::Expr &predicate, bool store)
+    {
+        buffer_accesses &accesses = buffers[name];
+        if (!accesses.promotable)
+            return;
 
-    return index;
-}
+        if (type.lanes() != 1 || !Halide::Internal::is_one(predicate) ||
+            conditional_depth > 0 || !is_invariant(index))
+        {
+            accesses.promotable = false;
+            return;
+        }
 
-tiramisu::expr generator::linearize_access(int dims, std::vector<tiramisu::expr> &strides, std::vector<tiramisu::expr> index_expr)
-{
-    DEBUG_FCT_NAME(3);
-    DEBUG_INDENT(4);
+        Halide::Expr simplified = Halide::Internal::simplify(index);
+        for (size_t g = 0; g < accesses.indices.size(); g++)
+        {
+            if (Halide::Internal::equal(accesses.indices[g], simplified))
+            {
+                if (accesses.types[g] != type)
+                    accesses.promotable = false;
+                accesses.stored[g] = accesses.stored[g] || store;
+                return;
+            }
 
-    assert(!index_expr.empty());
+            // Two elements are only kept in two different registers if
+            // they are provably different.
+            const int64_t *distance =
+                Halide::Internal::as_const_int(Halide::Internal::simplify(accesses.indices[g] - simplified));
+            if (distance == nullptr || *distance == 0)
+            {
+                accesses.promotable = false;
+                return;
+            }
+        }
 
-    // ISL dimension is ordered from outermost to innermost.
+        accesses.indices.push_back(simplified);
+        accesses.types.push_back(type);
+        accesses.stored.push_back(store);
+    }
 
-    tiramisu::expr index = value_cast(global::get_loop_iterator_data_type(), 0);
-    auto stride = strides.rbegin();
-    auto i_expr = index_expr.begin();
-    for (;
-            stride != strides.rend() && i_expr != strides.end();
-            stride ++, i_expr ++)
+    void visit(const Halide::Internal::Load *op)
     {
-        index = index + (*stride) * (*i_expr);
+        Halide::Internal::IRVisitor::visit(op);
+        add_access(op->name, op->index, op->type, op->predicate, false);
     }
 
-    DEBUG_INDENT(-4);
+    void visit(const Halide::Internal::Store *op)
+    {
+        Halide::Internal::IRVisitor::visit(op);
+        add_access(op->name, op->index, op->value.type(), op->predicate, true);
+    }
 
-    return index;
-}
+    void visit(const Halide::Internal::Variable *op)
+    {
+        used_names.insert(op->name);
+    }
 
-tiramisu::expr generator::linearize_access(int dims, std::vector<tiramisu::expr> &strides, isl_ast_expr *index_expr)
-{
-    assert(isl_ast_expr_get_op_n_arg(index_expr) > 1);
+    void visit(const Halide::Internal::Call *op)
+    {
+        used_names.insert(op->name);
 
-    DEBUG_FCT_NAME(3);
-    DEBUG_INDENT(4);
+        if (op->is_intrinsic(Halide::Internal::Call::address_of))
+        {
+            const Halide::Internal::Load *load = op->args[0].as<Halide::Internal::Load>();
+            if (load != nullptr)
+                used_names.insert(load->name);
+        }
 
-    // ISL dimension is ordered from outermost to innermost.
+        Halide::Internal::IRVisitor::visit(op);
+    }
 
-    tiramisu::expr index = value_cast(global::get_loop_iterator_data_type(), 0);
-    for (int i = dims; i >= 1; --i)
+    void visit(const Halide::Internal::Allocate *op)
     {
-        isl_ast_expr *operand = isl_ast_expr_get_op_arg(index_expr, i);
-        tiramisu::expr operand_h = tiramisu_expr_from_isl_ast_expr(operand);
-        index = index + operand_h * strides[dims - i];
-        isl_ast_expr_free(operand);
+        // Buffers allocated in the loop are not promoted.
+        used_names.insert(op->name);
+        Halide::Internal::IRVisitor::visit(op);
     }
 
-    DEBUG_INDENT(-4);
+    void visit(const Halide::Internal::IfThenElse *op)
+    {
+        op->condition.accept(this);
+        conditional_depth++;
+        op->then_case.accept(this);
+        if (op->else_case.defined())
+            op->else_case.accept(this);
+        conditional_depth--;
+    }
 
-    return index;
-}
+    void visit(const Halide::Internal::For *op)
+    {
+        loop_variables.push_back(op->name);
+        Halide::Internal::IRVisitor::visit(op);
+        loop_variables.pop_back();
+    }
 
-std::string generator::get_buffer_name(const tiramisu::computation * comp)
-{
-    isl_map *access = comp->get_access_relation_adapted_to_time_processor_domain();
-    isl_space *space = isl_map_get_space(access);
-    const char *buffer_name = isl_space_get_tuple_name(space, isl_dim_out);
-    std::cerr << comp->get_name() << std::endl;
-    isl_map_dump(access);
-    assert(buffer_name != nullptr);
-    return std::string{buffer_name};
-}
+    void visit(const Halide::Internal::LetStmt *op)
+    {
+        loop_variables.push_back(op->name);
+        Halide::Internal::IRVisitor::visit(op);
+        loop_variables.pop_back();
+    }
 
-tiramisu::expr generator::comp_to_buffer(tiramisu::computation *comp, std::vector<isl_ast_expr *> &index_expr,
-                                         const tiramisu::expr *expr)
-{
-    auto buffer_name = generator::get_buffer_name(comp);
+    void visit(const Halide::Internal::Let *op)
+    {
+        loop_variables.push_back(op->name);
+        Halide::Internal::IRVisitor::visit(op);
+        loop_variables.pop_back();
+    }
 
-    DEBUG(3, tiramisu::str_dump("Buffer name extracted from the access relation: ", buffer_name.c_str()));
+public:
+    std::map<std::string, buffer_accesses> buffers;
 
-    isl_map *access = comp->get_access_relation_adapted_to_time_processor_domain();
-    isl_space *space = isl_map_get_space(access);
+    /**
+      * The names used in the loop other than in loads and stores (variables,
+      * calls, addresses and allocations).
+      */
+    std::unordered_set<std::string> used_names;
 
-    // Get the number of dimensions of the ISL map representing
-    // the access.
-    int access_dims = isl_space_dim(space, isl_dim_out);
+    CollectLoopAccesses(const std::string &loop_iterator) : loop_variables({loop_iterator}) {}
 
-    // Fetch the actual buffer.
-    const auto &buffer_entry = comp->get_function()->get_buffers().find(buffer_name);
-    assert(buffer_entry != comp->get_function()->get_buffers().end());
+    /**
+      * Return true if the buffer \p name is used other than through loads
+      * and stores (e.g. its address is passed to a function).
+      */
+    bool escapes(const std::string &name) const
+    {
+        for (const auto &used : used_names)
+            if (used == name || used.compare(0, name.size() + 1, name + ".") == 0)
+                return true;
 
-    const auto &tiramisu_buffer = buffer_entry->second;
-    DEBUG(3, tiramisu::str_dump("A Tiramisu buffer that corresponds to the buffer indicated in the access relation was found."));
+        return false;
+    }
+};
 
-    DEBUG(10, tiramisu_buffer->dump(true));
+/**
+  * Replace the accesses to the promoted elements with accesses to their
+  * registers. \p scalars maps each buffer to the indices of its promoted
+  * elements and to the names of the corresponding registers.
+  */
+class ReplaceWithScalars : public Halide::Internal::IRMutator
+{
+    using Halide::Internal::IRMutator::visit;
+
+    const std::map<std::string, std::vector<std::pair<Halide::Expr, std::string>>> &scalars;
+
+    const std::string *find_scalar(const std::string &name, const Halide::Expr &index) const
+    {
+        auto buffer = scalars.find(name);
+        if (buffer == scalars.end())
+            return nullptr;
+
+        Halide::Expr simplified = Halide::Internal::simplify(index);
+        for (const auto &scalar : buffer->second)
+            if (Halide::Internal::equal(scalar.first, simplified))
+                return &scalar.second;
+
+        return nullptr;
+    }
+
+    void visit(const Halide::Internal::Load *op)
+    {
+        const std::string *scalar = find_scalar(op->name, op->index);
+        Halide::Internal::IRMutator::visit(op);
+        if (scalar != nullptr)
+            expr = Halide::Internal::Load::make(op->type, *scalar, Halide::Expr(0), Halide::Buffer<>(),
+                                                Halide::Internal::Parameter(), op->predicate);
+    }
+
+    void visit(const Halide::Internal::Store *op)
+    {
+        const std::string *scalar = find_scalar(op->name, op->index);
+        Halide::Internal::IRMutator::visit(op);
+        if (scalar != nullptr)
+        {
+            op = stmt.as<Halide::Internal::Store>();
+            stmt = Halide::Internal::Store::make(*scalar, op->value, Halide::Expr(0), Halide::Internal::Parameter(),
+                                                 op->predicate);
+        }
+    }
+
+public:
+    ReplaceWithScalars(const std::map<std::string, std::vector<std::pair<Halide::Expr, std::string>>> &scalars)
+        : scalars(scalars) {}
+};
+
+/**
+  * The buffers loaded, stored and used (by any mean, e.g. passed to a
+  * function) in a statement. Used by the memory planner to compute the
+  * live ranges of the temporary buffers.
+  */
+class CollectBufferUses : public Halide::Internal::IRVisitor
+{
+    using Halide::Internal::IRVisitor::visit;
+
+    static std::string buffer_name(const std::string &name)
+    {
+        const std::string suffix = ".buffer";
+        if (name.size() > suffix.size() &&
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+            return name.substr(0, name.size() - suffix.size());
+
+        return name;
+    }
+
+    void visit(const Halide::Internal::Load *op)
+    {
+        loaded.insert(op->name);
+        used.insert(op->name);
+        Halide::Internal::IRVisitor::visit(op);
+    }
+
+    void visit(const Halide::Internal::Store *op)
+    {
+        stored.insert(op->name);
+        used.insert(op->name);
+        Halide::Internal::IRVisitor::visit(op);
+    }
+
+    void visit(const Halide::Internal::Variable *op)
+    {
+        std::string name = buffer_name(op->name);
+        used.insert(name);
+        if (name != op->name)
+            used_as_halide_buffer.insert(name);
+    }
+
+public:
+    std::unordered_set<std::string> loaded;
+    std::unordered_set<std::string> stored;
+    std::unordered_set<std::string> used;
+
+    /**
+      * The buffers whose halide_buffer_t is used (e.g. passed to an
+      * external function). They cannot be placed in an arena.
+      */
+    std::unordered_set<std::string> used_as_halide_buffer;
+};
+
+/**
+  * Append to \p sequences the sequences of statements executed one after
+  * the other at the root of \p s. The two branches of the conditionals
+  * at the root of \p s (alignment checks and specializations) are
+  * separate sequences.
+  */
+void get_root_sequences(const Halide::Internal::Stmt &s,
+                        std::vector<std::vector<Halide::Internal::Stmt>> &sequences)
+{
+    const Halide::Internal::IfThenElse *branch = s.as<Halide::Internal::IfThenElse>();
+    if (branch != nullptr)
+    {
+        get_root_sequences(branch->then_case, sequences);
+        if (branch->else_case.defined())
+            get_root_sequences(branch->else_case, sequences);
+        return;
+    }
+
+    std::vector<Halide::Internal::Stmt> sequence;
+    std::vector<Halide::Internal::Stmt> to_visit = {s};
+    while (!to_visit.empty())
+    {
+        Halide::Internal::Stmt current = to_visit.back();
+        to_visit.pop_back();
+
+        const Halide::Internal::Block *block = current.as<Halide::Internal::Block>();
+        if (block != nullptr)
+        {
+            if (block->rest.defined())
+                to_visit.push_back(block->rest);
+            to_visit.push_back(block->first);
+        }
+        else
+            sequence.push_back(current);
+    }
+    sequences.push_back(sequence);
+}
+
+} // anonymous namespace
+
+Halide::Internal::Stmt generator::scalar_replace_invariant_accesses(const Halide::Internal::Stmt &s,
+                                                                    bool promote_read_only)
+{
+    const Halide::Internal::For *loop = s.as<Halide::Internal::For>();
+    if (loop == nullptr || loop->for_type != Halide::Internal::ForType::Serial)
+        return s;
+
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    Halide::Internal::Stmt body = UnrollConstantLoops().mutate(loop->body);
+
+    CollectLoopAccesses collect(loop->name);
+    body.accept(&collect);
+
+    std::map<std::string, std::vector<std::pair<Halide::Expr, std::string>>> scalars;
+    std::vector<std::pair<std::string, Halide::Type>> registers;
+    std::vector<Halide::Internal::Stmt> loads_before;
+    std::vector<Halide::Internal::Stmt> stores_after;
+
+    for (const auto &b : collect.buffers)
+    {
+        const buffer_accesses &accesses = b.second;
+        if (!accesses.promotable || collect.escapes(b.first))
+            continue;
+
+        // Unless requested, only the buffers written in the loop are
+        // promoted: the invariant loads from read-only buffers are hoisted
+        // by LLVM.
+        bool stored = false;
+        for (bool st : accesses.stored)
+            stored = stored || st;
+        if (!stored && !promote_read_only)
+            continue;
+
+        for (size_t g = 0; g < accesses.indices.size(); g++)
+        {
+            std::string scalar = Halide::Internal::unique_name(b.first + "_scalar");
+            const Halide::Type &type = accesses.types[g];
+            const Halide::Expr &index = accesses.indices[g];
+
+            DEBUG(3, tiramisu::str_dump("Promoting " + b.first + " at index ");
+                     std::cout << index << " to the register " << scalar << std::endl);
+
+            scalars[b.first].push_back(std::make_pair(index, scalar));
+            registers.push_back(std::make_pair(scalar, type));
+
+            loads_before.push_back(Halide::Internal::Store::make(
+                    scalar,
+                    Halide::Internal::Load::make(type, b.first, index, Halide::Buffer<>(),
+                                                 Halide::Internal::Parameter(), Halide::Internal::const_true()),
+                    Halide::Expr(0), Halide::Internal::Parameter(), Halide::Internal::const_true()));
+
+            if (accesses.stored[g])
+                stores_after.push_back(Halide::Internal::Store::make(
+                        b.first,
+                        Halide::Internal::Load::make(type, scalar, Halide::Expr(0), Halide::Buffer<>(),
+                                                     Halide::Internal::Parameter(), Halide::Internal::const_true()),
+                        index, Halide::Internal::Parameter(), Halide::Internal::const_true()));
+        }
+    }
+
+    if (scalars.empty())
+    {
+        DEBUG(3, tiramisu::str_dump("No access to promote in the loop " + loop->name));
+        DEBUG_INDENT(-4);
+        return s;
+    }
+
+    Halide::Internal::Stmt result =
+        Halide::Internal::For::make(loop->name, loop->min, loop->extent, loop->for_type, loop->device_api,
+                                    ReplaceWithScalars(scalars).mutate(body));
+
+    for (const auto &st : stores_after)
+        result = Halide::Internal::Block::make(result, st);
+    for (int i = loads_before.size() - 1; i >= 0; i--)
+        result = Halide::Internal::Block::make(loads_before[i], result);
+
+    // The promoted elements must not be accessed if the loop does not run.
+    result = Halide::Internal::IfThenElse::make(loop->extent > 0, result);
+
+    // Registers are allocations of one element: they are allocated on the
+    // stack and promoted to registers by LLVM.
+    for (const auto &r : registers)
+        result = Halide::Internal::Allocate::make(r.first, r.second, {Halide::Expr(1)},
+                                                  Halide::Internal::const_true(), result);
+
+    DEBUG(10, tiramisu::str_dump("Loop after scalar replacement: "); std::cout << result);
+
+    DEBUG_INDENT(-4);
+
+    return result;
+}
+
+Halide::Internal::Stmt generator::add_alignment_checks(const tiramisu::function &fct,
+                                                       const Halide::Internal::Stmt &s)
+{
+    // The aligned arguments and the parameters that carry their alignment.
+    std::map<std::string, Halide::Internal::Parameter> aligned_params;
+    Halide::Expr aligned;
+
+    for (tiramisu::buffer *b : fct.get_arguments())
+    {
+        Halide::Type type = halide_type_from_tiramisu_type(b->get_elements_type());
+        if ((b->get_alignment() <= type.bytes()) || (b->location != cuda_ast::memory_location::host))
+            continue;
+
+        Halide::Internal::Parameter param(type, true, b->get_n_dims(), b->get_name());
+        param.set_host_alignment(b->get_alignment());
+        aligned_params[b->get_name()] = param;
+
+        // The variable named after the buffer is its host pointer.
+        Halide::Expr host = Halide::reinterpret(Halide::UInt(64),
+                                                Halide::Internal::Variable::make(Halide::Handle(), b->get_name()));
+        Halide::Expr condition = (host % b->get_alignment()) == 0;
+        aligned = aligned.defined() ? (aligned && condition) : condition;
+    }
+
+    if (aligned_params.empty() || !s.defined())
+        return s;
+
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    // Halide derives the alignment of the accesses to a buffer argument
+    // from the host alignment of the parameter of the access.
+    class SetHostAlignment : public Halide::Internal::IRMutator
+    {
+        using Halide::Internal::IRMutator::visit;
+
+        const std::map<std::string, Halide::Internal::Parameter> &params;
+
+        void visit(const Halide::Internal::Load *op)
+        {
+            Halide::Internal::IRMutator::visit(op);
+            auto param = params.find(op->name);
+            if (param != params.end())
+            {
+                op = expr.as<Halide::Internal::Load>();
+                expr = Halide::Internal::Load::make(op->type, op->name, op->index, op->image,
+                                                    param->second, op->predicate);
+            }
+        }
+
+        void visit(const Halide::Internal::Store *op)
+        {
+            Halide::Internal::IRMutator::visit(op);
+            auto param = params.find(op->name);
+            if (param != params.end())
+            {
+                op = stmt.as<Halide::Internal::Store>();
+                stmt = Halide::Internal::Store::make(op->name, op->value, op->index, param->second,
+                                                     op->predicate);
+            }
+        }
+
+    public:
+        SetHostAlignment(const std::map<std::string, Halide::Internal::Parameter> &params) : params(params) {}
+    };
+
+    DEBUG(3, tiramisu::str_dump("Checking the alignment of the arguments: "); std::cout << aligned << std::endl);
+
+    Halide::Internal::Stmt result =
+        Halide::Internal::IfThenElse::make(aligned, SetHostAlignment(aligned_params).mutate(s), s);
+
+    DEBUG_INDENT(-4);
+
+    return result;
+}
+
+bool generator::uses_thread_arena(buffer *b)
+{
+    if (b->location != cuda_ast::memory_location::host)
+        return false;
+
+    if (b->get_alignment() > 0 || !b->has_constant_extents())
+        return true;
+
+    // Halide allocates on the stack the allocations of constant size up
+    // to 16 KiB, and hoists them out of the loops.
+    int64_t size = halide_type_from_tiramisu_type(b->get_elements_type()).bytes();
+    for (const auto &extent : b->get_dim_sizes())
+        size *= extent.get_int_val();
+
+    return size > 16 * 1024;
+}
+
+Halide::Internal::Stmt generator::make_buffer_alloc(buffer *b, const std::vector<Halide::Expr> &extents,
+                                                    Halide::Internal::Stmt &stmt, bool in_loop) {
+    using cuda_ast::memory_location;
+    auto h_type = halide_type_from_tiramisu_type(b->get_elements_type());
+    if (b->location == memory_location::host && in_loop && generator::uses_thread_arena(b))
+    {
+        // Buffers allocated inside loops are allocated in the arena of the
+        // thread instead of calling malloc and free at each iteration. They
+        // are released at the end of the scope of their allocation.
+        Halide::Expr size = Halide::Internal::make_const(Halide::UInt(64), h_type.bytes());
+        for (const auto &extent : extents)
+            size = size * Halide::cast(Halide::UInt(64), extent);
+
+        Halide::Expr ptr = Halide::Internal::Call::make(
+                Halide::Handle(), "tiramisu_thread_arena_malloc",
+                {size, Halide::Internal::make_const(Halide::UInt(64), std::max(b->get_alignment(), 128))},
+                Halide::Internal::Call::Extern);
+        Halide::Internal::Stmt free = Halide::Internal::Evaluate::make(
+                Halide::Internal::Call::make(Halide::Int(32), "tiramisu_thread_arena_free",
+                                             {Halide::Internal::Variable::make(Halide::Handle(), b->get_name())},
+                                             Halide::Internal::Call::Extern));
+
+        return Halide::Internal::LetStmt::make(b->get_name(), ptr, Halide::Internal::Block::make(stmt, free));
+    }
+    else if (b->location == memory_location::host)
+    {
+        if (b->get_alignment() > 0)
+        {
+            // Allocate the buffer with the alignment requested by the user.
+            // Like GPU buffers, the buffer is a pointer bound by a let
+            // statement and it is freed at the end of its scope.
+            Halide::Expr size = Halide::Internal::make_const(Halide::UInt(64), h_type.bytes());
+            for (const auto &extent : extents)
+                size = size * Halide::cast(Halide::UInt(64), extent);
+
+            Halide::Expr ptr = Halide::Internal::Call::make(
+                    Halide::Handle(), "tiramisu_aligned_malloc",
+                    {size, Halide::Internal::make_const(Halide::UInt(64), b->get_alignment())},
+                    Halide::Internal::Call::Extern);
+            Halide::Internal::Stmt free = Halide::Internal::Evaluate::make(
+                    Halide::Internal::Call::make(Halide::Int(32), "tiramisu_aligned_free",
+                                                 {Halide::Internal::Variable::make(Halide::Handle(), b->get_name())},
+                                                 Halide::Internal::Call::Extern));
+
+            return Halide::Internal::LetStmt::make(b->get_name(), ptr,
+                                                   Halide::Internal::Block::make(stmt, free));
+        }
+
+        return Halide::Internal::Allocate::make(
+                b->get_name(),
+                h_type,
+                extents, Halide::Internal::const_true(), stmt);
+    }
+    else if (b->location == memory_location::global)
+    {
+        Halide::Expr size = extents[0];
+        for (int  i = 1; i < extents.size(); i++)
+        {
+            size = size * extents[i];
+        }
+        return Halide::Internal::LetStmt::make(
+                b->get_name(),
+                Halide::Internal::Call::make(Halide::type_of<void *>(), "tiramisu_cuda_malloc",
+                                             {Halide::cast(Halide::UInt(64), size * h_type.bytes())}, Halide::Internal::Call::Extern),
+                stmt
+        );
+
+    }
+
+    return stmt;
+
+}
+
+bool function::can_write_in_place(const buffer *src, const buffer *dst,
+                                  const std::unordered_set<std::string> &concurrent_buffers) const
+{
+    if (src->get_elements_type() != dst->get_elements_type() ||
+        src->get_dim_sizes().size() != dst->get_dim_sizes().size())
+        return false;
+
+    for (size_t i = 0; i < src->get_dim_sizes().size(); i++)
+        if (!src->get_dim_sizes()[i].is_equal(dst->get_dim_sizes()[i]))
+            return false;
+
+    // An element of src can be overwritten by an element of dst if the
+    // only instance that reads it is the instance that writes the element
+    // of dst at the same address: each computation that writes into dst
+    // reads src exactly where it writes, no two instances write the same
+    // element of dst, and no other computation of the loop nest reads src.
+    isl_union_map *writes = NULL;
+    bool in_place = true;
+
+    // Compute in result the accesses of the right hand side of comp to src
+    // (from the iteration domain of comp to src), or NULL if comp does not
+    // read src. Return false if the accesses cannot be computed.
+    auto get_src_reads = [&](const computation *comp, isl_map **result) -> bool
+    {
+        std::vector<isl_map *> accesses;
+        generator::get_rhs_accesses(this, comp, accesses, false);
+
+        *result = NULL;
+        bool analyzable = true;
+        for (isl_map *access : accesses)
+        {
+            const char *producer_name = isl_map_get_tuple_name(access, isl_dim_out);
+            std::vector<computation *> producers;
+            if (producer_name != NULL)
+                producers = this->get_computation_by_name(producer_name);
+            if (producers.empty())
+                analyzable = false;
+
+            for (const computation *producer : producers)
+            {
+                isl_map *producer_access = producer->get_access_relation();
+                if (producer_access == NULL ||
+                    isl_map_dim(producer_access, isl_dim_in) != isl_map_dim(access, isl_dim_out))
+                {
+                    analyzable = false;
+                    continue;
+                }
+                const char *producer_buffer = isl_map_get_tuple_name(producer_access, isl_dim_out);
+                if (producer_buffer == NULL || producer_buffer != src->get_name())
+                    continue;
+
+                isl_map *buffer_access = isl_map_apply_range(isl_map_copy(access), isl_map_copy(producer_access));
+                *result = (*result == NULL) ? buffer_access : isl_map_union(*result, buffer_access);
+            }
+            isl_map_free(access);
+        }
+
+        return analyzable;
+    };
+
+    for (const computation *comp : this->get_computations())
+    {
+        isl_map *access = comp->get_access_relation();
+        if (access == NULL || !comp->should_schedule_this_computation())
+            continue;
+
+        const char *written = isl_map_get_tuple_name(access, isl_dim_out);
+        isl_map *reads = NULL;
+        bool analyzable = get_src_reads(comp, &reads);
+
+        if (written == NULL || written != dst->get_name())
+        {
+            bool may_read_src = (reads != NULL) || !analyzable;
+            isl_map_free(reads);
+            if (may_read_src && (written == NULL || concurrent_buffers.count(written) > 0))
+            {
+                in_place = false;
+                break;
+            }
+            continue;
+        }
+
+        if (!analyzable || reads == NULL)
+        {
+            isl_map_free(reads);
+            in_place = false;
+            break;
+        }
+
+        // The reads access src and the write accesses dst: compare the
+        // accessed elements under the name of dst.
+        isl_set *domain = isl_set_copy(comp->get_iteration_domain());
+        isl_map *write = isl_map_intersect_domain(isl_map_copy(access), isl_set_copy(domain));
+        reads = isl_map_intersect_domain(reads, domain);
+        reads = isl_map_set_tuple_name(reads, isl_dim_out, dst->get_name().c_str());
+        bool same_elements = (isl_map_is_equal(reads, write) == isl_bool_true);
+        isl_map_free(reads);
+        if (!same_elements)
+        {
+            isl_map_free(write);
+            in_place = false;
+            break;
+        }
+
+        writes = (writes == NULL) ? isl_union_map_from_map(write)
+                                  : isl_union_map_union(writes, isl_union_map_from_map(write));
+    }
+
+    in_place = in_place && (writes != NULL) && (isl_union_map_is_injective(writes) == isl_bool_true);
+    isl_union_map_free(writes);
+
+    return in_place;
+}
+
+Halide::Internal::Stmt function::plan_temporary_buffers(const Halide::Internal::Stmt &s,
+                                                        std::unordered_set<std::string> &planned)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    if (!this->memory_planning)
+    {
+        DEBUG_INDENT(-4);
+        return s;
+    }
+
+    // The buffers that the planner can place: temporary host buffers that
+    // are allocated by Tiramisu, except the buffers that native storage
+    // folding folds (they are smaller than their slot in the arena).
+    std::vector<buffer *> candidates;
+    for (const auto &b : this->get_buffers())
+    {
+        buffer *buf = b.second;
+        if (buf->get_argument_type() != tiramisu::a_temporary || !buf->get_auto_allocate() ||
+            buf->location != cuda_ast::memory_location::host || buf->get_dim_sizes().empty())
+            continue;
+
+        if (this->native_storage_folding)
+        {
+            std::vector<Halide::Expr> extents;
+            for (int i = buf->get_dim_sizes().size() - 1; i >= 0; --i)
+            {
+                std::vector<isl_ast_expr *> ie = {};
+                extents.push_back(generator::halide_expr_from_tiramisu_expr(this, ie, buf->get_dim_sizes()[i]));
+            }
+            if (can_fold_storage(buf->get_name(), halide_type_from_tiramisu_type(buf->get_elements_type()),
+                                 extents, s))
+            {
+                DEBUG(3, tiramisu::str_dump("Not planning " + buf->get_name() + ": its storage is folded."));
+                continue;
+            }
+        }
+
+        candidates.push_back(buf);
+    }
+
+    // Compute the live range of each candidate in each sequence of loop
+    // nests at the root of the function: the index of the first and of
+    // the last loop nest that use the buffer.
+    std::vector<std::vector<Halide::Internal::Stmt>> sequences;
+    get_root_sequences(s, sequences);
+
+    std::vector<std::vector<CollectBufferUses>> uses(sequences.size());
+    for (size_t q = 0; q < sequences.size(); q++)
+        for (const auto &item : sequences[q])
+        {
+            uses[q].push_back(CollectBufferUses());
+            item.accept(&uses[q].back());
+        }
+
+    struct live_range
+    {
+        int first = -1;
+        int last = -1;
+    };
+    std::vector<std::vector<live_range>> ranges(candidates.size(), std::vector<live_range>(sequences.size()));
+    std::vector<buffer *> used_candidates;
+    std::vector<std::vector<live_range>> used_ranges;
+    for (size_t c = 0; c < candidates.size(); c++)
+    {
+        bool used = false;
+        bool opaque = false;
+        for (size_t q = 0; q < sequences.size(); q++)
+            for (int k = 0; k < (int) uses[q].size(); k++)
+                if (uses[q][k].used.count(candidates[c]->get_name()) > 0)
+                {
+                    opaque = opaque || (uses[q][k].used_as_halide_buffer.count(candidates[c]->get_name()) > 0);
+                    if (ranges[c][q].first < 0)
+                        ranges[c][q].first = k;
+                    ranges[c][q].last = k;
+                    used = true;
+                }
+
+        if (used && !opaque)
+        {
+            used_candidates.push_back(candidates[c]);
+            used_ranges.push_back(ranges[c]);
+        }
+    }
+    candidates = used_candidates;
+    ranges = used_ranges;
+
+    if (candidates.size() < 2)
+    {
+        DEBUG(3, tiramisu::str_dump("Less than two temporary buffers, no memory planning."));
+        DEBUG_INDENT(-4);
+        return s;
+    }
+
+    const int n = candidates.size();
+    auto interfere = [&](int a, int b) -> bool
+    {
+        for (size_t q = 0; q < sequences.size(); q++)
+            if (ranges[a][q].first >= 0 && ranges[b][q].first >= 0 &&
+                ranges[a][q].first <= ranges[b][q].last && ranges[b][q].first <= ranges[a][q].last)
+                return true;
+        return false;
+    };
+
+    // The buffer b can reuse the storage of a in place if a is last used
+    // in the loop nest where b is first used, if the loop nest reads a and
+    // writes b only (in every sequence that uses both), and if the access
+    // relations show that each element of a is read by the instance that
+    // overwrites it.
+    auto in_place_candidate = [&](int a, int b) -> bool
+    {
+        bool common = false;
+        for (size_t q = 0; q < sequences.size(); q++)
+        {
+            if (ranges[a][q].first < 0 && ranges[b][q].first < 0)
+                continue;
+            if (ranges[a][q].first < 0 || ranges[b][q].first < 0)
+                return false;
+
+            int k = ranges[a][q].last;
+            if (ranges[b][q].first != k || ranges[a][q].first == k ||
+                uses[q][k].stored.count(candidates[a]->get_name()) > 0 ||
+                uses[q][k].loaded.count(candidates[b]->get_name()) > 0)
+                return false;
+
+            common = true;
+        }
+        if (!common)
+            return false;
+
+        std::unordered_set<std::string> concurrent_buffers;
+        for (size_t q = 0; q < sequences.size(); q++)
+            if (ranges[a][q].first >= 0)
+                for (const auto &name : uses[q][ranges[a][q].last].stored)
+                    concurrent_buffers.insert(name);
+
+        return this->can_write_in_place(candidates[a], candidates[b], concurrent_buffers);
+    };
+
+    // The size of each buffer in bytes, rounded up so that the offset of
+    // each buffer in the arena keeps the alignment of the arena.
+    uint64_t alignment = 128;
+    for (const buffer *buf : candidates)
+        alignment = std::max(alignment, (uint64_t) buf->get_alignment());
+
+    std::vector<Halide::Expr> sizes;
+    bool constant_sizes = true;
+    for (const buffer *buf : candidates)
+    {
+        Halide::Expr size = Halide::Internal::make_const(
+                Halide::UInt(64), halide_type_from_tiramisu_type(buf->get_elements_type()).bytes());
+        for (const auto &sz : buf->get_dim_sizes())
+        {
+            std::vector<isl_ast_expr *> ie = {};
+            size = size * Halide::cast(Halide::UInt(64),
+                                       generator::halide_expr_from_tiramisu_expr(this, ie, sz));
+        }
+        Halide::Expr rounding = Halide::Internal::make_const(Halide::UInt(64), alignment);
+        size = Halide::Internal::simplify((size + rounding - 1) / rounding * rounding);
+        constant_sizes = constant_sizes && (Halide::Internal::as_const_uint(size) != nullptr);
+        sizes.push_back(size);
+    }
+
+    // Place the buffers in the arena by order of first use. With constant
+    // sizes, a buffer takes the first offset that does not overlap a
+    // buffer live at the same time (or the offset of the buffer it can
+    // overwrite in place). Otherwise, a buffer is placed after all the
+    // buffers that are live at the same time.
+    std::vector<std::pair<size_t, int>> first_use(n);
+    for (int c = 0; c < n; c++)
+    {
+        size_t q = 0;
+        while (ranges[c][q].first < 0)
+            q++;
+        first_use[c] = std::make_pair(q, ranges[c][q].first);
+    }
+    std::vector<int> order(n);
+    for (int c = 0; c < n; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return first_use[a] < first_use[b]; });
+
+    std::vector<Halide::Expr> offsets(n);
+    std::vector<int> in_place_of(n, -1);
+    std::vector<int> placed;
+    for (int c : order)
+    {
+        if (constant_sizes)
+        {
+            uint64_t size = *Halide::Internal::as_const_uint(sizes[c]);
+            auto overlaps = [&](uint64_t offset, int ignored) -> bool
+            {
+                for (int p : placed)
+                {
+                    if (p == ignored)
+                        continue;
+                    uint64_t p_offset = *Halide::Internal::as_const_uint(offsets[p]);
+                    uint64_t p_size = *Halide::Internal::as_const_uint(sizes[p]);
+                    if (interfere(c, p) && offset < p_offset + p_size && p_offset < offset + size)
+                        return true;
+                }
+                return false;
+            };
+
+            bool done = false;
+            for (int p : placed)
+                if (in_place_candidate(p, c))
+                {
+                    uint64_t offset = *Halide::Internal::as_const_uint(offsets[p]);
+                    if (!overlaps(offset, p))
+                    {
+                        offsets[c] = Halide::Internal::make_const(Halide::UInt(64), offset);
+                        in_place_of[c] = p;
+                        done = true;
+                        break;
+                    }
+                }
+
+            if (!done)
+            {
+                // First fit: the candidate offsets are 0 and the ends of
+                // the buffers placed so far.
+                std::vector<uint64_t> candidate_offsets = {0};
+                for (int p : placed)
+                    candidate_offsets.push_back(*Halide::Internal::as_const_uint(offsets[p]) +
+                                                *Halide::Internal::as_const_uint(sizes[p]));
+                std::sort(candidate_offsets.begin(), candidate_offsets.end());
+                for (uint64_t offset : candidate_offsets)
+                    if (!overlaps(offset, -1))
+                    {
+                        offsets[c] = Halide::Internal::make_const(Halide::UInt(64), offset);
+                        break;
+                    }
+            }
+        }
+        else
+        {
+            Halide::Expr offset = Halide::Internal::make_const(Halide::UInt(64), 0);
+            for (int p : placed)
+                if (interfere(c, p))
+                    offset = Halide::max(offset, offsets[p] + sizes[p]);
+            offsets[c] = Halide::Internal::simplify(offset);
+        }
+        placed.push_back(c);
+    }
+
+    Halide::Expr arena_size = Halide::Internal::make_const(Halide::UInt(64), 0);
+    Halide::Expr unplanned_size = Halide::Internal::make_const(Halide::UInt(64), 0);
+    for (int c = 0; c < n; c++)
+    {
+        arena_size = Halide::max(arena_size, offsets[c] + sizes[c]);
+        unplanned_size = unplanned_size + sizes[c];
+    }
+    arena_size = Halide::Internal::simplify(arena_size);
+
+    DEBUG(3, tiramisu::str_dump("Memory plan of the temporary buffers:"));
+    for (int c = 0; c < n; c++)
+    {
+        DEBUG(3, tiramisu::str_dump("  " + candidates[c]->get_name() + ": offset ");
+                 std::cout << offsets[c] << ", size " << sizes[c];
+                 if (in_place_of[c] >= 0)
+                     std::cout << " (in place of " << candidates[in_place_of[c]]->get_name() << ")";
+                 std::cout << std::endl);
+    }
+    DEBUG(3, tiramisu::str_dump("Arena size: "); std::cout << arena_size << " bytes instead of "
+             << Halide::Internal::simplify(unplanned_size) << " bytes" << std::endl);
+
+    // Bind each buffer to its address in the arena, then allocate the arena.
+    const std::string arena_name = "_" + this->get_name() + "_arena";
+    Halide::Expr arena = Halide::Internal::Variable::make(Halide::Handle(), arena_name);
+
+    Halide::Internal::Stmt result = s;
+    for (int c = n - 1; c >= 0; c--)
+    {
+        result = Halide::Internal::LetStmt::make(
+                candidates[c]->get_name(),
+                Halide::Internal::Call::make(Halide::Handle(), "tiramisu_arena_address",
+                                             {arena, offsets[c]}, Halide::Internal::Call::Extern),
+                result);
+        planned.insert(candidates[c]->get_name());
+    }
+
+    Halide::Internal::Stmt free = Halide::Internal::Evaluate::make(
+            Halide::Internal::Call::make(Halide::Int(32), "tiramisu_aligned_free", {arena},
+                                         Halide::Internal::Call::Extern));
+    result = Halide::Internal::LetStmt::make(
+            arena_name,
+            Halide::Internal::Call::make(Halide::Handle(), "tiramisu_aligned_malloc",
+                                         {arena_size, Halide::Internal::make_const(Halide::UInt(64), alignment)},
+                                         Halide::Internal::Call::Extern),
+            Halide::Internal::Block::make(result, free));
+
+    DEBUG_INDENT(-4);
+
+    return result;
+}
+
+isl_ast_node *for_code_generator_after_for(isl_ast_node *node, isl_ast_build *build, void *user)
+{
+    return node;
+}
+
+/**
+  * Linearize a multidimensional access to a Halide buffer.
+  * Supposing that we have buf[N1][N2][N3], transform buf[i][j][k]
+  * into buf[k + j*N3 + i*N3*N2].
+  * Note that the first arg in index_expr is the buffer name.  The other args
+  * are the indices for each dimension of the buffer.
+  */
+
+
+static inline Halide::Expr empty_index()
+{
+    if (global::get_loop_iterator_data_type() == p_int32)
+        return Halide::Expr(static_cast<int32_t >(0));
+    else
+        return Halide::Expr(static_cast<int64_t >(0));
+}
+
+Halide::Expr generator::linearize_access(int dims, const halide_dimension_t *shape, isl_ast_expr *index_expr)
+{
+    assert(isl_ast_expr_get_op_n_arg(index_expr) > 1);
+
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    // ISL dimension is ordered from outermost to innermost.
+
+    Halide::Expr index {empty_index()};
+    for (int i = dims; i >= 1; --i)
+    {
+        isl_ast_expr *operand = isl_ast_expr_get_op_arg(index_expr, i);
+        Halide::Expr operand_h = halide_expr_from_isl_ast_expr(operand);
+        index += operand_h * Halide::Expr(shape[dims - i].stride);
+        isl_ast_expr_free(operand);
+    }
+
+    DEBUG_INDENT(-4);
+
+    return index;
+}
+
+Halide::Expr generator::linearize_access(int dims, const halide_dimension_t *shape, std::vector<tiramisu::expr> index_expr)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(index_expr.size() > 0);
+
+    // ISL dimension is ordered from outermost to innermost.
+
+    Halide::Expr index {empty_index()};
+    for (int i = dims; i >= 1; --i)
+    {
+        std::vector<isl_ast_expr *> ie = {};
+        Halide::Expr operand_h = generator::halide_expr_from_tiramisu_expr(NULL, ie, index_expr[i-1]);
+        index += operand_h * Halide::Expr(shape[dims - i].stride);
+    }
+
+    DEBUG_INDENT(-4);
+
+    return index;
+}
+
+Halide::Expr generator::linearize_access(int dims, std::vector<Halide::Expr> &strides, std::vector<tiramisu::expr> index_expr)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(index_expr.size() > 0);
+
+    // ISL dimension is ordered from outermost to innermost.
+
+    Halide::Expr index {empty_index()};
+    for (int i = dims; i >= 1; --i)
+    {
+        std::vector<isl_ast_expr *> ie = {};
+        Halide::Expr operand_h = generator::halide_expr_from_tiramisu_expr(NULL, ie, index_expr[i-1]);
+        index += operand_h * strides[dims - i];
+    }
+
+    DEBUG_INDENT(-4);
+
+    return index;
+}
+
+Halide::Expr generator::linearize_access(int dims, std::vector<Halide::Expr> &strides, isl_ast_expr *index_expr)
+{
+    assert(isl_ast_expr_get_op_n_arg(index_expr) > 1);
+
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    // ISL dimension is ordered from outermost to innermost.
+
+    Halide::Expr index {empty_index()};
+    for (int i = dims; i >= 1; --i)
+    {
+        isl_ast_expr *operand = isl_ast_expr_get_op_arg(index_expr, i);
+        Halide::Expr operand_h = halide_expr_from_isl_ast_expr(operand);
+        index += operand_h * strides[dims - i];
+        isl_ast_expr_free(operand);
+    }
+
+    DEBUG_INDENT(-4);
+
+    return index;
+}
+
+tiramisu::expr generator::linearize_access(int dims, std::vector<tiramisu::expr> &strides, std::vector<tiramisu::expr> index_expr)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(!index_expr.empty());
+
+    // ISL dimension is ordered from outermost to innermost.
+
+    tiramisu::expr index = value_cast(global::get_loop_iterator_data_type(), 0);
+    auto stride = strides.rbegin();
+    auto i_expr = index_expr.begin();
+    for (;
+            stride != strides.rend() && i_expr != strides.end();
+            stride ++, i_expr ++)
+    {
+        index = index + (*stride) * (*i_expr);
+    }
+
+    DEBUG_INDENT(-4);
+
+    return index;
+}
+
+tiramisu::expr generator::linearize_access(int dims, std::vector<tiramisu::expr> &strides, isl_ast_expr *index_expr)
+{
+    assert(isl_ast_expr_get_op_n_arg(index_expr) > 1);
+
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    // ISL dimension is ordered from outermost to innermost.
+
+    tiramisu::expr index = value_cast(global::get_loop_iterator_data_type(), 0);
+    for (int i = dims; i >= 1; --i)
+    {
+        isl_ast_expr *operand = isl_ast_expr_get_op_arg(index_expr, i);
+        tiramisu::expr operand_h = tiramisu_expr_from_isl_ast_expr(operand);
+        index = index + operand_h * strides[dims - i];
+        isl_ast_expr_free(operand);
+    }
+
+    DEBUG_INDENT(-4);
+
+    return index;
+}
+
+std::string generator::get_buffer_name(const tiramisu::computation * comp)
+{
+    isl_map *access = comp->get_access_relation_adapted_to_time_processor_domain();
+    const char *buffer_name = isl_map_get_tuple_name(access, isl_dim_out);
+    assert(buffer_name != nullptr);
+    std::string name{buffer_name};
+    isl_map_free(access);
+    return name;
+}
+
+tiramisu::expr generator::comp_to_buffer(tiramisu::computation *comp, std::vector<isl_ast_expr *> &index_expr,
+                                         const tiramisu::expr *expr)
+{
+    auto buffer_name = generator::get_buffer_name(comp);
+
+    DEBUG(3, tiramisu::str_dump("Buffer name extracted from the access relation: ", buffer_name.c_str()));
+
+    isl_map *access = comp->get_access_relation_adapted_to_time_processor_domain();
+    isl_space *space = isl_map_get_space(access);
+
+    // Get the number of dimensions of the ISL map representing
+    // the access.
+    int access_dims = isl_space_dim(space, isl_dim_out);
+
+    // Fetch the actual buffer.
+    const auto &buffer_entry = comp->get_function()->get_buffers().find(buffer_name);
+    assert(buffer_entry != comp->get_function()->get_buffers().end());
+
+    const auto &tiramisu_buffer = buffer_entry->second;
+    DEBUG(3, tiramisu::str_dump("A Tiramisu buffer that corresponds to the buffer indicated in the access relation was found."));
+
+    DEBUG(10, tiramisu_buffer->dump(true));
 
     auto dim_sizes = tiramisu_buffer->get_dim_sizes();
 
@@ -3975,6 +5451,314 @@ Halide::Expr generator::halide_expr_from_tiramisu_expr(const tiramisu::function
     return result;
 }
 
+/**
+  * Version of the object cache keys. Increment it whenever the code generator
+  * changes in a way that changes the generated object for the same statement.
+  */
+#define TIRAMISU_OBJECT_CACHE_VERSION 2
+
+/**
+  * Append the exact bits of the floating point constants of a statement to
+  * \p repr. The printed statement rounds them to a few decimals, which is
+  * not enough to tell two objects apart.
+  */
+class RepresentFloatConstants : public Halide::Internal::IRVisitor
+{
+    using Halide::Internal::IRVisitor::visit;
+
+    std::ostream &repr;
+
+    void visit(const Halide::Internal::FloatImm *op)
+    {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &op->value, sizeof(op->value));
+        repr << std::hex << bits << std::dec << ",";
+    }
+
+public:
+    RepresentFloatConstants(std::ostream &repr) : repr(repr) {}
+};
+
+/**
+  * Return the key used to cache the object generated for the Halide statement
+  * \p stmt of the function \p fct_name, compiled for \p targets with the
+  * arguments \p fct_arguments.
+  * The generated header uses the name of the object file as an include guard,
+  * so the name of the file is part of the key.
+  */
+static std::string object_cache_key(const std::string &fct_name, const std::string &obj_file_name,
+                                     const std::vector<Halide::Target> &targets,
+                                     const std::vector<Halide::Argument> &fct_arguments,
+                                     const std::vector<std::string> &streaming_buffers,
+                                     bool fold_storage, const Halide::Internal::Stmt &stmt)
+{
+    std::ostringstream repr;
+
+    repr << TIRAMISU_OBJECT_CACHE_VERSION << ";" << fct_name << ";"
+         << obj_file_name.substr(obj_file_name.find_last_of('/') + 1) << ";";
+
+    for (const auto &target : targets)
+        repr << target.to_string() << ";";
+
+    for (const auto &arg : fct_arguments)
+        repr << arg.name << "," << (int) arg.kind << "," << arg.type << "," << (int) arg.dimensions << ";";
+
+    for (const auto &name : streaming_buffers)
+        repr << "streaming:" << name << ";";
+
+    if (fold_storage)
+        repr << "fold_storage;";
+
+    repr << stmt << ";";
+
+    RepresentFloatConstants float_constants(repr);
+    stmt.accept(&float_constants);
+
+    // Use FNV-1a to hash the representation
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : repr.str())
+    {
+        hash ^= (unsigned char) c;
+        hash *= 1099511628211ULL;
+    }
+
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+/**
+  * Copy the file \p from to \p to. Return false if \p from cannot be read
+  * or if \p to cannot be written.
+  */
+static bool copy_file(const std::string &from, const std::string &to)
+{
+    std::ifstream in(from, std::ios::binary);
+    if (!in.is_open())
+        return false;
+
+    std::ofstream out(to, std::ios::binary);
+    if (!out.is_open())
+        return false;
+
+    out << in.rdbuf();
+    return out.good();
+}
+
+/**
+  * If the object and the header corresponding to \p key are in the object
+  * cache, copy them to \p obj_file_name and \p obj_file_name.h and return true.
+  */
+static bool restore_cached_object(const std::string &key, const std::string &obj_file_name)
+{
+    std::string cached = global::get_object_cache_directory() + "/" + key;
+
+    std::ifstream header(cached + ".h");
+    std::ifstream object(cached + ".o");
+    if (!header.is_open() || !object.is_open())
+        return false;
+
+    return copy_file(cached + ".o", obj_file_name) && copy_file(cached + ".h", obj_file_name + ".h");
+}
+
+/**
+  * Add the object \p obj_file_name and its header to the object cache under \p key.
+  * Each file is written to a temporary file that is then renamed, so another
+  * process never reads a partially written entry. The header is stored last,
+  * so an entry is only used once it is complete.
+  */
+static void store_cached_object(const std::string &key, const std::string &obj_file_name)
+{
+    std::string cached = global::get_object_cache_directory() + "/" + key;
+    std::string tmp_suffix = ".tmp" + std::to_string(getpid());
+
+    bool stored = copy_file(obj_file_name, cached + ".o" + tmp_suffix) &&
+                  copy_file(obj_file_name + ".h", cached + ".h" + tmp_suffix) &&
+                  std::rename((cached + ".o" + tmp_suffix).c_str(), (cached + ".o").c_str()) == 0 &&
+                  std::rename((cached + ".h" + tmp_suffix).c_str(), (cached + ".h").c_str()) == 0;
+
+    if (!stored)
+    {
+        std::remove((cached + ".o" + tmp_suffix).c_str());
+        std::remove((cached + ".h" + tmp_suffix).c_str());
+        DEBUG(3, tiramisu::str_dump("Could not store " + obj_file_name + " in the object cache."));
+    }
+}
+
+/**
+  * Return true if the load or store \p inst accesses one of the buffers
+  * \p buffers. Halide tags each load and store with a TBAA type named after
+  * the accessed buffer (refined by types named after the accessed range of
+  * indices when the index is constant).
+  */
+static bool accesses_buffer(const llvm::Instruction &inst, const std::vector<std::string> &buffers)
+{
+    const llvm::MDNode *tag = inst.getMetadata(llvm::LLVMContext::MD_tbaa);
+    if (tag == nullptr || tag->getNumOperands() < 2)
+        return false;
+
+    const llvm::MDNode *type = llvm::dyn_cast_or_null<llvm::MDNode>(tag->getOperand(1).get());
+    while (type != nullptr && type->getNumOperands() >= 2)
+    {
+        const llvm::MDString *name = llvm::dyn_cast_or_null<llvm::MDString>(type->getOperand(0).get());
+        if (name != nullptr &&
+            std::find(buffers.begin(), buffers.end(), name->getString().str()) != buffers.end())
+            return true;
+
+        type = llvm::dyn_cast_or_null<llvm::MDNode>(type->getOperand(1).get());
+    }
+
+    return false;
+}
+
+/**
+  * Return true if \p inst is a call to the marker of the beginning (if
+  * \p begin is true) or of the end of non-temporal stores (see
+  * mark_nontemporal_stores()), and set \p buffer to the buffer of the
+  * marked stores (the string passed to the marker).
+  */
+static bool is_nontemporal_stores_marker(const llvm::Instruction &inst, bool begin, std::string &buffer)
+{
+    const llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst);
+    const llvm::Function *callee = (call != nullptr) ? call->getCalledFunction() : nullptr;
+    if (callee == nullptr || callee->getName() != nontemporal_stores_marker(begin) || callee->arg_size() != 1)
+        return false;
+
+    const llvm::GlobalVariable *name =
+            llvm::dyn_cast<llvm::GlobalVariable>(call->getArgOperand(0)->stripPointerCasts());
+    if (name == nullptr || !name->hasInitializer())
+        return false;
+
+    const llvm::ConstantDataSequential *chars =
+            llvm::dyn_cast<llvm::ConstantDataSequential>(name->getInitializer());
+    if (chars == nullptr || !chars->isCString())
+        return false;
+
+    buffer = chars->getAsCString().str();
+    return true;
+}
+
+/**
+  * Mark as non-temporal the stores to \p buffer that run after the call
+  * \p begin to the marker of the beginning of non-temporal stores and
+  * before the matching marker of the end. The markers are calls to extern
+  * functions that the optimizations of LLVM cannot move the stores across.
+  * Return the number of marked stores.
+  */
+static int mark_streaming_stores_after(llvm::Instruction *begin, const std::string &buffer,
+                                       llvm::MDNode *nontemporal)
+{
+    int marked = 0;
+    std::vector<llvm::Instruction *> worklist = {begin->getNextNode()};
+    std::set<llvm::BasicBlock *> visited;
+
+    while (!worklist.empty())
+    {
+        llvm::Instruction *inst = worklist.back();
+        worklist.pop_back();
+
+        llvm::BasicBlock *bb = inst->getParent();
+        bool end_found = false;
+        for (; inst != nullptr && !end_found; inst = inst->getNextNode())
+        {
+            std::string name;
+            if (is_nontemporal_stores_marker(*inst, false, name) && name == buffer)
+                end_found = true;
+            else if (llvm::isa<llvm::StoreInst>(inst) && accesses_buffer(*inst, {buffer}))
+            {
+                inst->setMetadata(llvm::LLVMContext::MD_nontemporal, nontemporal);
+                marked++;
+            }
+        }
+
+        if (end_found)
+            continue;
+
+        auto *terminator = bb->getTerminator();
+        for (unsigned i = 0; terminator != nullptr && i < terminator->getNumSuccessors(); i++)
+            if (visited.insert(terminator->getSuccessor(i)).second)
+                worklist.push_back(&terminator->getSuccessor(i)->front());
+    }
+
+    return marked;
+}
+
+/**
+  * Mark the non-temporal stores to the buffers \p buffers in \p module
+  * (the stores between the markers inserted by mark_nontemporal_stores(),
+  * which lower_halide_pipeline() kept) as non-temporal, remove the
+  * markers, and add a store fence before each return of the functions
+  * that contain such stores. Non-temporal stores are weakly ordered: the
+  * fence makes them visible to the threads that synchronize with the end
+  * of the function (in particular, the tasks of a parallel loop are
+  * functions that return before the end of the parallel loop is
+  * signaled).
+  *
+  * The marked stores keep the TBAA type of their buffer, so LLVM orders
+  * them with the other loads and stores of the buffer.
+  */
+static void mark_streaming_stores(llvm::Module &module, const std::vector<std::string> &buffers)
+{
+    llvm::LLVMContext &context = module.getContext();
+    llvm::MDNode *nontemporal = llvm::MDNode::get(
+            context,
+            llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), 1)));
+
+    llvm::Triple triple(module.getTargetTriple());
+    bool is_x86 = (triple.getArch() == llvm::Triple::x86) || (triple.getArch() == llvm::Triple::x86_64);
+
+    std::vector<llvm::Instruction *> markers;
+
+    for (llvm::Function &f : module)
+    {
+        int streaming_stores = 0;
+        for (llvm::BasicBlock &bb : f)
+        {
+            for (llvm::Instruction &inst : bb)
+            {
+                std::string buffer;
+                if (is_nontemporal_stores_marker(inst, true, buffer))
+                {
+                    if (std::find(buffers.begin(), buffers.end(), buffer) != buffers.end())
+                        streaming_stores += mark_streaming_stores_after(&inst, buffer, nontemporal);
+                    markers.push_back(&inst);
+                }
+                else if (is_nontemporal_stores_marker(inst, false, buffer))
+                    markers.push_back(&inst);
+            }
+        }
+
+        if (streaming_stores == 0)
+            continue;
+
+        DEBUG(3, tiramisu::str_dump("Marked " + std::to_string(streaming_stores) +
+                                    " stores as non-temporal in " + f.getName().str()));
+
+        for (llvm::BasicBlock &bb : f)
+        {
+            llvm::ReturnInst *ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(bb.getTerminator());
+            if (ret == nullptr)
+                continue;
+
+            llvm::IRBuilder<> builder(ret);
+            if (is_x86)
+                builder.CreateCall(llvm::Intrinsic::getDeclaration(&module, llvm::Intrinsic::x86_sse_sfence));
+            else
+                builder.CreateFence(llvm::AtomicOrdering::SequentiallyConsistent);
+        }
+    }
+
+    // The markers are calls to functions that do not exist.
+    for (llvm::Instruction *marker : markers)
+        marker->eraseFromParent();
+    for (bool begin : {true, false})
+    {
+        llvm::Function *f = module.getFunction(nontemporal_stores_marker(begin));
+        if (f != nullptr && f->use_empty())
+            f->eraseFromParent();
+    }
+}
+
 void function::gen_halide_obj(const std::string &obj_file_name, Halide::Target::OS os,
                               Halide::Target::Arch arch, int bits, const tiramisu::hardware_architecture_t hw_architecture) const
 {
@@ -3993,6 +5777,68 @@ void function::gen_halide_obj(const std::string &obj_file_name, Halide::Target::
 
     Halide::Target target(os, arch, bits, features);
 
+    // Targets for which the function is generated, from the most specialized
+    // to the baseline. With multi-ISA code generation, Halide generates a
+    // dispatcher that calls the first target supported by the CPU.
+    bool multi_isa = this->multi_isa_codegen && (arch == Halide::Target::X86) &&
+                     (hw_architecture == tiramisu::hardware_architecture_t::arch_cpu) &&
+                     !nvcc_compiler;
+    std::vector<Halide::Target> targets;
+
+    if (multi_isa && ((obj_file_name.size() < 2) ||
+                      (obj_file_name.compare(obj_file_name.size() - 2, 2, ".a") != 0)))
+    {
+        ERROR("Multi-ISA code generation writes a static library, the name of the generated file (" +
+              obj_file_name + ") must end with \".a\".", true);
+    }
+
+    if (multi_isa)
+    {
+        targets.push_back(Halide::Target(os, arch, bits,
+                                         {
+                                                 Halide::Target::AVX512_Skylake,
+                                                 Halide::Target::AVX512,
+                                                 Halide::Target::AVX2,
+                                                 Halide::Target::FMA,
+                                                 Halide::Target::F16C,
+                                                 Halide::Target::AVX,
+                                                 Halide::Target::SSE41,
+                                                 Halide::Target::LargeBuffers
+                                         }));
+        targets.push_back(Halide::Target(os, arch, bits,
+                                         {
+                                                 Halide::Target::AVX2,
+                                                 Halide::Target::FMA,
+                                                 Halide::Target::F16C,
+                                                 Halide::Target::AVX,
+                                                 Halide::Target::SSE41,
+                                                 Halide::Target::LargeBuffers
+                                         }));
+    }
+    targets.push_back(target);
+
+    // The buffers written with non-temporal stores (see
+    // computation::tag_streaming_store()).
+    std::vector<std::string> streaming_buffers;
+
+    if ((hw_architecture == tiramisu::hardware_architecture_t::arch_cpu) && !nvcc_compiler)
+    {
+        for (const auto &name : this->streaming_store_computations)
+            for (tiramisu::computation *comp : this->get_computation_by_name(name))
+                if (comp->get_access_relation() != NULL)
+                    streaming_buffers.push_back(generator::get_buffer_name(comp));
+
+        std::sort(streaming_buffers.begin(), streaming_buffers.end());
+        streaming_buffers.erase(std::unique(streaming_buffers.begin(), streaming_buffers.end()),
+                                streaming_buffers.end());
+    }
+
+    if (multi_isa && !streaming_buffers.empty())
+    {
+        DEBUG(3, tiramisu::str_dump("Streaming stores are not supported with multi-ISA code generation."));
+        streaming_buffers.clear();
+    }
+
     std::vector<Halide::Argument> fct_arguments;
 
     for (const auto &buf : this->function_arguments)
@@ -4007,16 +5853,75 @@ void function::gen_halide_obj(const std::string &obj_file_name, Halide::Target::
     }
 
 
-    Halide::Module m = lower_halide_pipeline(this->get_name(), target, fct_arguments,
-                                             Halide::Internal::LoweredFunc::External,
-                                             this->get_halide_stmt());
+    // Reuse the object generated for the same statement, target and arguments
+    // if it is in the object cache.
+    bool use_object_cache = !global::get_object_cache_directory().empty() &&
+                            (hw_architecture != tiramisu::hardware_architecture_t::arch_flexnlp) &&
+                            !nvcc_compiler;
+    std::string cache_key;
+
+    if (use_object_cache)
+    {
+        cache_key = object_cache_key(this->get_name(), obj_file_name, targets, fct_arguments,
+                                     streaming_buffers, this->native_storage_folding,
+                                     this->get_halide_stmt());
+
+        if (restore_cached_object(cache_key, obj_file_name))
+        {
+            DEBUG(3, tiramisu::str_dump("Reusing the cached object " + cache_key + " for " + obj_file_name));
+            return;
+        }
+    }
+
+    if (multi_isa)
+    {
+        // Halide can only write the versions and the dispatcher in a static library.
+        compile_profiler::scope s("multi_isa_codegen", this->get_name());
+        Halide::compile_multitarget(this->get_name(),
+                                    Halide::Outputs().static_library(obj_file_name).c_header(obj_file_name + ".h"),
+                                    targets,
+                                    [&](const std::string &fn_name, const Halide::Target &t) {
+                                        return lower_halide_pipeline(fn_name, t, fct_arguments,
+                                                                     Halide::Internal::LoweredFunc::External,
+                                                                     this->get_halide_stmt(),
+                                                                     this->native_storage_folding);
+                                    });
+    }
+    else
+    {
+        Halide::Module m = [&]() {
+            compile_profiler::scope s("lower_halide_pipeline", this->get_name());
+            return lower_halide_pipeline(this->get_name(), target, fct_arguments,
+                                         Halide::Internal::LoweredFunc::External,
+                                         this->get_halide_stmt(), this->native_storage_folding,
+                                         !streaming_buffers.empty());
+        }();
+
+        compile_profiler::scope s("llvm_codegen", this->get_name());
+        if (streaming_buffers.empty())
+        {
+            m.compile(Halide::Outputs().object(obj_file_name));
+        }
+        else
+        {
+            // Halide cannot express non-temporal stores: annotate the LLVM
+            // module before generating the object.
+            llvm::LLVMContext context;
+            std::unique_ptr<llvm::Module> llvm_module = Halide::compile_module_to_llvm_module(m, context);
+            mark_streaming_stores(*llvm_module, streaming_buffers);
+            std::unique_ptr<llvm::raw_fd_ostream> object = Halide::make_raw_fd_ostream(obj_file_name);
+            Halide::compile_llvm_module_to_object(*llvm_module, *object);
+        }
+        m.compile(Halide::Outputs().c_header(obj_file_name + ".h"));
+        if (hw_architecture == tiramisu::hardware_architecture_t::arch_flexnlp)
+            m.compile(Halide::Outputs().c_source(obj_file_name + "_generated.c"));
+    }
 
-    m.compile(Halide::Outputs().object(obj_file_name));
-    m.compile(Halide::Outputs().c_header(obj_file_name + ".h"));
-    if (hw_architecture == tiramisu::hardware_architecture_t::arch_flexnlp)
-        m.compile(Halide::Outputs().c_source(obj_file_name + "_generated.c"));
+    if (use_object_cache)
+        store_cached_object(cache_key, obj_file_name);
 
     if (nvcc_compiler) {
+        compile_profiler::scope s("nvcc", this->get_name());
         nvcc_compiler->compile(obj_file_name);
     }
 }
@@ -4076,7 +5981,7 @@ void tiramisu::generator::_update_producer_expr_name(tiramisu::expr &current_exp
             case tiramisu::o_trunc:
             case tiramisu::o_address:
             {
-                tiramisu::expr &exp0 = current_exp.op[0];
+                tiramisu::expr &exp0 = current_exp.op.mutable_at(0);
                 generator::_update_producer_expr_name(exp0, name_to_replace, replace_with);
                 break;
             }
@@ -4098,8 +6003,8 @@ void tiramisu::generator::_update_producer_expr_name(tiramisu::expr &current_exp
             case tiramisu::o_right_shift:
             case tiramisu::o_left_shift:
             {
-                tiramisu::expr &exp0 = current_exp.op[0];
-                tiramisu::expr &exp1 = current_exp.op[1];
+                tiramisu::expr &exp0 = current_exp.op.mutable_at(0);
+                tiramisu::expr &exp1 = current_exp.op.mutable_at(1);
                 generator::_update_producer_expr_name(exp0, name_to_replace, replace_with);
                 generator::_update_producer_expr_name(exp1, name_to_replace, replace_with);
                 break;
@@ -4107,9 +6012,9 @@ void tiramisu::generator::_update_producer_expr_name(tiramisu::expr &current_exp
             case tiramisu::o_select:
             case tiramisu::o_cond:
             {
-                tiramisu::expr &exp0 = current_exp.op[0];
-                tiramisu::expr &exp1 = current_exp.op[1];
-                tiramisu::expr &exp2 = current_exp.op[2];
+                tiramisu::expr &exp0 = current_exp.op.mutable_at(0);
+                tiramisu::expr &exp1 = current_exp.op.mutable_at(1);
+                tiramisu::expr &exp2 = current_exp.op.mutable_at(2);
                 generator::_update_producer_expr_name(exp0, name_to_replace, replace_with);
                 generator::_update_producer_expr_name(exp1, name_to_replace, replace_with);
                 generator::_update_producer_expr_name(exp2, name_to_replace, replace_with);
@@ -4117,8 +6022,9 @@ void tiramisu::generator::_update_producer_expr_name(tiramisu::expr &current_exp
             }
             case tiramisu::o_call:
             {
-                for (auto &e : current_exp.argument_vector) {
-                    generator::_update_producer_expr_name(e, name_to_replace, replace_with);
+                for (int i = 0; i < current_exp.argument_vector.size(); i++) {
+                    generator::_update_producer_expr_name(current_exp.argument_vector.mutable_at(i),
+                                                          name_to_replace, replace_with);
                 }
                 break;
             }
@@ -4166,6 +6072,13 @@ Halide::Internal::Stmt generator::make_buffer_free(buffer * b) {
                                              {Halide::Internal::Variable::make(Halide::type_of<void *>(), b->get_name())}, Halide::Internal::Call::Extern)
         );
     }
+    else if (b->get_alignment() > 0 || (!b->get_auto_allocate() && generator::uses_thread_arena(b)))
+    {
+        // Aligned buffers and buffers allocated in the arena of the thread
+        // are freed at the end of the scope of their allocation (see
+        // make_buffer_alloc).
+        return Halide::Internal::Evaluate::make(0);
+    }
     else {
         return Halide::Internal::Free::make(b->get_name());
     }
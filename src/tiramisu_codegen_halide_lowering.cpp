@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <iostream>
+#include <set>
 
 #include <tiramisu/debug.h>
 #include <Halide.h>
@@ -24,18 +25,526 @@ string stmt_to_string(const string &str, const Stmt &s)
     return stream.str();
 }
 
+/**
+  * Return true if the variable \p name refers to the buffer \p buffer
+  * (e.g. "buf" or "buf.buffer", "buf.host", ...).
+  */
+bool is_buffer_variable(const string &name, const string &buffer)
+{
+    return (name == buffer) || (name.compare(0, buffer.size() + 1, buffer + ".") == 0);
+}
+
+/**
+  * Return the innermost loop of \p loops (vectorized loops, from outermost
+  * to innermost) whose variable is used by \p index, or nullptr if \p index
+  * does not use any of them. If \p count is not null, it is set to the
+  * number of loops of \p loops used by \p index.
+  */
+const For *vector_loop_of_index(const Expr &index, const vector<const For *> &loops, int *count = nullptr)
+{
+    const For *result = nullptr;
+    int n = 0;
+
+    for (const For *loop : loops)
+        if (expr_uses_var(index, loop->name))
+        {
+            result = loop;
+            n++;
+        }
+
+    if (count != nullptr)
+        *count = n;
+
+    return result;
+}
+
+/**
+  * Compute the range of the indices accessed (loaded or stored) in the
+  * buffer \p buffer, and check whether the buffer escapes (i.e. is used in
+  * any way other than through loads and stores, for example if its address
+  * is passed to an external function).
+  * The ranges are expressed as a function of the variables that are free in
+  * the visited statement: the variables of the inner loops and lets are
+  * replaced with their bounds.
+  */
+class BufferFootprint : public IRVisitor
+{
+    using IRVisitor::visit;
+
+    const string &buffer;
+    Scope<Interval> scope;
+    vector<const For *> vector_loops;
+
+    void add_index(const Expr &index)
+    {
+        int count;
+        if (index.type().is_vector())
+            vector_indices.push_back(index);
+        else if (const For *loop = vector_loop_of_index(index, vector_loops, &count))
+        {
+            if (count > 1)
+                vector_indices.push_back(index);
+            else
+                vectorized_indices.push_back(std::make_pair(index, loop));
+        }
+
+        Interval bounds = bounds_of_expr_in_scope(index, scope);
+        if (!bounds.min.defined() || !bounds.max.defined())
+            bounded = false;
+        else
+            footprint.push_back(bounds);
+    }
+
+    void visit(const Load *op)
+    {
+        IRVisitor::visit(op);
+        if (op->name == buffer)
+            add_index(op->index);
+    }
+
+    void visit(const Store *op)
+    {
+        IRVisitor::visit(op);
+        if (op->name == buffer)
+            add_index(op->index);
+    }
+
+    void visit(const Variable *op)
+    {
+        if (is_buffer_variable(op->name, buffer))
+            escapes = true;
+    }
+
+    void visit(const Call *op)
+    {
+        if (op->name == buffer)
+            escapes = true;
+
+        if (op->is_intrinsic(Call::address_of))
+        {
+            const Load *load = op->args[0].as<Load>();
+            if (load != nullptr && load->name == buffer)
+                escapes = true;
+        }
+
+        IRVisitor::visit(op);
+    }
+
+    void visit(const For *op)
+    {
+        op->min.accept(this);
+        op->extent.accept(this);
+
+        Interval min_bounds = bounds_of_expr_in_scope(op->min, scope);
+        Interval max_bounds = bounds_of_expr_in_scope(op->min + op->extent - 1, scope);
+        scope.push(op->name, Interval(min_bounds.min, max_bounds.max));
+        if (op->for_type == ForType::Vectorized)
+            vector_loops.push_back(op);
+        op->body.accept(this);
+        if (op->for_type == ForType::Vectorized)
+            vector_loops.pop_back();
+        scope.pop(op->name);
+    }
+
+    void visit(const LetStmt *op)
+    {
+        op->value.accept(this);
+        scope.push(op->name, bounds_of_expr_in_scope(op->value, scope));
+        op->body.accept(this);
+        scope.pop(op->name);
+    }
+
+    void visit(const Let *op)
+    {
+        op->value.accept(this);
+        scope.push(op->name, bounds_of_expr_in_scope(op->value, scope));
+        op->body.accept(this);
+        scope.pop(op->name);
+    }
+
+public:
+    vector<Interval> footprint;
+
+    /**
+      * The vector indices, and the scalar indices that use the variables of
+      * more than one vectorized loop.
+      */
+    vector<Expr> vector_indices;
+
+    /**
+      * The scalar indices that use the variable of one vectorized loop
+      * (they become vector indices when the loop is vectorized), and
+      * that loop.
+      */
+    vector<std::pair<Expr, const For *>> vectorized_indices;
+
+    bool bounded;
+    bool escapes;
+
+    BufferFootprint(const string &buffer) : buffer(buffer), bounded(true), escapes(false) {}
+};
+
+/**
+  * Return true if \p s uses the buffer \p buffer.
+  */
+bool uses_buffer(const Stmt &s, const string &buffer)
+{
+    BufferFootprint footprint(buffer);
+    s.accept(&footprint);
+    return !footprint.footprint.empty() || footprint.escapes || !footprint.bounded;
+}
+
+/**
+  * Return the outermost loop of \p s that contains all the uses of \p buffer,
+  * or nullptr if there is no such loop.
+  */
+const For *outermost_loop_using_buffer(const Stmt &s, const string &buffer)
+{
+    if (const For *loop = s.as<For>())
+        return loop;
+    else if (const LetStmt *let = s.as<LetStmt>())
+        return outermost_loop_using_buffer(let->body, buffer);
+    else if (const ProducerConsumer *pc = s.as<ProducerConsumer>())
+        return outermost_loop_using_buffer(pc->body, buffer);
+    else if (const Allocate *alloc = s.as<Allocate>())
+        return outermost_loop_using_buffer(alloc->body, buffer);
+    else if (const Block *block = s.as<Block>())
+    {
+        bool first_uses = uses_buffer(block->first, buffer);
+        bool rest_uses = block->rest.defined() && uses_buffer(block->rest, buffer);
+
+        if (first_uses && !rest_uses)
+            return outermost_loop_using_buffer(block->first, buffer);
+        else if (rest_uses && !first_uses)
+            return outermost_loop_using_buffer(block->rest, buffer);
+    }
+
+    return nullptr;
+}
+
+/**
+  * Return true if the index \p index, which uses the variable of the
+  * vectorized loop \p loop, becomes a dense vector index when the loop is
+  * vectorized and remains dense once folded by \p factor: the index
+  * increases by one with the variable of the loop, its value at the first
+  * lane is aligned to the number of lanes, and \p factor is a multiple of
+  * the number of lanes.
+  */
+bool is_dense_after_folding(const Expr &index, const For *loop, int factor)
+{
+    const int64_t *lanes = as_const_int(simplify(loop->extent));
+    if (lanes == nullptr || *lanes <= 0 || (factor % *lanes != 0))
+        return false;
+
+    Expr var = Variable::make(loop->min.type(), loop->name);
+    Expr first = substitute(loop->name, loop->min, index);
+
+    return can_prove(substitute(loop->name, var + 1, index) == index + 1) &&
+           can_prove(first % make_const(first.type(), *lanes) == 0);
+}
+
+/**
+  * Return the index \p index of a folded buffer modulo the fold factor
+  * \p factor. Dense vector indices (see is_dense_after_folding()) remain
+  * dense, so that vector loads and stores are not turned into gathers and
+  * scatters: only the index of the first lane is folded, since the other
+  * lanes follow it in the same block of the folded buffer.
+  */
+Expr fold_index(const Expr &index, int factor, const vector<const For *> &vector_loops)
+{
+    if (const Ramp *ramp = index.as<Ramp>())
+        return Ramp::make(ramp->base % make_const(ramp->base.type(), factor), ramp->stride, ramp->lanes);
+    else if (const Broadcast *broadcast = index.as<Broadcast>())
+        return Broadcast::make(broadcast->value % make_const(broadcast->value.type(), factor), broadcast->lanes);
+    else if (const For *loop = vector_loop_of_index(index, vector_loops))
+    {
+        Expr first = substitute(loop->name, loop->min, index);
+        return (first % make_const(first.type(), factor)) + (index - first);
+    }
+
+    return index % make_const(index.type(), factor);
+}
+
+/**
+  * Return the fold factor of the buffer allocated by \p op (see
+  * FoldTemporaryStorage), or 0 if the buffer cannot be folded.
+  */
+int fold_factor(const Allocate *op)
+{
+    if (op->new_expr.defined() || op->extents.empty())
+        return 0;
+
+    const For *loop = outermost_loop_using_buffer(op->body, op->name);
+    if (loop == nullptr ||
+        (loop->for_type != ForType::Serial && loop->for_type != ForType::Unrolled))
+        return 0;
+
+    BufferFootprint footprint(op->name);
+    loop->body.accept(&footprint);
+    if (footprint.escapes || !footprint.bounded || footprint.footprint.empty())
+        return 0;
+
+    Interval range = footprint.footprint[0];
+    for (const auto &i : footprint.footprint)
+    {
+        range.min = min(range.min, i.min);
+        range.max = max(range.max, i.max);
+    }
+    range.min = simplify(range.min);
+    range.max = simplify(range.max);
+
+    const int64_t *extent = as_const_int(simplify(range.max - range.min + 1));
+    if (extent == nullptr || *extent <= 0)
+        return 0;
+
+    // The accessed range must move forward with the loop.
+    Expr next_iteration = Variable::make(loop->min.type(), loop->name) + 1;
+    Expr next_min = substitute(loop->name, next_iteration, range.min);
+    Expr next_max = substitute(loop->name, next_iteration, range.max);
+    if (!can_prove(next_min >= range.min) || !can_prove(next_max >= range.max))
+        return 0;
+
+    int factor = 1;
+    while (factor < *extent)
+        factor *= 2;
+
+    // Vector accesses must stay dense after folding.
+    for (const auto &index : footprint.vector_indices)
+    {
+        if (index.as<Broadcast>() != nullptr)
+            continue;
+
+        const Ramp *ramp = index.as<Ramp>();
+        if (ramp == nullptr || !is_one(ramp->stride) || (factor % ramp->lanes != 0) ||
+            !can_prove(ramp->base % ramp->lanes == 0))
+        {
+            DEBUG(3, tiramisu::str_dump("Not folding " + op->name + ": it has a vector access that would become a gather or a scatter."));
+            return 0;
+        }
+    }
+
+    for (const auto &index : footprint.vectorized_indices)
+    {
+        if (!is_dense_after_folding(index.first, index.second, factor))
+        {
+            DEBUG(3, tiramisu::str_dump("Not folding " + op->name + ": it has a vector access that would become a gather or a scatter."));
+            return 0;
+        }
+    }
+
+    // Do not fold if the folded buffer is not smaller.
+    Expr size = op->extents[0];
+    for (size_t i = 1; i < op->extents.size(); i++)
+        size = size * op->extents[i];
+    const int64_t *const_size = as_const_int(simplify(size));
+    if (const_size != nullptr && *const_size <= factor)
+        return 0;
+
+    return factor;
+}
+
+/**
+  * Native storage folding for the temporary buffers generated by Tiramisu.
+  *
+  * Halide's storage_folding works on multi-dimensional realizations of
+  * Halide functions, while Tiramisu generates flattened allocations, loads
+  * and stores, so it cannot be used here. This pass folds a temporary buffer
+  * when all its uses are inside a serial loop L, and:
+  *   - the range of indices of the buffer accessed in one iteration of L is
+  *     bounded by a constant F,
+  *   - the lower and upper bounds of that range never decrease from one
+  *     iteration of L to the next.
+  * Then, between a store to an index i and a load from i, no index that is
+  * equal to i modulo F is accessed, so the buffer can be replaced by a
+  * buffer of F elements (rounded up to a power of two) accessed with
+  * i % F. For example, a temporary image produced and consumed row by row
+  * inside a loop over rows is replaced by a few rows (a line buffer).
+  * A buffer accessed with vector indices (or in vectorized loops) is folded
+  * only if these indices are dense, aligned to their number of lanes, and
+  * if F is a multiple of the number of lanes: the folded vector accesses
+  * then remain dense.
+  *
+  * The pass is enabled with function::set_native_storage_folding().
+  */
+class FoldTemporaryStorage : public IRMutator
+{
+    using IRMutator::visit;
+
+    /**
+      * The buffers being folded and their fold factors.
+      */
+    map<string, int> folds;
+
+    /**
+      * The enclosing vectorized loops, from outermost to innermost.
+      */
+    vector<const For *> vector_loops;
+
+    void visit(const For *op)
+    {
+        if (op->for_type == ForType::Vectorized)
+            vector_loops.push_back(op);
+        IRMutator::visit(op);
+        if (op->for_type == ForType::Vectorized)
+            vector_loops.pop_back();
+    }
+
+    void visit(const Load *op)
+    {
+        IRMutator::visit(op);
+        auto fold = folds.find(op->name);
+        if (fold != folds.end())
+        {
+            op = expr.as<Load>();
+            Expr index = fold_index(op->index, fold->second, vector_loops);
+            expr = Load::make(op->type, op->name, index, op->image, op->param, op->predicate);
+        }
+    }
+
+    void visit(const Store *op)
+    {
+        IRMutator::visit(op);
+        auto fold = folds.find(op->name);
+        if (fold != folds.end())
+        {
+            op = stmt.as<Store>();
+            Expr index = fold_index(op->index, fold->second, vector_loops);
+            stmt = Store::make(op->name, op->value, index, op->param, op->predicate);
+        }
+    }
+
+    void visit(const Allocate *op)
+    {
+        int factor = fold_factor(op);
+        if (factor == 0)
+        {
+            IRMutator::visit(op);
+            return;
+        }
+
+        DEBUG(3, tiramisu::str_dump("Folding the storage of " + op->name + " to " +
+                                    std::to_string(factor) + " elements."));
+
+        folds[op->name] = factor;
+        Stmt body = mutate(op->body);
+        folds.erase(op->name);
+
+        stmt = Allocate::make(op->name, op->type, {factor}, op->condition, body,
+                              op->new_expr, op->free_function);
+    }
+};
+
+const string nontemporal_stores_begin = "tiramisu_nontemporal_stores_begin";
+const string nontemporal_stores_end = "tiramisu_nontemporal_stores_end";
+
+/**
+  * Return true if \p s is the marker \p marker inserted by
+  * mark_nontemporal_stores(), and set \p buffer to the buffer of the marked
+  * stores.
+  */
+bool is_nontemporal_stores_marker(const Stmt &s, const string &marker, string &buffer)
+{
+    const Evaluate *evaluate = s.as<Evaluate>();
+    const Call *call = (evaluate != nullptr) ? evaluate->value.as<Call>() : nullptr;
+    if (call == nullptr || call->name != marker || call->args.size() != 1)
+        return false;
+
+    const StringImm *name = call->args[0].as<StringImm>();
+    if (name == nullptr)
+        return false;
+
+    buffer = name->value;
+    return true;
+}
+
+/**
+  * Append to \p stmts the statements of the sequence \p s.
+  */
+void flatten_block(const Stmt &s, vector<Stmt> &stmts)
+{
+    const Block *block = s.as<Block>();
+    if (block == nullptr)
+    {
+        stmts.push_back(s);
+        return;
+    }
+
+    flatten_block(block->first, stmts);
+    if (block->rest.defined())
+        flatten_block(block->rest, stmts);
+}
+
+/**
+  * Remove the markers inserted by mark_nontemporal_stores().
+  */
+class RemoveNontemporalStoresMarkers : public IRMutator
+{
+    using IRMutator::visit;
+
+    void visit(const Block *op)
+    {
+        vector<Stmt> stmts;
+        flatten_block(op, stmts);
+
+        Stmt result;
+        for (const Stmt &st : stmts)
+        {
+            string buffer;
+            if (!is_nontemporal_stores_marker(st, nontemporal_stores_begin, buffer) &&
+                !is_nontemporal_stores_marker(st, nontemporal_stores_end, buffer))
+            {
+                Stmt mutated = mutate(st);
+                result = result.defined() ? Block::make(result, mutated) : mutated;
+            }
+        }
+
+        stmt = result.defined() ? result : Evaluate::make(0);
+    }
+};
+
 } // anonymous namespace
 
+string nontemporal_stores_marker(bool begin)
+{
+    return begin ? nontemporal_stores_begin : nontemporal_stores_end;
+}
+
+Stmt mark_nontemporal_stores(const string &buffer, const Stmt &s)
+{
+    if (!s.defined())
+        return s;
+
+    Stmt begin = Evaluate::make(Call::make(Int(32), nontemporal_stores_begin, {StringImm::make(buffer)},
+                                           Call::Extern));
+    Stmt end = Evaluate::make(Call::make(Int(32), nontemporal_stores_end, {StringImm::make(buffer)},
+                                         Call::Extern));
+
+    return Block::make(begin, Block::make(s, end));
+}
+
+Stmt remove_nontemporal_stores_markers(const Stmt &s)
+{
+    return RemoveNontemporalStoresMarkers().mutate(s);
+}
+
+bool can_fold_storage(const string &buffer, const Type &type, const vector<Expr> &extents, const Stmt &s)
+{
+    Stmt alloc = Allocate::make(buffer, type, extents, const_true(), s);
+    return fold_factor(alloc.as<Allocate>()) > 0;
+}
+
 Module lower_halide_pipeline(const string &pipeline_name,
                              const Target &t,
                              const vector<Argument> &args,
                              const Internal::LoweredFunc::LinkageType linkage_type,
-                             Stmt s)
+                             Stmt s,
+                             bool fold_storage,
+                             bool keep_nontemporal_markers)
 {
     Module result_module(pipeline_name, t);
 
-    // TODO(tiramisu): Compute the env (function DAG). This is needed for
-    // the sliding window and storage folding passes.
+    // Tiramisu does not generate Halide functions, so the environment
+    // (function DAG) used by the Halide passes below is empty.
     map<string, Function> env;
 
     if (ENABLE_DEBUG)
@@ -44,9 +553,12 @@ Module lower_halide_pipeline(const string &pipeline_name,
         std::flush(std::cout);
     }
 
-    DEBUG(3, tiramisu::str_dump("Performing sliding window optimization...\n"));
-    s = sliding_window(s, env);
-    DEBUG(4, tiramisu::str_dump(stmt_to_string("Lowering after sliding window:\n", s)));
+    // Halide's sliding_window and storage_folding passes work on the
+    // multi-dimensional realizations of Halide functions. Tiramisu generates
+    // flattened allocations and accesses instead, so sliding window does not
+    // apply (Tiramisu never recomputes values across loop iterations) and
+    // storage folding is performed by a native pass below (if fold_storage
+    // is true).
 
     DEBUG(3, tiramisu::str_dump("Removing code that depends on undef values...\n"));
     s = remove_undef(s);
@@ -64,18 +576,21 @@ Module lower_halide_pipeline(const string &pipeline_name,
     s = simplify(s, false);
     DEBUG(4, tiramisu::str_dump(stmt_to_string("Lowering after simplification:\n", s)));
     
-    DEBUG(3, tiramisu::str_dump("Performing storage folding optimization...\n"));
-    s = storage_folding(s, env);
-    DEBUG(4, tiramisu::str_dump(stmt_to_string("Lowering after storage folding:\n", s)));
+    if (fold_storage)
+    {
+        DEBUG(3, tiramisu::str_dump("Performing storage folding optimization...\n"));
+        s = FoldTemporaryStorage().mutate(s);
+        DEBUG(4, tiramisu::str_dump(stmt_to_string("Lowering after storage folding:\n", s)));
+    }
 
     DEBUG(3, tiramisu::str_dump("Simplifying...\n")); // without removing dead lets, because storage flattening needs the strides
     s = simplify(s, false);
     DEBUG(4, tiramisu::str_dump(stmt_to_string("Lowering after simplification:\n", s)));
 
-/*    DEBUG(3, tiramisu::str_dump("Injecting prefetches...\n"));
-    s = inject_prefetch(s, env);
-    DEBUG(4, tiramisu::str_dump(stmt_to_string("Lowering after injecting prefetches:\n", s)));
-*/
+    // Halide's inject_prefetch pass is driven by the schedules of Halide
+    // functions; Tiramisu inserts prefetch intrinsics directly when generating
+    // the Halide statement (see computation::prefetch()), and they are lowered
+    // by reduce_prefetch_dimension below.
     DEBUG(3, tiramisu::str_dump("Destructuring tuple-valued realizations...\n"));
     s = split_tuples(s, env);
     DEBUG(4, tiramisu::str_dump(stmt_to_string("Lowering after destructuring tuple-valued realizations:\n", s)));
@@ -187,6 +702,18 @@ Module lower_halide_pipeline(const string &pipeline_name,
     s = remove_trivial_for_loops(s);
     s = simplify(s);
     // s = loop_invariant_code_motion(s);
+
+    // The markers of the stores of the computations tagged with
+    // tag_streaming_store() are either kept, in which case they are
+    // generated as calls that the LLVM code of the function is annotated
+    // with (see function::gen_halide_obj()), or removed.
+    if (!keep_nontemporal_markers)
+    {
+        DEBUG(3, tiramisu::str_dump("Removing the markers of non-temporal stores...\n"));
+        s = remove_nontemporal_stores_markers(s);
+        DEBUG(4, tiramisu::str_dump(
+                  stmt_to_string("Lowering after removing the markers of non-temporal stores:\n", s)));
+    }
     if (ENABLE_DEBUG)
     {
         std::cout << "Lowering after final simplification:\n" << s << "\n";
@@ -11,6 +11,8 @@
 #include <tiramisu/debug.h>
 #include <tiramisu/core.h>
 
+#include <cstdlib>
+
 #ifdef _WIN32
 #include <iso646.h>
 #endif
@@ -26,6 +28,8 @@ static int next_dim_name = 0;
 bool global::auto_data_mapping = false;
 primitive_t global::loop_iterator_type = p_int32;
 function *global::implicit_fct;
+std::string global::object_cache_directory = (getenv("TIRAMISU_OBJECT_CACHE_DIR") != NULL) ?
+                                             getenv("TIRAMISU_OBJECT_CACHE_DIR") : "";
 std::unordered_map<std::string, var> var::declared_vars;
 const var computation::root = var("root");
 
@@ -97,6 +101,12 @@ void codegen(const std::vector<tiramisu::buffer *> &arguments, const std::string
     fct->codegen(arguments, obj_filename, gen_architecture_flag);
 }
 
+void specialize_on(const std::string &constraints, std::function<void()> schedule)
+{
+    function *fct = global::get_implicit_function();
+    fct->specialize_on(constraints, schedule);
+}
+
 bool check_legality_of_function()
 {
     function *fct = global::get_implicit_function();
@@ -116,6 +126,18 @@ void prepare_schedules_for_legality_checks(bool reset_static_dimesion)
     fct->prepare_schedules_for_legality_checks(reset_static_dimesion);
 }
 
+void fold_storage_automatically()
+{
+    function *fct = global::get_implicit_function();
+    fct->fold_storage_automatically();
+}
+
+std::map<std::string, int> pad_buffers_automatically(int cache_size, int associativity, int line_size)
+{
+    function *fct = global::get_implicit_function();
+    return fct->pad_buffers_automatically(cache_size, associativity, line_size);
+}
+
 bool loop_parallelization_is_legal(tiramisu::var i, std::vector<tiramisu::computation *> fuzed_computations)
 {
     function *fct = global::get_implicit_function();
@@ -342,6 +364,56 @@ void tiramisu::computation::rename_computation(std::string new_name)
         if (std::get<0>(pd) == old_name)
             std::get<0>(pd) = new_name;
 
+    // Rename the entries of the indexes of parallel, unroll and vectorize vectors
+    tiramisu::function *func = this->get_function();
+
+    if (func->parallel_dimensions_index.count(old_name) > 0)
+    {
+        std::unordered_set<int> levels = func->parallel_dimensions_index[old_name];
+        func->parallel_dimensions_index.erase(old_name);
+        func->parallel_dimensions_index[new_name].insert(levels.begin(), levels.end());
+    }
+
+    if (func->unroll_dimensions_index.count(old_name) > 0)
+    {
+        std::unordered_map<int, int> levels = func->unroll_dimensions_index[old_name];
+        func->unroll_dimensions_index.erase(old_name);
+        for (const auto &level : levels)
+            func->unroll_dimensions_index[new_name][level.first] = level.second;
+    }
+
+    if (func->vector_dimensions_index.count(old_name) > 0)
+    {
+        std::unordered_map<int, int> levels = func->vector_dimensions_index[old_name];
+        func->vector_dimensions_index.erase(old_name);
+        for (const auto &level : levels)
+            func->vector_dimensions_index[new_name][level.first] = level.second;
+    }
+
+    if (func->vector_tails.count(old_name) > 0)
+    {
+        std::unordered_map<int, tiramisu::vector_tail_t> tails = func->vector_tails[old_name];
+        func->vector_tails.erase(old_name);
+        func->vector_tails[new_name] = tails;
+    }
+
+    if (func->prefetch_dimensions.count(old_name) > 0)
+    {
+        auto prefetches = func->prefetch_dimensions[old_name];
+        func->prefetch_dimensions.erase(old_name);
+        func->prefetch_dimensions[new_name] = prefetches;
+    }
+
+    if (func->streaming_store_computations.erase(old_name) > 0)
+        func->streaming_store_computations.insert(new_name);
+
+    if (func->scalar_replacement_dimensions.count(old_name) > 0)
+    {
+        std::unordered_set<int> levels = func->scalar_replacement_dimensions[old_name];
+        func->scalar_replacement_dimensions.erase(old_name);
+        func->scalar_replacement_dimensions[new_name] = levels;
+    }
+
     DEBUG_INDENT(-4);
 }
 
@@ -684,6 +756,72 @@ void tiramisu::computation::tag_unroll_level(int level, int factor)
     DEBUG_INDENT(-4);
 }
 
+void tiramisu::computation::tag_streaming_store()
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(!this->get_name().empty());
+    assert(this->get_function() != NULL);
+
+    this->get_function()->add_streaming_store(this->get_name());
+
+    DEBUG_INDENT(-4);
+}
+
+void tiramisu::computation::prefetch(tiramisu::buffer *b, tiramisu::var L_var, int distance)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(b != NULL);
+    assert(L_var.get_name().length() > 0);
+    assert(distance > 0);
+
+    std::vector<int> dimensions =
+        this->get_loop_level_numbers_from_dimension_names({L_var.get_name()});
+    this->check_dimensions_validity(dimensions);
+
+    this->get_function()->add_prefetch_dimension(this->get_name(), b->get_name(), dimensions[0], distance);
+
+    DEBUG_INDENT(-4);
+}
+
+void tiramisu::computation::prefetch(tiramisu::computation &c, tiramisu::var L_var, int distance)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(L_var.get_name().length() > 0);
+    assert(distance > 0);
+
+    std::vector<int> dimensions =
+        this->get_loop_level_numbers_from_dimension_names({L_var.get_name()});
+    this->check_dimensions_validity(dimensions);
+
+    // The buffer of c is only known during code generation.
+    this->get_function()->add_prefetch_dimension(this->get_name(), c.get_name(), dimensions[0], distance);
+
+    DEBUG_INDENT(-4);
+}
+
+void tiramisu::computation::prefetch(tiramisu::var L_var, int distance)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(L_var.get_name().length() > 0);
+    assert(distance > 0);
+
+    std::vector<int> dimensions =
+        this->get_loop_level_numbers_from_dimension_names({L_var.get_name()});
+    this->check_dimensions_validity(dimensions);
+
+    this->get_function()->add_prefetch_dimension(this->get_name(), "", dimensions[0], distance);
+
+    DEBUG_INDENT(-4);
+}
+
 tiramisu::computation *tiramisu::computation::copy()
 {
     DEBUG_FCT_NAME(3);
@@ -1273,6 +1411,72 @@ void tiramisu::computation::vectorize(tiramisu::var L0_var, int v, tiramisu::var
     DEBUG_INDENT(-4);
 }
 
+void tiramisu::computation::vectorize(tiramisu::var L0_var, int v, tiramisu::vector_tail_t tail)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    tiramisu::var L0_outer = tiramisu::var(generate_new_variable_name());
+    tiramisu::var L0_inner = tiramisu::var(generate_new_variable_name());
+    this->vectorize(L0_var, v, L0_outer, L0_inner, tail);
+
+    DEBUG_INDENT(-4);
+}
+
+void tiramisu::computation::vectorize(tiramisu::var L0_var, int v, tiramisu::var L0_outer, tiramisu::var L0_inner,
+                                      tiramisu::vector_tail_t tail)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    if (tail == tiramisu::vector_tail_t::separate)
+    {
+        this->vectorize(L0_var, v, L0_outer, L0_inner);
+        DEBUG_INDENT(-4);
+        return;
+    }
+
+    assert(L0_var.get_name().length() > 0);
+    std::vector<int> dimensions =
+        this->get_loop_level_numbers_from_dimension_names({L0_var.get_name()});
+    this->check_dimensions_validity(dimensions);
+    int L0 = dimensions[0];
+
+    // Split without separating the partial vector: the inner loop
+    // keeps the partial last vector, which is masked or padded
+    // during code generation.
+    this->split(L0_var, v, L0_outer, L0_inner);
+    this->tag_vector_level(L0 + 1, v);
+    this->get_function()->set_vector_tail(this->get_name(), L0 + 1, tail);
+
+    this->get_function()->align_schedules();
+
+    DEBUG_INDENT(-4);
+}
+
+void tiramisu::computation::vectorize(int L0, int v)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    bool split_happened = this->separateAndSplit(L0, v);
+
+    if (split_happened)
+    {
+        // Tag the inner loop after splitting to be vectorized. That loop
+        // is supposed to have a constant extent.
+        this->get_update(0).tag_vector_level(L0 + 1, v);
+    }
+    else
+    {
+        this->get_update(0).tag_vector_level(L0, v);
+    }
+
+    this->get_function()->align_schedules();
+
+    DEBUG_INDENT(-4);
+}
+
 tiramisu::computation& computation::get_last_update()
 {
     return this->get_update(this->get_updates().size()-1);
@@ -1369,6 +1573,69 @@ void tiramisu::computation::unroll(int L0, int v)
     DEBUG_INDENT(-4);
 }
 
+void tiramisu::computation::unroll_and_jam(tiramisu::var L0_var, int v)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    tiramisu::var L0_outer = tiramisu::var(generate_new_variable_name());
+    tiramisu::var L0_inner = tiramisu::var(generate_new_variable_name());
+    this->unroll_and_jam(L0_var, v, L0_outer, L0_inner);
+
+    DEBUG_INDENT(-4);
+}
+
+void tiramisu::computation::unroll_and_jam(tiramisu::var L0_var, int v,
+                                           tiramisu::var L0_outer, tiramisu::var L0_inner)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(v > 0);
+
+    std::vector<std::string> original_loop_level_names = this->get_loop_level_names();
+
+    assert(L0_var.get_name().length() > 0);
+    std::vector<int> dimensions =
+        this->get_loop_level_numbers_from_dimension_names({L0_var.get_name()});
+    this->check_dimensions_validity(dimensions);
+    int L0 = dimensions[0];
+
+    bool split_happened = this->separateAndSplit(L0, v);
+
+    int jammed_level;
+    if (split_happened)
+    {
+        this->update_names(original_loop_level_names, {L0_outer.get_name(), L0_inner.get_name()}, L0, 1);
+        jammed_level = L0 + 1;
+    }
+    else
+    {
+        // The loop has at most v iterations, all of them are jammed.
+        this->update_names(original_loop_level_names, {L0_inner.get_name()}, L0, 1);
+        jammed_level = L0;
+    }
+
+    // Move the loop to unroll to the innermost level.
+    int innermost = this->get_loop_levels_number() - 1;
+    for (int l = jammed_level; l < innermost; l++)
+        this->get_update(0).interchange(l, l + 1);
+
+    DEBUG(3, tiramisu::str_dump("Unrolling the loop level " + std::to_string(innermost) +
+                                " and jamming it in the loop level " + std::to_string(innermost - 1)));
+
+    this->get_update(0).tag_unroll_level(innermost, v);
+
+    // The unrolled copies are jammed in the loop that encloses the unrolled
+    // loop. Keep the accesses that do not depend on that loop in registers.
+    if (innermost - 1 >= jammed_level)
+        this->get_function()->add_scalar_replacement_dimension(this->get_name(), innermost - 1);
+
+    this->get_function()->align_schedules();
+
+    DEBUG_INDENT(-4);
+}
+
 void computation::dump_iteration_domain() const
 {
     if (ENABLE_DEBUG)
@@ -1476,6 +1743,200 @@ bool buffer::has_constant_extents()
     return constant_extent;
 }
 
+void buffer::set_alignment(int alignment)
+{
+    assert(alignment > 0);
+    assert(((alignment & (alignment - 1)) == 0) && ("The alignment must be a power of two"));
+
+    this->alignment = alignment;
+}
+
+int buffer::get_alignment() const
+{
+    return this->alignment;
+}
+
+void buffer::set_padding(int padding, int extra_elements)
+{
+    assert(padding >= 1);
+    assert(extra_elements >= 0);
+    assert(!this->dim_sizes.empty());
+
+    if (!this->is_padded())
+        this->unpadded_innermost_size = this->dim_sizes.back();
+    this->padding = padding;
+    this->extra_padding = extra_elements;
+
+    const tiramisu::expr &size = this->unpadded_innermost_size;
+
+    if (size.get_expr_type() == tiramisu::e_val)
+    {
+        int64_t padded = ((size.get_int_val() + padding - 1) / padding) * padding + extra_elements;
+        if (size.get_data_type() == tiramisu::p_int64)
+            this->dim_sizes.back() = tiramisu::expr((int64_t) padded);
+        else
+            this->dim_sizes.back() = tiramisu::expr((int32_t) padded);
+    }
+    else
+    {
+        tiramisu::expr p(tiramisu::o_cast, size.get_data_type(), tiramisu::expr((int32_t) padding));
+        tiramisu::expr p_minus_one(tiramisu::o_cast, size.get_data_type(), tiramisu::expr((int32_t) (padding - 1)));
+        this->dim_sizes.back() = ((size + p_minus_one) / p) * p;
+        if (extra_elements > 0)
+            this->dim_sizes.back() = this->dim_sizes.back() +
+                                     tiramisu::expr(tiramisu::o_cast, size.get_data_type(),
+                                                    tiramisu::expr((int32_t) extra_elements));
+    }
+}
+
+int buffer::get_padding() const
+{
+    return this->padding;
+}
+
+int buffer::get_extra_padding() const
+{
+    return this->extra_padding;
+}
+
+bool buffer::is_padded() const
+{
+    return (this->padding > 1) || (this->extra_padding > 0);
+}
+
+void buffer::set_layout(const std::vector<int> &order, const std::vector<std::pair<int, int>> &blocks,
+                        int padding)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(!this->dim_sizes.empty());
+    assert(this->fct != NULL);
+    assert(padding >= 1);
+
+    // The new layout is built from the unpadded buffer.
+    if (this->is_padded())
+    {
+        this->dim_sizes.back() = this->unpadded_innermost_size;
+        this->padding = 1;
+        this->extra_padding = 0;
+    }
+
+    const int n_dims = this->dim_sizes.size();
+    const int n_blocked_dims = n_dims + blocks.size();
+    assert((order.empty() || order.size() == (size_t) n_blocked_dims) &&
+           ("The order must list all the dimensions of the blocked buffer"));
+
+    // Block the dimensions.
+    std::vector<std::string> dims;
+    std::vector<std::string> blocked_dims;
+    std::vector<tiramisu::expr> blocked_sizes = this->dim_sizes;
+    for (int i = 0; i < n_dims; i++)
+    {
+        dims.push_back("i" + std::to_string(i));
+        blocked_dims.push_back(dims[i]);
+    }
+
+    for (const auto &block : blocks)
+    {
+        const int d = block.first;
+        const int f = block.second;
+        assert(d >= 0 && d < n_dims && f > 0);
+        assert((blocked_dims[d] == dims[d]) && ("A dimension can only be blocked once"));
+
+        blocked_dims[d] = "floor(" + dims[d] + "/" + std::to_string(f) + ")";
+        blocked_dims.push_back(dims[d] + "%" + std::to_string(f));
+
+        const tiramisu::expr size = this->dim_sizes[d];
+        if (size.get_expr_type() == tiramisu::e_val)
+        {
+            int64_t outer = (size.get_int_val() + f - 1) / f;
+            if (size.get_data_type() == tiramisu::p_int64)
+            {
+                blocked_sizes[d] = tiramisu::expr((int64_t) outer);
+                blocked_sizes.push_back(tiramisu::expr((int64_t) f));
+            }
+            else
+            {
+                blocked_sizes[d] = tiramisu::expr((int32_t) outer);
+                blocked_sizes.push_back(tiramisu::expr((int32_t) f));
+            }
+        }
+        else
+        {
+            tiramisu::expr e_f(tiramisu::o_cast, size.get_data_type(), tiramisu::expr((int32_t) f));
+            tiramisu::expr e_f_minus_one(tiramisu::o_cast, size.get_data_type(), tiramisu::expr((int32_t) (f - 1)));
+            blocked_sizes[d] = (size + e_f_minus_one) / e_f;
+            blocked_sizes.push_back(e_f);
+        }
+    }
+
+    // Reorder the dimensions.
+    std::vector<std::string> layout_dims = blocked_dims;
+    std::vector<tiramisu::expr> layout_sizes = blocked_sizes;
+    if (!order.empty())
+    {
+        std::vector<bool> used(n_blocked_dims, false);
+        for (int i = 0; i < n_blocked_dims; i++)
+        {
+            assert(order[i] >= 0 && order[i] < n_blocked_dims && !used[order[i]] &&
+                   ("The order must be a permutation of the dimensions of the blocked buffer"));
+            used[order[i]] = true;
+            layout_dims[i] = blocked_dims[order[i]];
+            layout_sizes[i] = blocked_sizes[order[i]];
+        }
+    }
+
+    std::string layout_str = "{" + this->get_name() + "[";
+    for (int i = 0; i < n_dims; i++)
+        layout_str += ((i > 0) ? "," : "") + dims[i];
+    layout_str += "] -> " + this->get_name() + "[";
+    for (int i = 0; i < n_blocked_dims; i++)
+        layout_str += ((i > 0) ? "," : "") + layout_dims[i];
+    layout_str += "]}";
+
+    isl_map *layout = isl_map_read_from_str(this->fct->get_isl_ctx(), layout_str.c_str());
+    assert(layout != NULL);
+
+    DEBUG(3, tiramisu::str_dump("Layout of the buffer " + this->get_name() + ": ", isl_map_to_str(layout)));
+
+    // Rewrite the accesses of the computations stored in the buffer.
+    // set_access() sets the access of all the computations that have the
+    // same name (updates and duplicates), so each name is rewritten once.
+    std::vector<tiramisu::computation *> stored_computations;
+    std::set<std::string> stored_names;
+    for (auto comp : this->fct->get_computations())
+    {
+        isl_map *access = comp->get_access_relation();
+        if (access == NULL)
+            continue;
+
+        const char *buffer_name = isl_map_get_tuple_name(access, isl_dim_out);
+        if (buffer_name != NULL && this->get_name() == buffer_name && stored_names.insert(comp->get_name()).second)
+            stored_computations.push_back(comp);
+    }
+    if (stored_computations.empty())
+        ERROR("set_layout() is called on the buffer " + this->get_name() +
+              ", which stores no computation. Call it after computation::store_in().", true);
+
+    for (auto comp : stored_computations)
+    {
+        isl_map *access = isl_map_apply_range(isl_map_copy(comp->get_access_relation()), isl_map_copy(layout));
+        DEBUG(3, tiramisu::str_dump("New access relation of " + comp->get_name() + ": ", isl_map_to_str(access)));
+        comp->set_access(access);
+        isl_map_free(access);
+    }
+    isl_map_free(layout);
+
+    this->dim_sizes = layout_sizes;
+    this->has_layout = true;
+
+    if (padding > 1)
+        this->set_padding(padding);
+
+    DEBUG_INDENT(-4);
+}
+
 tiramisu::computation *buffer::allocate_at(tiramisu::computation &C, tiramisu::var level)
 {
     DEBUG_FCT_NAME(3);
@@ -7686,7 +8147,11 @@ const bool tiramisu::computation::is_inline_computation() const {
  */
 void tiramisu::computation::set_name(const std::string &n)
 {
+    std::string old_name = this->name;
     this->name = n;
+
+    if (this->fct != NULL)
+        this->fct->update_computation_name(this, old_name);
 }
 
 /**
@@ -7701,6 +8166,10 @@ void tiramisu::computation::store_in(buffer *buff)
 
     assert(buff != NULL);
 
+    if (buff->has_layout)
+        ERROR("The computation " + this->get_name() + " is stored in the buffer " + buff->get_name() +
+              " after set_layout() was called on it. Call set_layout() after computation::store_in().", true);
+
     isl_space *sp = isl_set_get_space(this->get_iteration_domain());
     isl_map *map = isl_map_identity(isl_space_map_from_set(sp));
     map = isl_map_set_tuple_name(map, isl_dim_out, buff->get_name().c_str());
@@ -7723,6 +8192,10 @@ void tiramisu::computation::store_in(buffer *buff, std::vector<tiramisu::expr> i
 
     assert(buff != NULL);
 
+    if (buff->has_layout)
+        ERROR("The computation " + this->get_name() + " is stored in the buffer " + buff->get_name() +
+              " after set_layout() was called on it. Call set_layout() after computation::store_in().", true);
+
     std::string map_str = "[" + utility::get_parameters_list(this->get_iteration_domain()) + "] -> ";
     map_str += "{" + this->get_name() + "[";
     std::vector<std::string> iter_names =
@@ -8014,7 +8487,16 @@ void tiramisu::computation::storage_fold(tiramisu::var L0_var, int factor)
     std::vector<int> loop_dimensions =
         this->get_loop_level_numbers_from_dimension_names({L0_var.get_name()});
     this->check_dimensions_validity(loop_dimensions);
-    int inDim0 = loop_dimensions[0];
+
+    this->storage_fold(loop_dimensions[0], factor);
+
+    DEBUG_INDENT(-4);
+}
+
+void tiramisu::computation::storage_fold(int inDim0, int factor)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
 
     assert(this->get_access_relation() != NULL);
     assert(inDim0 >= 0);
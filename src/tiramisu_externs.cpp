@@ -1,4 +1,5 @@
 #include "tiramisu/externs.h"
+#include <stdlib.h>
 #ifdef WITH_MPI
 #include <mpi.h>
 #endif
@@ -45,6 +46,111 @@ double *tiramisu_address_of_float64(halide_buffer_t *buffer, unsigned long index
     return &(((double*)(buffer->host))[index]);
 }
 
+void *tiramisu_aligned_malloc(uint64_t size, uint64_t alignment) {
+    // Halide assumes that allocations are aligned to the native vector
+    // width, 128 bytes covers all the targets.
+    if (alignment < 128)
+        alignment = 128;
+
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, alignment, (size > 0) ? size : 1) != 0)
+        return NULL;
+
+    return ptr;
+}
+
+int32_t tiramisu_aligned_free(void *ptr) {
+    free(ptr);
+    return 0;
+}
+
+void *tiramisu_arena_address(void *arena, uint64_t offset) {
+    return ((char *) arena) + offset;
+}
+
+static void *tiramisu_default_arena_allocator(uint64_t size) {
+    return tiramisu_aligned_malloc(size, 128);
+}
+
+static void tiramisu_default_arena_deallocator(void *arena) {
+    free(arena);
+}
+
+static tiramisu_arena_allocator_t tiramisu_arena_allocator = tiramisu_default_arena_allocator;
+static tiramisu_arena_deallocator_t tiramisu_arena_deallocator = tiramisu_default_arena_deallocator;
+static uint64_t tiramisu_arena_initial_size = 1 << 20;
+
+/**
+  * The arena of a thread: a block of memory of \p size bytes whose first
+  * \p top bytes are in use.
+  */
+struct tiramisu_thread_arena {
+    char *memory = NULL;
+    uint64_t size = 0;
+    uint64_t top = 0;
+    tiramisu_arena_deallocator_t deallocate = NULL;
+
+    ~tiramisu_thread_arena() {
+        if (memory != NULL)
+            deallocate(memory);
+    }
+};
+
+static thread_local tiramisu_thread_arena tiramisu_arena;
+
+void tiramisu_set_thread_arena_allocator(tiramisu_arena_allocator_t allocate,
+                                         tiramisu_arena_deallocator_t deallocate,
+                                         uint64_t initial_size) {
+    tiramisu_arena_allocator = (allocate != NULL) ? allocate : tiramisu_default_arena_allocator;
+    tiramisu_arena_deallocator = (deallocate != NULL) ? deallocate : tiramisu_default_arena_deallocator;
+    tiramisu_arena_initial_size = initial_size;
+}
+
+void *tiramisu_thread_arena_malloc(uint64_t size, uint64_t alignment) {
+    if (alignment < 128)
+        alignment = 128;
+    // Each allocation has a distinct address in the arena.
+    if (size == 0)
+        size = 1;
+
+    tiramisu_thread_arena &arena = tiramisu_arena;
+
+    // No buffer is live in an empty arena: it can be replaced by a larger one.
+    if (arena.top == 0 && arena.size < size + alignment) {
+        uint64_t new_size = (arena.size > 0) ? 2 * arena.size : tiramisu_arena_initial_size;
+        if (new_size < size + alignment)
+            new_size = size + alignment;
+
+        if (arena.memory != NULL)
+            arena.deallocate(arena.memory);
+        arena.memory = (char *) tiramisu_arena_allocator(new_size);
+        arena.size = (arena.memory != NULL) ? new_size : 0;
+        arena.deallocate = tiramisu_arena_deallocator;
+    }
+
+    if (arena.memory != NULL) {
+        uintptr_t base = (uintptr_t) arena.memory;
+        uint64_t start = ((base + arena.top + alignment - 1) & ~((uintptr_t) alignment - 1)) - base;
+        if (start + size <= arena.size) {
+            arena.top = start + size;
+            return arena.memory + start;
+        }
+    }
+
+    return tiramisu_aligned_malloc(size, alignment);
+}
+
+int32_t tiramisu_thread_arena_free(void *ptr) {
+    tiramisu_thread_arena &arena = tiramisu_arena;
+
+    if (arena.memory != NULL && (char *) ptr >= arena.memory && (char *) ptr < arena.memory + arena.size)
+        arena.top = (char *) ptr - arena.memory;
+    else
+        free(ptr);
+
+    return 0;
+}
+
 #ifdef WITH_MPI
 void *tiramisu_address_of_wait(halide_buffer_t *buffer, unsigned long index) {
   return &(((MPI_Request*)(buffer->host))[index]);
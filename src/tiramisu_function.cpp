@@ -9,10 +9,16 @@
 #include <isl/union_set.h>
 #include <isl/ast_build.h>
 #include <isl/ilp.h>
+#include <isl/local_space.h>
+#include <isl/val.h>
 
 #include <tiramisu/debug.h>
 #include <tiramisu/core.h>
 
+#include <cstdlib>
+#include <limits>
+#include <set>
+
 namespace tiramisu
 {
 
@@ -80,6 +86,11 @@ function::function(std::string name)
     this->context_set = NULL;
     this->use_low_level_scheduling_commands = false;
     this->_needs_rank_call = false;
+    this->multi_isa_codegen = false;
+    this->native_storage_folding = false;
+    this->automatic_scalar_replacement = false;
+    this->read_only_scalar_replacement = false;
+    this->memory_planning = false;
 
     // Allocate an ISL context.  This ISL context will be used by
     // the ISL library calls within Tiramisu.
@@ -1002,20 +1013,9 @@ bool function::should_parallelize(const std::string &comp, int lev) const
                                  " should be parallelized" +
                                  " at the loop level " + std::to_string(lev)));
 
-    for (const auto &pd : this->parallel_dimensions)
-    {
-        DEBUG(10, tiramisu::str_dump("Checking if the computation " + comp +
-                                     " at the loop level " + std::to_string(lev) +
-                                     " is equal to the tagged computation " +
-                                     pd.first + " at the level " + std::to_string(pd.second)));
-
-        if ((pd.first == comp) && (pd.second == lev))
-        {
-            found = true;
-
-            DEBUG(10, tiramisu::str_dump("Yes equal."));
-        }
-    }
+    auto tagged = this->parallel_dimensions_index.find(comp);
+    if (tagged != this->parallel_dimensions_index.end())
+        found = (tagged->second.count(lev) > 0);
 
     std::string str = "Dimension " + std::to_string(lev) +
                       (found ? " should" : " should not")
@@ -1042,11 +1042,13 @@ int function::get_unrolling_factor(const std::string &comp, int lev) const
     int unrolling_factor = -1;
     bool found = false;
 
-    for (const auto &pd : this->unroll_dimensions)
+    auto tagged = this->unroll_dimensions_index.find(comp);
+    if (tagged != this->unroll_dimensions_index.end())
     {
-        if ((std::get<0>(pd) == comp) && (std::get<1>(pd) == lev))
+        auto level = tagged->second.find(lev);
+        if (level != tagged->second.end())
         {
-            unrolling_factor = std::get<2>(pd);
+            unrolling_factor = level->second;
             found = true;
         }
     }
@@ -1077,11 +1079,13 @@ int function::get_vector_length(const std::string &comp, int lev) const
     int vector_length = -1;
     bool found = false;
 
-    for (const auto &pd : this->vector_dimensions)
+    auto tagged = this->vector_dimensions_index.find(comp);
+    if (tagged != this->vector_dimensions_index.end())
     {
-        if ((std::get<0>(pd) == comp) && (std::get<1>(pd) == lev))
+        auto level = tagged->second.find(lev);
+        if (level != tagged->second.end())
         {
-            vector_length = std::get<2>(pd);
+            vector_length = level->second;
             found = true;
         }
     }
@@ -1097,6 +1101,19 @@ int function::get_vector_length(const std::string &comp, int lev) const
     return vector_length;
 }
 
+tiramisu::vector_tail_t function::get_vector_tail(const std::string &comp, int lev) const
+{
+    auto tagged = this->vector_tails.find(comp);
+    if (tagged != this->vector_tails.end())
+    {
+        auto level = tagged->second.find(lev);
+        if (level != tagged->second.end())
+            return level->second;
+    }
+
+    return tiramisu::vector_tail_t::separate;
+}
+
 computation * function::get_first_cpt() {
     if (this->is_sched_graph_tree()) {
         tiramisu::computation* cpt = this->sched_graph.begin()->first;
@@ -1143,14 +1160,9 @@ bool function::should_vectorize(const std::string &comp, int lev) const
 
     DEBUG_INDENT(4);
 
-    for (const auto &pd : this->vector_dimensions)
-    {
-        DEBUG(10, tiramisu::str_dump("Comparing " + comp + " to " + std::get<0>(pd)));
-        DEBUG(10, tiramisu::str_dump(std::get<0>(pd) + " is marked for vectorization at level " + std::to_string(std::get<1>(pd))));
-
-        if ((std::get<0>(pd) == comp) && (std::get<1>(pd) == lev))
-            found = true;
-    }
+    auto tagged = this->vector_dimensions_index.find(comp);
+    if (tagged != this->vector_dimensions_index.end())
+        found = (tagged->second.count(lev) > 0);
 
     std::string str = "Dimension " + std::to_string(lev) +
                       (found ? " should" : " should not")
@@ -1769,12 +1781,31 @@ void tiramisu::function::add_computation(computation *cpt)
     assert(cpt != NULL);
 
     this->body.push_back(cpt);
+    this->computations_index[cpt->get_name()].push_back(cpt);
     if (cpt->should_schedule_this_computation())
         this->starting_computations.insert(cpt);
 
     DEBUG_INDENT(-4);
 }
 
+void tiramisu::function::update_computation_name(computation *cpt, const std::string &old_name)
+{
+    auto found = this->computations_index.find(old_name);
+    if (found == this->computations_index.end())
+        return;
+
+    std::vector<computation *> &comps = found->second;
+    auto it = std::find(comps.begin(), comps.end(), cpt);
+    if (it == comps.end())
+        return;
+
+    comps.erase(it);
+    if (comps.empty())
+        this->computations_index.erase(found);
+
+    this->computations_index[cpt->get_name()].push_back(cpt);
+}
+
 void tiramisu::function::dump(bool exhaustive) const
 {
     if (ENABLE_DEBUG)
@@ -1910,6 +1941,18 @@ void tiramisu::function::add_vector_dimension(std::string stmt_name, int vec_dim
     assert(!stmt_name.empty());
 
     this->vector_dimensions.push_back(std::make_tuple(stmt_name, vec_dim, vector_length));
+    this->vector_dimensions_index[stmt_name][vec_dim] = vector_length;
+}
+
+void tiramisu::function::set_vector_tail(std::string stmt_name, int vec_dim, tiramisu::vector_tail_t tail)
+{
+    assert(vec_dim >= 0);
+    assert(!stmt_name.empty());
+
+    if (tail == tiramisu::vector_tail_t::separate)
+        this->vector_tails[stmt_name].erase(vec_dim);
+    else
+        this->vector_tails[stmt_name][vec_dim] = tail;
 }
 
 void tiramisu::function::add_distributed_dimension(std::string stmt_name, int dim)
@@ -1926,6 +1969,7 @@ void tiramisu::function::add_parallel_dimension(std::string stmt_name, int vec_d
     assert(!stmt_name.empty());
 
     this->parallel_dimensions.push_back({stmt_name, vec_dim});
+    this->parallel_dimensions_index[stmt_name].insert(vec_dim);
 }
 
 void tiramisu::function::add_unroll_dimension(std::string stmt_name, int level, int factor)
@@ -1935,6 +1979,124 @@ void tiramisu::function::add_unroll_dimension(std::string stmt_name, int level,
     assert(factor >= 0);
 
     this->unroll_dimensions.push_back(std::make_tuple(stmt_name, level, factor));
+    this->unroll_dimensions_index[stmt_name][level] = factor;
+}
+
+void tiramisu::function::add_prefetch_dimension(std::string stmt_name, std::string accessed_name,
+                                                int level, int distance)
+{
+    assert(level >= 0);
+    assert(!stmt_name.empty());
+    assert(distance > 0);
+
+    this->prefetch_dimensions[stmt_name].push_back(std::make_tuple(accessed_name, level, distance));
+}
+
+std::vector<std::tuple<std::string, int, int>> tiramisu::function::get_prefetches(const std::string &comp) const
+{
+    auto prefetches = this->prefetch_dimensions.find(comp);
+    if (prefetches == this->prefetch_dimensions.end())
+        return {};
+
+    return prefetches->second;
+}
+
+void tiramisu::function::add_scalar_replacement_dimension(std::string stmt_name, int level)
+{
+    assert(level >= 0);
+    assert(!stmt_name.empty());
+
+    this->scalar_replacement_dimensions[stmt_name].insert(level);
+}
+
+/**
+  * Return true if two instances of a computation that have the schedule
+  * \p schedule and that are only different in the dimension \p dim of the
+  * time-space domain access the same element through \p access.
+  * \p schedule and \p access are consumed.
+  */
+static bool access_is_invariant_in_dimension(isl_map *schedule, isl_map *access, int dim)
+{
+    isl_space *time_space = isl_space_range(isl_map_get_space(schedule));
+    isl_map *same_except_dim = isl_map_universe(isl_space_map_from_set(time_space));
+    for (int i = 0; i < isl_map_dim(same_except_dim, isl_dim_in); i++)
+        if (i != dim)
+            same_except_dim = isl_map_equate(same_except_dim, isl_dim_in, i, isl_dim_out, i);
+
+    // Instance x -> instance y, where x and y are only different in dim.
+    isl_map *instances = isl_map_apply_range(isl_map_copy(schedule), same_except_dim);
+    instances = isl_map_apply_range(instances, isl_map_reverse(schedule));
+
+    // Element accessed by x -> element accessed by y.
+    isl_map *elements = isl_map_apply_domain(instances, isl_map_copy(access));
+    elements = isl_map_apply_range(elements, access);
+
+    isl_map *identity = isl_map_identity(isl_space_map_from_set(isl_space_range(isl_map_get_space(elements))));
+    isl_bool invariant = isl_map_is_subset(elements, identity);
+
+    isl_map_free(elements);
+    isl_map_free(identity);
+
+    return invariant == isl_bool_true;
+}
+
+void tiramisu::function::gen_scalar_replacement_tags()
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    for (tiramisu::computation *comp : this->get_computations())
+    {
+        if (!comp->should_schedule_this_computation() || comp->is_let_stmt() ||
+            comp->get_access_relation() == NULL || !comp->get_expr().is_defined())
+            continue;
+
+        if ((comp->get_expr().get_expr_type() == tiramisu::e_op) &&
+            ((comp->get_expr().get_op_type() == tiramisu::o_allocate) ||
+             (comp->get_expr().get_op_type() == tiramisu::o_free)))
+            continue;
+
+        const std::string &name = comp->get_name();
+
+        // Vectorized and unrolled loops are not promoted, the loop that
+        // encloses them is.
+        int level = comp->get_loop_levels_number() - 1;
+        while ((level >= 0) && (this->should_vectorize(name, level) || this->should_unroll(name, level)))
+            level--;
+
+        if ((level < 0) || this->should_scalar_replace(name, level) ||
+            this->should_parallelize(name, level) || this->should_distribute(name, level) ||
+            this->should_map_to_gpu_block(name, level) || this->should_map_to_gpu_thread(name, level))
+            continue;
+
+        isl_map *schedule = isl_map_intersect_domain(isl_map_copy(comp->get_schedule()),
+                                                     isl_set_copy(comp->get_iteration_domain()));
+        if (access_is_invariant_in_dimension(schedule, isl_map_copy(comp->get_access_relation()),
+                                             loop_level_into_dynamic_dimension(level)))
+        {
+            DEBUG(3, tiramisu::str_dump("The access of " + name + " is invariant in the loop level " +
+                                        std::to_string(level) + ", promoting it to a register."));
+            this->add_scalar_replacement_dimension(name, level);
+        }
+    }
+
+    DEBUG_INDENT(-4);
+}
+
+void tiramisu::function::add_streaming_store(std::string stmt_name)
+{
+    assert(!stmt_name.empty());
+
+    this->streaming_store_computations.insert(stmt_name);
+}
+
+bool tiramisu::function::should_scalar_replace(const std::string &comp, int lev) const
+{
+    auto tagged = this->scalar_replacement_dimensions.find(comp);
+    if (tagged == this->scalar_replacement_dimensions.end())
+        return false;
+
+    return tagged->second.count(lev) > 0;
 }
 
 void tiramisu::function::add_gpu_block_dimensions(std::string stmt_name, int dim0,
@@ -1971,6 +2133,13 @@ void tiramisu::function::remove_dimension_tags()
     gpu_block_dimensions.clear();
     gpu_thread_dimensions.clear();
     unroll_dimensions.clear();
+    parallel_dimensions_index.clear();
+    vector_dimensions_index.clear();
+    unroll_dimensions_index.clear();
+    prefetch_dimensions.clear();
+    scalar_replacement_dimensions.clear();
+    streaming_store_computations.clear();
+    vector_tails.clear();
 }
 
 isl_union_set *tiramisu::function::get_trimmed_time_processor_domain() const
@@ -2260,6 +2429,7 @@ void function::gen_time_space_domain()
 
     for (auto &comp : this->get_computations())
     {
+        compile_profiler::scope s("gen_time_space_domain", this->get_name(), comp->get_name());
         comp->gen_time_space_domain();
     }
 
@@ -2491,8 +2661,52 @@ void tiramisu::function::gen_halide_bug_workaround_computations(){
     first_cpt = comp;
 }
 
+void function::set_multi_isa_codegen(bool multi_isa)
+{
+    this->multi_isa_codegen = multi_isa;
+}
+
+void function::set_native_storage_folding(bool enable)
+{
+    this->native_storage_folding = enable;
+}
+
+void function::set_automatic_scalar_replacement(bool enable)
+{
+    this->automatic_scalar_replacement = enable;
+}
+
+void function::set_read_only_scalar_replacement(bool enable)
+{
+    this->read_only_scalar_replacement = enable;
+}
+
+void function::set_memory_planning(bool enable)
+{
+    this->memory_planning = enable;
+}
+
+/**
+  * Return true if \p file_name is the name of a C file (codegen() then
+  * generates C code).
+  */
+static bool is_c_file_name(const std::string &file_name)
+{
+    return (file_name.size() > 2) && (file_name.compare(file_name.size() - 2, 2, ".c") == 0);
+}
+
+void function::specialize_on(const std::string &constraints, std::function<void()> schedule)
+{
+    assert(!constraints.empty() && "Specialization constraints are empty");
+
+    this->specializations.push_back(std::make_pair(constraints, schedule));
+}
+
 void tiramisu::function::codegen(const std::vector<tiramisu::buffer *> &arguments, const std::string obj_filename, const bool gen_cuda_stmt)
 {
+    if (gen_cuda_stmt && !this->specializations.empty())
+        ERROR("specialize_on() is only supported for CPU code.", true);
+
     if (gen_cuda_stmt)
     {
         if(!this->mapping.empty())
@@ -2505,14 +2719,32 @@ void tiramisu::function::codegen(const std::vector<tiramisu::buffer *> &argument
             DEBUG(3, tiramisu::str_dump("You must specify the corresponding CPU buffer to each GPU buffer else you should do the communication manually"));
     }
     this->set_arguments(arguments);
-    this->lift_dist_comps();
-    this->gen_time_space_domain();
-    this->gen_isl_ast();
+    {
+        compile_profiler::scope s("lift_dist_comps", this->get_name());
+        this->lift_dist_comps();
+    }
+    {
+        compile_profiler::scope s("gen_time_space_domain", this->get_name());
+        this->gen_time_space_domain();
+    }
+    {
+        compile_profiler::scope s("gen_isl_ast", this->get_name());
+        this->gen_isl_ast();
+    }
     if (gen_cuda_stmt) {
+        compile_profiler::scope s("gen_cuda_stmt", this->get_name());
         this->gen_cuda_stmt();
     }
-    this->gen_halide_stmt();
-    this->gen_halide_obj(obj_filename);
+    {
+        compile_profiler::scope s("gen_halide_stmt", this->get_name());
+        this->gen_halide_stmt();
+    }
+    if (!gen_cuda_stmt && is_c_file_name(obj_filename))
+        this->gen_c_code(obj_filename);
+    else
+        this->gen_halide_obj(obj_filename);
+
+    compile_profiler::write_report();
 }
 
 /*
@@ -2524,6 +2756,9 @@ void tiramisu::function::codegen(const std::vector<tiramisu::buffer *> &argument
 #define USE_HALIDE_BUFFERS_BUG_WORKAROUND true
 void tiramisu::function::codegen(const std::vector<tiramisu::buffer *> &arguments, const std::string obj_filename, const tiramisu::hardware_architecture_t gen_architecture_flag)
 {
+    if (gen_architecture_flag != tiramisu::hardware_architecture_t::arch_cpu && !this->specializations.empty())
+        ERROR("specialize_on() is only supported for CPU code.", true);
+
     this->set_arguments(arguments);
     if (gen_architecture_flag == tiramisu::hardware_architecture_t::arch_nvidia_gpu ||
         gen_architecture_flag == tiramisu::hardware_architecture_t::arch_flexnlp)
@@ -2545,14 +2780,32 @@ void tiramisu::function::codegen(const std::vector<tiramisu::buffer *> &argument
     if (USE_HALIDE_BUFFERS_BUG_WORKAROUND)
         this->gen_halide_bug_workaround_computations();
 
-    this->lift_dist_comps();
-    this->gen_time_space_domain();
-    this->gen_isl_ast();
+    {
+        compile_profiler::scope s("lift_dist_comps", this->get_name());
+        this->lift_dist_comps();
+    }
+    {
+        compile_profiler::scope s("gen_time_space_domain", this->get_name());
+        this->gen_time_space_domain();
+    }
+    {
+        compile_profiler::scope s("gen_isl_ast", this->get_name());
+        this->gen_isl_ast();
+    }
     if (gen_architecture_flag == tiramisu::hardware_architecture_t::arch_nvidia_gpu){
+        compile_profiler::scope s("gen_cuda_stmt", this->get_name());
         this->gen_cuda_stmt();
     }
-    this->gen_halide_stmt();
-    this->gen_halide_obj(obj_filename, gen_architecture_flag);
+    {
+        compile_profiler::scope s("gen_halide_stmt", this->get_name());
+        this->gen_halide_stmt();
+    }
+    if (gen_architecture_flag == tiramisu::hardware_architecture_t::arch_cpu && is_c_file_name(obj_filename))
+        this->gen_c_code(obj_filename);
+    else
+        this->gen_halide_obj(obj_filename, gen_architecture_flag);
+
+    compile_profiler::write_report();
 }
 
 const std::vector<std::string> tiramisu::function::get_invariant_names() const
@@ -2769,6 +3022,369 @@ void tiramisu::function::prepare_schedules_for_legality_checks(bool reset_static
     this->gen_ordering_schedules();
 }
 
+/**
+  * Return the smallest factor by which the dimension \p dim of a buffer
+  * can be folded, given \p overlapping, the pairs of elements of the
+  * buffer that are live at the same time. Return -1 if the distance
+  * along \p dim between such elements is not bounded by a constant.
+  */
+static int get_storage_fold_factor(isl_map *overlapping, int dim)
+{
+    // Only the elements that differ along dim alone share a location
+    // once dim is folded.
+    isl_map *same_location = isl_map_copy(overlapping);
+    for (int i = 0; i < isl_map_dim(same_location, isl_dim_in); i++)
+        if (i != dim)
+            same_location = isl_map_equate(same_location, isl_dim_in, i, isl_dim_out, i);
+
+    isl_set *distances = isl_map_deltas(same_location);
+    if (isl_set_is_empty(distances) == isl_bool_true)
+    {
+        isl_set_free(distances);
+        return 1;
+    }
+
+    isl_aff *distance = isl_aff_var_on_domain(
+            isl_local_space_from_space(isl_set_get_space(distances)), isl_dim_set, dim);
+    isl_val *max = isl_set_max_val(distances, distance);
+    isl_val *min = isl_set_min_val(distances, distance);
+    isl_aff_free(distance);
+    isl_set_free(distances);
+
+    int factor = -1;
+    if (isl_val_is_int(max) == isl_bool_true && isl_val_is_int(min) == isl_bool_true)
+        factor = std::max(std::abs(isl_val_get_num_si(max)), std::abs(isl_val_get_num_si(min))) + 1;
+
+    isl_val_free(max);
+    isl_val_free(min);
+
+    return factor;
+}
+
+void tiramisu::function::fold_storage_automatically()
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    // The flow dependences under the current schedule, in the form
+    // { write -> read }.
+    this->performe_full_dependency_analysis();
+    isl_union_map *flow = isl_union_map_range_factor_domain(isl_union_map_copy(this->dep_read_after_write));
+
+    // The reuse distances are computed for a sequential execution of the
+    // loops. The lanes of a vectorized loop run at the same time, so they
+    // could store to the same folded location.
+    auto runs_concurrently = [this](const std::string &name) -> bool
+    {
+        for (const auto &d : this->parallel_dimensions)
+            if (d.first == name)
+                return true;
+        for (const auto &d : this->vector_dimensions)
+            if (std::get<0>(d) == name)
+                return true;
+        for (const auto &d : this->distributed_dimensions)
+            if (d.first == name)
+                return true;
+        for (const auto &d : this->gpu_block_dimensions)
+            if (d.first == name)
+                return true;
+        for (const auto &d : this->gpu_thread_dimensions)
+            if (d.first == name)
+                return true;
+        return false;
+    };
+
+    for (const auto &b : this->get_buffers())
+    {
+        tiramisu::buffer *buf = b.second;
+        if (buf->get_argument_type() != tiramisu::a_temporary || buf->get_dim_sizes().empty())
+            continue;
+
+        // The buffer must be written by a single computation, and each
+        // element must be written once.
+        std::vector<computation *> producers;
+        for (const auto &comp : this->get_computations())
+        {
+            const char *written = isl_map_get_tuple_name(comp->get_access_relation(), isl_dim_out);
+            if (written != NULL && buf->get_name() == written)
+                producers.push_back(comp);
+        }
+        if (producers.size() != 1 || runs_concurrently(producers[0]->get_name()))
+            continue;
+
+        computation *producer = producers[0];
+        isl_map *access = isl_map_intersect_domain(isl_map_copy(producer->get_access_relation()),
+                                                   isl_set_copy(producer->get_iteration_domain()));
+        isl_union_map *reads = isl_union_map_intersect_domain(
+                isl_union_map_copy(flow),
+                isl_union_set_from_set(isl_set_copy(producer->get_iteration_domain())));
+
+        bool foldable = (isl_map_is_injective(access) == isl_bool_true) &&
+                        (isl_union_map_is_empty(reads) == isl_bool_false);
+
+        // The time of the last read of each instance of the producer.
+        isl_map *last_read = NULL;
+        for (const auto &comp : this->get_computations())
+        {
+            if (!foldable)
+                break;
+
+            isl_union_map *comp_reads = isl_union_map_intersect_range(
+                    isl_union_map_copy(reads),
+                    isl_union_set_from_set(isl_set_copy(comp->get_iteration_domain())));
+            if (isl_union_map_is_empty(comp_reads) == isl_bool_true)
+            {
+                isl_union_map_free(comp_reads);
+                continue;
+            }
+
+            foldable = !runs_concurrently(comp->get_name());
+
+            isl_map *sched = isl_map_reset_tuple_id(isl_map_copy(comp->get_schedule()), isl_dim_out);
+            isl_map *read_times = isl_map_from_union_map(
+                    isl_union_map_apply_range(comp_reads, isl_union_map_from_map(sched)));
+            last_read = (last_read == NULL) ? read_times : isl_map_union(last_read, read_times);
+        }
+        isl_union_map_free(reads);
+
+        if (!foldable || last_read == NULL)
+        {
+            DEBUG(3, tiramisu::str_dump("The buffer " + buf->get_name() + " is not folded."));
+            isl_map_free(last_read);
+            isl_map_free(access);
+            continue;
+        }
+        last_read = isl_map_lexmax(last_read);
+
+        // The pairs of instances (w, w') of the producer such that w' runs
+        // after w and before the last read of w, i.e. that write elements
+        // live at the same time.
+        isl_map *write_time = isl_map_intersect_domain(
+                isl_map_reset_tuple_id(isl_map_copy(producer->get_schedule()), isl_dim_out),
+                isl_set_copy(producer->get_iteration_domain()));
+        isl_map *written_after = isl_map_lex_lt_map(isl_map_copy(write_time), isl_map_copy(write_time));
+        isl_map *written_before_last_read = isl_map_reverse(isl_map_lex_lt_map(write_time, last_read));
+        isl_map *overlapping = isl_map_intersect(written_after, written_before_last_read);
+        isl_map *element_to_instance = isl_map_reverse(isl_map_copy(access));
+        overlapping = isl_map_apply_range(element_to_instance, isl_map_apply_range(overlapping, access));
+
+        DEBUG(3, tiramisu::str_dump("Elements of " + buf->get_name() + " live at the same time: ",
+                                    isl_map_to_str(overlapping)));
+
+        // Fold the dimension that reduces the size of the buffer the most.
+        // Dimensions of symbolic size come first.
+        int best_dim = -1;
+        int best_factor = 0;
+        double best_reduction = 1;
+        for (int dim = 0; dim < (int) buf->get_dim_sizes().size(); dim++)
+        {
+            if (dim == (int) buf->get_dim_sizes().size() - 1 && buf->is_padded())
+                continue;
+
+            int factor = get_storage_fold_factor(overlapping, dim);
+            if (factor < 0)
+                continue;
+
+            const tiramisu::expr &size = buf->get_dim_sizes()[dim];
+            double reduction = size.is_constant() ? (double) size.get_int_val() / factor
+                                                  : std::numeric_limits<double>::infinity();
+            DEBUG(3, tiramisu::str_dump("Dimension " + std::to_string(dim) + " can be folded by a factor " +
+                                        std::to_string(factor)));
+            if (reduction > best_reduction)
+            {
+                best_dim = dim;
+                best_factor = factor;
+                best_reduction = reduction;
+            }
+        }
+        isl_map_free(overlapping);
+
+        if (best_dim >= 0)
+        {
+            DEBUG(3, tiramisu::str_dump("Folding the dimension " + std::to_string(best_dim) + " of " +
+                                        buf->get_name() + " by a factor " + std::to_string(best_factor)));
+            producer->storage_fold(best_dim, best_factor);
+        }
+    }
+
+    isl_union_map_free(flow);
+
+    DEBUG_INDENT(-4);
+}
+
+/**
+  * Return the number of cache lines that rows separated by \p stride bytes
+  * can occupy in a cache of \p cache_size bytes with the associativity
+  * \p associativity and lines of \p line_size bytes (the cache size,
+  * the size of a way and the size of a line are powers of two).
+  */
+static int64_t get_usable_cache_lines(int64_t stride, int cache_size, int associativity, int line_size)
+{
+    const int64_t way_size = cache_size / associativity;
+
+    // The rows are mapped to the sets of the cache with a period of
+    // way_size / gcd(stride, way_size) rows.
+    int64_t gcd = way_size;
+    while (gcd > 1 && stride % gcd != 0)
+        gcd /= 2;
+
+    int64_t sets = std::min(way_size / gcd, way_size / line_size);
+
+    return sets * associativity;
+}
+
+std::map<std::string, int> tiramisu::function::pad_buffers_automatically(int cache_size, int associativity,
+                                                                         int line_size)
+{
+    DEBUG_FCT_NAME(3);
+    DEBUG_INDENT(4);
+
+    assert(cache_size > 0 && associativity > 0 && line_size > 0);
+    assert((cache_size / associativity) % line_size == 0);
+
+    // The dimensions of each buffer that the innermost loop of a
+    // computation walks through (except the innermost dimension of the
+    // buffer): consecutive iterations of the loop access different rows.
+    std::map<std::string, std::set<int>> walked_dimensions;
+
+    auto add_walked_dimensions = [&](const computation *comp, isl_map *access)
+    {
+        int n_buffer_dims = isl_map_dim(access, isl_dim_out);
+        isl_map *sched = isl_map_intersect_domain(isl_map_copy(comp->get_schedule()),
+                                                  isl_set_copy(comp->get_iteration_domain()));
+        sched = isl_map_reset_tuple_id(sched, isl_dim_out);
+        int n_time_dims = isl_map_dim(sched, isl_dim_out);
+        int n_levels = (n_time_dims - 2) / 2;
+        if (n_buffer_dims < 2 || n_levels < 1)
+        {
+            isl_map_free(sched);
+            isl_map_free(access);
+            return;
+        }
+
+        // { t -> t' } where t' is the next iteration of the innermost loop.
+        int innermost = loop_level_into_dynamic_dimension(n_levels - 1);
+        std::string next = "{[";
+        for (int i = 0; i < n_time_dims; i++)
+            next += ((i > 0) ? ",t" : "t") + std::to_string(i);
+        next += "] -> [";
+        for (int i = 0; i < n_time_dims; i++)
+            next += ((i > 0) ? ",t" : "t") + std::to_string(i) + ((i == innermost) ? " + 1" : "");
+        next += "]}";
+
+        isl_map *time_access = isl_map_apply_range(isl_map_reverse(sched), access);
+        isl_map *element_to_time = isl_map_reverse(isl_map_copy(time_access));
+        isl_map *next_access = isl_map_apply_range(isl_map_read_from_str(this->get_isl_ctx(), next.c_str()),
+                                                   time_access);
+        isl_map *consecutive = isl_map_apply_range(element_to_time, next_access);
+        isl_set *distances = isl_map_deltas(consecutive);
+
+        const char *buffer_name = isl_set_get_tuple_name(distances);
+        for (int d = 0; buffer_name != NULL && d < n_buffer_dims - 1; d++)
+        {
+            isl_set *same_row = isl_set_fix_si(isl_set_copy(distances), isl_dim_set, d, 0);
+            if (isl_set_is_equal(same_row, distances) == isl_bool_false)
+                walked_dimensions[buffer_name].insert(d);
+            isl_set_free(same_row);
+        }
+        isl_set_free(distances);
+    };
+
+    for (const auto &comp : this->get_computations())
+    {
+        if (comp->get_access_relation() == NULL || !comp->should_schedule_this_computation())
+            continue;
+
+        add_walked_dimensions(comp, isl_map_copy(comp->get_access_relation()));
+
+        // The reads of the computation, from its iteration domain to the
+        // buffers of the computations it reads.
+        std::vector<isl_map *> accesses;
+        generator::get_rhs_accesses(this, comp, accesses, false);
+        for (isl_map *access : accesses)
+        {
+            const char *producer_name = isl_map_get_tuple_name(access, isl_dim_out);
+            std::vector<computation *> producers;
+            if (producer_name != NULL)
+                producers = this->get_computation_by_name(producer_name);
+            if (!producers.empty() && producers[0]->get_access_relation() != NULL &&
+                isl_map_dim(producers[0]->get_access_relation(), isl_dim_in) == isl_map_dim(access, isl_dim_out))
+                add_walked_dimensions(comp, isl_map_apply_range(isl_map_copy(access),
+                                                                isl_map_copy(producers[0]->get_access_relation())));
+            isl_map_free(access);
+        }
+    }
+
+    std::map<std::string, int> paddings;
+    const int64_t cache_lines = cache_size / line_size;
+
+    for (const auto &walked : walked_dimensions)
+    {
+        auto b = this->get_buffers().find(walked.first);
+        if (b == this->get_buffers().end())
+            continue;
+
+        // Only the buffers whose layout is decided by Tiramisu (temporaries)
+        // or by the wrapper of the function (inputs) are padded.
+        tiramisu::buffer *buf = b->second;
+        if ((buf->get_argument_type() != tiramisu::a_temporary && buf->get_argument_type() != tiramisu::a_input) ||
+            buf->location != cuda_ast::memory_location::host || buf->is_padded() ||
+            !buf->has_constant_extents())
+            continue;
+
+        const std::vector<tiramisu::expr> &sizes = buf->get_dim_sizes();
+        const int64_t element_size = halide_type_from_tiramisu_type(buf->get_elements_type()).bytes();
+        const int64_t innermost_size = sizes.back().get_int_val();
+
+        // The number of lines usable by the walks of the buffer when the
+        // innermost dimension is padded by p elements (the worst walk).
+        auto usable_lines = [&](int64_t p) -> int64_t
+        {
+            int64_t usable = cache_lines;
+            for (int d : walked.second)
+            {
+                int64_t stride = element_size * (innermost_size + p);
+                for (int i = d + 1; i < (int) sizes.size() - 1; i++)
+                    stride *= sizes[i].get_int_val();
+                usable = std::min(usable, get_usable_cache_lines(stride, cache_size, associativity, line_size));
+            }
+            return usable;
+        };
+
+        // Pad by the smallest number of elements that lets the walks use at
+        // least half of the cache, trying up to two lines of padding. The
+        // rows of aligned buffers stay aligned.
+        const int64_t step = std::max((int64_t) 1, buf->get_alignment() / element_size);
+        int64_t best_padding = 0;
+        int64_t best_usable = usable_lines(0);
+        for (int64_t p = step; best_usable < cache_lines / 2 && p * element_size <= 2 * line_size; p += step)
+        {
+            int64_t usable = usable_lines(p);
+            if (usable > best_usable)
+            {
+                best_padding = p;
+                best_usable = usable;
+            }
+        }
+
+        if (best_padding == 0)
+            continue;
+
+        DEBUG(3, tiramisu::str_dump("Padding the innermost dimension of " + buf->get_name() + " by " +
+                                    std::to_string(best_padding) + " elements (" +
+                                    std::to_string(usable_lines(0)) + " -> " + std::to_string(best_usable) +
+                                    " usable cache lines)."));
+
+        buf->set_padding(1, (int) best_padding);
+
+        paddings[buf->get_name()] = best_padding;
+    }
+
+    DEBUG_INDENT(-4);
+
+    return paddings;
+}
+
 bool tiramisu::function::loop_unrolling_is_legal(tiramisu::var i , std::vector<tiramisu::computation *> fuzed_computations)
 {
     DEBUG_FCT_NAME(3);
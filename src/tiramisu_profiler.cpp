@@ -0,0 +1,175 @@
+#include <tiramisu/profiler.h>
+#include <tiramisu/debug.h>
+
+#include <sys/resource.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace tiramisu
+{
+
+bool compile_profiler::enabled = false;
+bool compile_profiler::environment_checked = false;
+std::string compile_profiler::report_file_name;
+std::vector<compile_profiler::event> compile_profiler::events;
+std::chrono::steady_clock::time_point compile_profiler::origin;
+
+void compile_profiler::enable(const std::string &report_file_name)
+{
+    if (!compile_profiler::enabled)
+        compile_profiler::origin = std::chrono::steady_clock::now();
+
+    compile_profiler::enabled = true;
+    compile_profiler::environment_checked = true;
+    compile_profiler::report_file_name = report_file_name;
+}
+
+void compile_profiler::disable()
+{
+    compile_profiler::enabled = false;
+    compile_profiler::environment_checked = true;
+}
+
+bool compile_profiler::is_enabled()
+{
+    if (!compile_profiler::environment_checked)
+    {
+        compile_profiler::environment_checked = true;
+
+        const char *path = std::getenv("TIRAMISU_COMPILE_PROFILE");
+        if (path != NULL && path[0] != '\0')
+            compile_profiler::enable(path);
+    }
+
+    return compile_profiler::enabled;
+}
+
+const std::vector<compile_profiler::event> &compile_profiler::get_events()
+{
+    return compile_profiler::events;
+}
+
+void compile_profiler::clear()
+{
+    compile_profiler::events.clear();
+}
+
+long compile_profiler::get_peak_rss_kb()
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#ifdef __APPLE__
+    // ru_maxrss is in bytes on macOS and in kilobytes on Linux.
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+void compile_profiler::record(const compile_profiler::event &e)
+{
+    compile_profiler::events.push_back(e);
+}
+
+/**
+  * Escape \p str so that it can be written in a JSON string.
+  */
+static std::string json_escape(const std::string &str)
+{
+    std::ostringstream out;
+
+    for (char c : str)
+    {
+        switch (c)
+        {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if ((unsigned char) c < 0x20)
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c
+                        << std::dec << std::setfill(' ');
+                else
+                    out << c;
+        }
+    }
+
+    return out.str();
+}
+
+void compile_profiler::write_report()
+{
+    if (!compile_profiler::is_enabled())
+        return;
+
+    std::ofstream out(compile_profiler::report_file_name);
+    if (!out.is_open())
+    {
+        ERROR("Cannot open the compile profile report file " + compile_profiler::report_file_name + ".", false);
+        return;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+
+    for (size_t i = 0; i < compile_profiler::events.size(); i++)
+    {
+        const event &e = compile_profiler::events[i];
+
+        // Complete events ("ph": "X"). All the events are on the same thread
+        // so that per-computation events are nested under their phase.
+        out << "  {\"name\": \"" << json_escape(e.name) << "\", "
+            << "\"cat\": \"" << (e.computation_name.empty() ? "phase" : "computation") << "\", "
+            << "\"ph\": \"X\", \"pid\": 1, \"tid\": 1, "
+            << "\"ts\": " << e.start_us << ", \"dur\": " << e.duration_us << ", "
+            << "\"args\": {\"function\": \"" << json_escape(e.function_name) << "\", "
+            << "\"computation\": \"" << json_escape(e.computation_name) << "\", "
+            << "\"peak_rss_kb\": " << e.peak_rss_kb << ", "
+            << "\"peak_rss_growth_kb\": " << e.peak_rss_growth_kb << "}}";
+
+        if (i + 1 < compile_profiler::events.size())
+            out << ",";
+        out << std::endl;
+    }
+
+    out << "]}" << std::endl;
+}
+
+compile_profiler::scope::scope(const std::string &phase, const std::string &function_name,
+                               const std::string &computation_name)
+{
+    this->active = compile_profiler::is_enabled();
+    if (!this->active)
+        return;
+
+    this->e.name = phase;
+    this->e.function_name = function_name;
+    this->e.computation_name = computation_name;
+    this->e.peak_rss_kb = compile_profiler::get_peak_rss_kb();
+    this->start = std::chrono::steady_clock::now();
+}
+
+compile_profiler::scope::~scope()
+{
+    if (!this->active)
+        return;
+
+    auto end = std::chrono::steady_clock::now();
+
+    long peak_rss_at_start = this->e.peak_rss_kb;
+    this->e.peak_rss_kb = compile_profiler::get_peak_rss_kb();
+    this->e.peak_rss_growth_kb = this->e.peak_rss_kb - peak_rss_at_start;
+    this->e.start_us = std::chrono::duration<double, std::micro>(this->start - compile_profiler::origin).count();
+    this->e.duration_us = std::chrono::duration<double, std::micro>(end - this->start).count();
+
+    compile_profiler::record(this->e);
+}
+
+}
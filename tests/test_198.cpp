@@ -0,0 +1,63 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_198.h"
+
+using namespace tiramisu;
+
+/**
+ * Test native storage folding (function::set_native_storage_folding()).
+ *
+ * bx is a temporary consumed by by three rows at a time in the loop over
+ * rows, so its storage is folded into a line buffer of 3 * SIZE1 elements,
+ * rounded up to a power of two. Both computations are vectorized: the folded
+ * vector accesses must remain dense (ramps, not gathers or scatters).
+ */
+
+using namespace Halide::Internal;
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i0("i", 0, size0 + 2), i("i", 2, size0 + 2), j("j", 0, size1);
+
+    tiramisu::input in("in", {i0, j}, tiramisu::p_uint16);
+    tiramisu::computation bx("bx", {i0, j}, in(i0, j) + tiramisu::expr((uint16_t) 1));
+    tiramisu::computation by("by", {i, j}, bx(i - 2, j) + bx(i - 1, j) + bx(i, j));
+
+    bx.vectorize(j, 8);
+    by.vectorize(j, 8);
+    bx.then(by, i);
+
+    tiramisu::buffer b_in("b_in", {size0 + 2, size1}, tiramisu::p_uint16, tiramisu::a_input);
+    tiramisu::buffer b_bx("b_bx", {size0 + 2, size1}, tiramisu::p_uint16, tiramisu::a_temporary);
+    tiramisu::buffer b_by("b_by", {size0, size1}, tiramisu::p_uint16, tiramisu::a_output);
+
+    in.store_in(&b_in);
+    bx.store_in(&b_bx);
+    by.store_in(&b_by, {i - 2, j});
+
+    tiramisu::function *fct = tiramisu::global::get_implicit_function();
+    fct->set_native_storage_folding(true);
+
+    tiramisu::codegen({&b_in, &b_by}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    // Check the folded buffer in the lowered code.
+    stmt_summary lowered(lower_function(fct, true));
+
+    assert(lowered.allocations["b_bx"].size() == 1);
+    assert(allocation_extents(lowered.allocations["b_bx"][0]) == std::vector<int64_t>({64}));
+
+    for (const Load *load : lowered.loads["b_bx"])
+        assert(load->index.as<Ramp>() != nullptr);
+    for (const Store *store : lowered.stores["b_bx"])
+        assert(store->index.as<Ramp>() != nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
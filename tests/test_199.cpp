@@ -0,0 +1,42 @@
+#include <tiramisu/tiramisu.h>
+
+#include "wrapper_test_199.h"
+
+using namespace tiramisu;
+
+/**
+ * Test vectorize() with vector_tail_t::padded: the loop over 23 elements
+ * is vectorized by 8 without a scalar remainder, so the last vector reads
+ * and writes the padding element of each row (the buffers are padded to a
+ * multiple of 8 with buffer::set_padding()).
+ */
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1);
+
+    tiramisu::input A("A", {i, j}, tiramisu::p_int32);
+    tiramisu::computation B("B", {i, j}, A(i, j) * 2 + 1);
+
+    B.vectorize(j, 8, tiramisu::vector_tail_t::padded);
+
+    tiramisu::buffer b_A("b_A", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_B("b_B", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+    b_A.set_padding(8);
+    b_B.set_padding(8);
+    assert(b_B.get_dim_sizes().back().get_int_val() == PADDED_SIZE1);
+
+    A.store_in(&b_A);
+    B.store_in(&b_B);
+
+    tiramisu::codegen({&b_A, &b_B}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
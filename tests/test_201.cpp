@@ -0,0 +1,62 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_201.h"
+
+using namespace tiramisu;
+
+/**
+ * Test automatic scalar replacement (function::set_automatic_scalar_replacement())
+ * on a matrix multiplication (C[i][j] += A[i][k] * B[k][j], with an
+ * SIZE0 x SIZE1 result).
+ *
+ * The element of C written by the reduction does not depend on k, so the
+ * loop k is tagged for scalar replacement: the accumulator is a register
+ * and the loop k does not load or store the buffer of C.
+ */
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+    tiramisu::global::get_implicit_function()->set_automatic_scalar_replacement(true);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1), k("k", 0, size1);
+
+    tiramisu::input A("A", {i, k}, tiramisu::p_int32);
+    tiramisu::input B("B", {k, j}, tiramisu::p_int32);
+    tiramisu::computation C_init("C_init", {i, j}, tiramisu::expr((int32_t) 0));
+    tiramisu::computation C("C", {i, j, k}, tiramisu::p_int32);
+    C.set_expression(C(i, j, 0) + A(i, k) * B(k, j));
+
+    C_init.then(C, j);
+
+    tiramisu::buffer b_A("b_A", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_B("b_B", {size1, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_C("b_C", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+
+    A.store_in(&b_A);
+    B.store_in(&b_B);
+    C_init.store_in(&b_C);
+    C.store_in(&b_C, {i, j});
+
+    tiramisu::codegen({&b_A, &b_B, &b_C}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    stmt_summary stmt(tiramisu::global::get_implicit_function()->get_halide_stmt());
+
+    int reduction_loops = 0;
+    for (auto &loop : stmt.innermost_loops)
+        if (loop.loads["b_A"] > 0)
+        {
+            reduction_loops++;
+            assert(loop.loads["b_C"] == 0 && loop.stores["b_C"] == 0);
+            assert(count_with_prefix(loop.stores, "b_C_scalar") == 1);
+        }
+    assert(reduction_loops == 1);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
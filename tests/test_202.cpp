@@ -0,0 +1,69 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_202.h"
+
+using namespace tiramisu;
+
+/**
+ * Test that automatic scalar replacement bails out when the accumulator of a
+ * reduction is accessed at another element in the same loop.
+ *
+ * The loop k of the matrix multiplication C[i][j] += A[i][k] * B[k][j] is
+ * fused with D[i][j][k] = C[i][k], which reads C at an element that depends
+ * on k. The loop k is tagged for scalar replacement (the element written by
+ * C does not depend on k) but C cannot be kept in a register: the loop k
+ * must still load and store the buffer of C, and the result must be the one
+ * of the sequential code.
+ */
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+    tiramisu::global::get_implicit_function()->set_automatic_scalar_replacement(true);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1), k("k", 0, size1);
+
+    tiramisu::input A("A", {i, k}, tiramisu::p_int32);
+    tiramisu::input B("B", {k, j}, tiramisu::p_int32);
+    tiramisu::computation C_init("C_init", {i, j}, tiramisu::expr((int32_t) 0));
+    tiramisu::computation C("C", {i, j, k}, tiramisu::p_int32);
+    C.set_expression(C(i, j, 0) + A(i, k) * B(k, j));
+    tiramisu::computation D("D", {i, j, k}, C(i, k, 0));
+
+    C_init.then(C, j).then(D, k);
+
+    tiramisu::buffer b_A("b_A", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_B("b_B", {size1, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_C("b_C", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+    tiramisu::buffer b_D("b_D", {size0, size1, size1}, tiramisu::p_int32, tiramisu::a_output);
+
+    A.store_in(&b_A);
+    B.store_in(&b_B);
+    C_init.store_in(&b_C);
+    C.store_in(&b_C, {i, j});
+    D.store_in(&b_D);
+
+    tiramisu::codegen({&b_A, &b_B, &b_C, &b_D}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    stmt_summary stmt(tiramisu::global::get_implicit_function()->get_halide_stmt());
+
+    int fused_loops = 0;
+    for (auto &loop : stmt.innermost_loops)
+        if (loop.loads["b_A"] > 0)
+        {
+            fused_loops++;
+            assert(loop.stores["b_C"] > 0);
+        }
+    assert(fused_loops == 1);
+
+    for (const auto &store : stmt.stores)
+        assert(store.first.compare(0, std::string("b_C_scalar").size(), "b_C_scalar") != 0);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_203.h"
+
+using namespace tiramisu;
+
+/**
+ * Test computation::tag_streaming_store().
+ *
+ * S0 and S1 write the same buffer, only S0 is tagged: only the stores of
+ * S0 must be non-temporal (between the markers kept in the lowered code,
+ * and still stores to b_out). S1 reads the values that S0 writes with non-temporal
+ * stores in a parallel loop, so the output also checks that these stores
+ * are visible after the parallel loop (store fence).
+ */
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1);
+
+    tiramisu::input in("in", {i, j}, tiramisu::p_int32);
+    tiramisu::computation S0("S0", {i, j}, in(i, j) * 2);
+    tiramisu::computation S1("S1", {i, j}, tiramisu::p_int32);
+    S1.set_expression(S0(i, j) + 1);
+
+    S0.vectorize(j, 8);
+    S0.tag_parallel_level(i);
+    S0.tag_streaming_store();
+    S0.then(S1, tiramisu::computation::root);
+
+    tiramisu::buffer b_in("b_in", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_out("b_out", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+
+    in.store_in(&b_in);
+    S0.store_in(&b_out);
+    S1.store_in(&b_out);
+
+    tiramisu::codegen({&b_in, &b_out}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    // Check the stores in the lowered code, with the markers kept.
+    stmt_summary lowered(lower_function(tiramisu::global::get_implicit_function(), false, true));
+
+    // Only stores to b_out, the stores of S0 are non-temporal and do not
+    // read b_out, the stores of S1 read b_out.
+    int stores = lowered.stores["b_out"].size();
+    int regular_stores = stores - lowered.nontemporal_stores["b_out"];
+    assert(lowered.stores.size() == 1);
+    assert(lowered.nontemporal_stores["b_out"] > 0);
+    assert(regular_stores > 0);
+    assert(lowered.nontemporal_read_back_stores["b_out"] == 0);
+    assert(lowered.read_back_stores["b_out"] == regular_stores);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include <tiramisu/tiramisu.h>
+
+#include "wrapper_test_204.h"
+
+using namespace tiramisu;
+
+/**
+ * Test buffer::set_alignment() on a temporary buffer (allocated with
+ * tiramisu_aligned_malloc and freed with tiramisu_aligned_free) and on an
+ * argument (the generated code checks the alignment of the argument and
+ * runs an aligned or a generic version of the code). The wrapper calls the
+ * function with an aligned and with a misaligned input to run both versions.
+ */
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1);
+
+    tiramisu::input in("in", {i, j}, tiramisu::p_int32);
+    tiramisu::computation tmp("tmp", {i, j}, in(i, j) * 3);
+    tiramisu::computation out("out", {i, j}, tmp(i, j) + 1);
+
+    tmp.vectorize(j, 8);
+    out.vectorize(j, 8);
+    tmp.then(out, tiramisu::computation::root);
+
+    tiramisu::buffer b_in("b_in", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_tmp("b_tmp", {size0, size1}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_out("b_out", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+    b_in.set_alignment(64);
+    b_tmp.set_alignment(64);
+
+    in.store_in(&b_in);
+    tmp.store_in(&b_tmp);
+    out.store_in(&b_out);
+
+    tiramisu::codegen({&b_in, &b_out}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_205.h"
+
+using namespace tiramisu;
+
+/**
+ * Test function::specialize_on().
+ *
+ * The output S1 is vectorized only in the version specialized for
+ * N % 8 = 0. The schedule of the specialization separates S1 (the
+ * computation of the vector tail is created in the callback) and sets the
+ * alignment of the output buffer: only the specialized version checks the
+ * alignment of the output, the generic version must be generated with
+ * the generic schedule and the generic buffers, and the computation
+ * created in the callback must be removed from the function. (The
+ * storage of the temporary S0_b cannot be changed by a specialization.)
+ * The wrapper calls the function with N = 16 (specialized version) and
+ * N = 13 (generic version).
+ */
+
+void generate_function(std::string name)
+{
+    tiramisu::global::set_default_tiramisu_options();
+
+    tiramisu::function function0(name);
+    tiramisu::var i("i"), j("j");
+
+    tiramisu::computation SIZEs_computation("{SIZEs_computation[0]}", tiramisu::expr(), false, p_int32, &function0);
+    tiramisu::constant N("N", SIZEs_computation(0), p_int32, true, NULL, 0, &function0);
+    tiramisu::computation S0("[N]->{S0[i,j]: 0<=i<N and 0<=j<N}", i + j, true, p_int32, &function0);
+    tiramisu::computation S1("[N]->{S1[i,j]: 0<=i<N and 0<=j<N}", S0(i, j) + tiramisu::expr((int32_t) 1), true, p_int32, &function0);
+
+    S1.after(S0, computation::root);
+
+    tiramisu::buffer SIZEs_buffer("SIZEs_buffer", {1}, tiramisu::p_int32, a_input, &function0);
+    tiramisu::buffer S0_b("S0_b", {tiramisu::var("N"), tiramisu::var("N")}, tiramisu::p_int32, a_temporary, &function0);
+    tiramisu::buffer S1_b("S1_b", {tiramisu::var("N"), tiramisu::var("N")}, tiramisu::p_int32, a_output, &function0);
+
+    SIZEs_computation.store_in(&SIZEs_buffer);
+    S0.store_in(&S0_b);
+    S1.store_in(&S1_b);
+
+    size_t generic_computations = function0.get_computations().size();
+    int generic_alignment = S1_b.get_alignment();
+
+    function0.specialize_on("[N]->{: N % 8 = 0}", [&]() {
+        S1.vectorize(j, 8);
+        S1_b.set_alignment(64);
+    });
+
+    function0.set_arguments({&SIZEs_buffer, &S1_b});
+    function0.gen_time_space_domain();
+    function0.gen_isl_ast();
+    function0.gen_halide_stmt();
+    function0.gen_halide_obj("build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    // The generic version is restored.
+    assert(function0.get_computations().size() == generic_computations);
+    assert(function0.get_computation_by_name("S1").size() == 1);
+    assert(S1_b.get_alignment() == generic_alignment);
+
+    // The outermost condition selects the version.
+    stmt_summary stmt(function0.get_halide_stmt());
+    assert(!stmt.ifs.empty() && stmt.ifs[0]->else_case.defined());
+
+    stmt_summary specialized(stmt.ifs[0]->then_case);
+    stmt_summary generic(stmt.ifs[0]->else_case);
+    assert(specialized.vectorized_loops > 0);
+    assert(generic.vectorized_loops == 0);
+
+    // Only the specialized version checks the alignment of S1_b.
+    assert(specialized.condition_variables.count("S1_b") == 1);
+    assert(generic.condition_variables.count("S1_b") == 0);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code");
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <tiramisu/tiramisu.h>
+
+#include <fstream>
+
+#include "wrapper_test_206.h"
+
+using namespace tiramisu;
+
+/**
+ * Test the C backend (codegen() with a ".c" output file, see
+ * function::gen_c_code()).
+ *
+ * The same function is generated as an object file (tiramisu_generated_code)
+ * and as a C file (tiramisu_generated_code_c). The C file is compiled with
+ * -fopenmp and the wrapper compares the two versions. The function has
+ * parallel and vectorized loops, a temporary buffer allocated with malloc
+ * (b_tmp) and registers allocated as local arrays (the accumulator of the
+ * reduction, see function::set_automatic_scalar_replacement()).
+ */
+
+void generate_function(std::string name, int size0, int size1, std::string file_name)
+{
+    tiramisu::init(name);
+    tiramisu::global::get_implicit_function()->set_automatic_scalar_replacement(true);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1), k("k", 0, size1);
+
+    tiramisu::input A("A", {i, k}, tiramisu::p_int32);
+    tiramisu::input B("B", {k, j}, tiramisu::p_int32);
+    tiramisu::computation tmp("tmp", {i, k}, A(i, k) * 2 + 1);
+    tiramisu::computation C_init("C_init", {i, j}, tiramisu::expr((int32_t) 0));
+    tiramisu::computation C("C", {i, j, k}, tiramisu::p_int32);
+    C.set_expression(C(i, j, 0) + tmp(i, k) * B(k, j));
+    tiramisu::computation D("D", {i, j}, C(i, j, 0) - tmp(i, j));
+
+    tmp.then(C_init, tiramisu::computation::root)
+       .then(C, j)
+       .then(D, tiramisu::computation::root);
+    tmp.parallelize(i);
+    C_init.parallelize(i);
+    D.parallelize(i);
+    D.vectorize(j, 8);
+
+    tiramisu::buffer b_A("b_A", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_B("b_B", {size1, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_tmp("b_tmp", {size0, size1}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_C("b_C", {size0, size1}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_D("b_D", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+
+    A.store_in(&b_A);
+    B.store_in(&b_B);
+    tmp.store_in(&b_tmp);
+    C_init.store_in(&b_C);
+    C.store_in(&b_C, {i, j});
+    D.store_in(&b_D);
+
+    tiramisu::codegen({&b_A, &b_B, &b_D}, file_name);
+}
+
+int main(int argc, char **argv)
+{
+    std::string file_name = "build/generated_fct_test_" + std::string(TEST_NUMBER_STR);
+
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1, file_name + ".o");
+    generate_function("tiramisu_generated_code_c", SIZE0, SIZE1, file_name + ".c");
+
+    // The temporary buffers (SIZE0 * SIZE1 elements) are allocated with
+    // malloc and the registers are local arrays.
+    std::ifstream c_file(file_name + ".c");
+    std::string line;
+    bool malloc_found = false, local_array_found = false;
+    while (std::getline(c_file, line))
+    {
+        malloc_found = malloc_found || (line.find(" *restrict b_tmp = (int32_t *)tiramisu_c_malloc(") != std::string::npos);
+        local_array_found = local_array_found || ((line.find("int32_t b_C_scalar") != std::string::npos) &&
+                                                  (line.find("[1];") != std::string::npos));
+        assert(line.find("return -1") == std::string::npos);
+    }
+    assert(malloc_found);
+    assert(local_array_found);
+
+    return 0;
+}
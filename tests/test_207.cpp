@@ -0,0 +1,96 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_207.h"
+
+using namespace tiramisu;
+
+/**
+ * Test the memory planner (function::set_memory_planning()).
+ *
+ * t1 and t2 are temporary buffers of the same size, and t2 is computed
+ * element-wise from t1 in the loop nest where t1 dies: t2 reuses the
+ * storage of t1 in place, so the arena has the size of one buffer. The
+ * same function without memory planning allocates t1 and t2 separately.
+ * The wrapper checks the output of the planned function.
+ */
+
+using namespace Halide::Internal;
+
+stmt_summary generate_function(std::string name, int size0, int size1, bool memory_planning)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1);
+
+    tiramisu::input in("in", {i, j}, tiramisu::p_int32);
+    tiramisu::computation t1("t1", {i, j}, in(i, j) * 2);
+    tiramisu::computation t2("t2", {i, j}, t1(i, j) + 1);
+    tiramisu::computation out("out", {i, j}, t2(i, j) * 3);
+
+    t1.then(t2, tiramisu::computation::root)
+      .then(out, tiramisu::computation::root);
+
+    tiramisu::buffer b_in("b_in", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_t1("b_t1", {size0, size1}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_t2("b_t2", {size0, size1}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_out("b_out", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+
+    in.store_in(&b_in);
+    t1.store_in(&b_t1);
+    t2.store_in(&b_t2);
+    out.store_in(&b_out);
+
+    tiramisu::function *fct = tiramisu::global::get_implicit_function();
+    fct->set_memory_planning(memory_planning);
+
+    if (memory_planning)
+        tiramisu::codegen({&b_in, &b_out}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+    else
+    {
+        fct->set_arguments({&b_in, &b_out});
+        fct->gen_time_space_domain();
+        fct->gen_isl_ast();
+        fct->gen_halide_stmt();
+    }
+
+    return stmt_summary(fct->get_halide_stmt());
+}
+
+/**
+ * Return the offset of \p buffer in the arena allocated by the memory
+ * planner, or nullptr if \p buffer is not in the arena.
+ */
+const uint64_t *arena_offset(stmt_summary &plan, const std::string &buffer)
+{
+    for (const LetStmt *let : plan.lets[buffer])
+    {
+        const Call *call = let->value.as<Call>();
+        if (call != nullptr && call->name == "tiramisu_arena_address")
+            return as_const_uint(call->args[1]);
+    }
+    return nullptr;
+}
+
+int main(int argc, char **argv)
+{
+    stmt_summary planned = generate_function("tiramisu_generated_code", SIZE0, SIZE1, true);
+    stmt_summary unplanned = generate_function("tiramisu_generated_code_unplanned", SIZE0, SIZE1, false);
+
+    // t2 overwrites t1 in place.
+    const uint64_t *offset_t1 = arena_offset(planned, "b_t1");
+    const uint64_t *offset_t2 = arena_offset(planned, "b_t2");
+    assert(planned.calls["tiramisu_arena_address"].size() == 2);
+    assert(offset_t1 != nullptr && offset_t2 != nullptr && *offset_t1 == *offset_t2);
+
+    assert(planned.calls["tiramisu_aligned_malloc"].size() == 1);
+    const uint64_t *arena_size = as_const_uint(planned.calls["tiramisu_aligned_malloc"][0]->args[0]);
+    assert(arena_size != nullptr && *arena_size == SIZE0 * SIZE1 * sizeof(int32_t));
+    assert(planned.allocations.count("b_t1") == 0 && planned.allocations.count("b_t2") == 0);
+
+    // Without memory planning, each buffer has its own allocation.
+    assert(unplanned.calls.count("tiramisu_arena_address") == 0);
+    assert(unplanned.allocations.count("b_t1") == 1 && unplanned.allocations.count("b_t2") == 1);
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_208.h"
+
+using namespace tiramisu;
+
+/**
+ * Test function::fold_storage_automatically() on a blur.
+ *
+ * bx is computed in the loop over the rows of by, and each row of bx is
+ * read by the next three rows of by: the rows of b_bx are folded by a
+ * factor 3 (a rolling buffer of three rows).
+ *
+ * t is computed element-wise in the vectorized loop of its consumer u:
+ * sequentially each element of b_t would be dead once u reads it, but the
+ * lanes of the vector run at the same time, so b_t is not folded.
+ */
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i0("i", 0, size0 + 2), i("i", 2, size0 + 2), j("j", 0, size1);
+
+    tiramisu::input in("in", {i0, j}, tiramisu::p_uint16);
+    tiramisu::computation bx("bx", {i0, j}, in(i0, j) + tiramisu::expr((uint16_t) 1));
+    tiramisu::computation by("by", {i, j}, bx(i - 2, j) + bx(i - 1, j) + bx(i, j));
+
+    tiramisu::var x("x", 0, size0), y("y", 0, size1), y0("y0"), y1("y1");
+
+    tiramisu::input in2("in2", {x, y}, tiramisu::p_uint16);
+    tiramisu::computation t("t", {x, y}, in2(x, y) * tiramisu::expr((uint16_t) 2));
+    tiramisu::computation u("u", {x, y}, t(x, y) + tiramisu::expr((uint16_t) 1));
+
+    t.vectorize(y, 8, y0, y1);
+    u.vectorize(y, 8, y0, y1);
+
+    bx.then(by, i)
+      .then(t, tiramisu::computation::root)
+      .then(u, y1);
+
+    tiramisu::buffer b_in("b_in", {size0 + 2, size1}, tiramisu::p_uint16, tiramisu::a_input);
+    tiramisu::buffer b_bx("b_bx", {size0 + 2, size1}, tiramisu::p_uint16, tiramisu::a_temporary);
+    tiramisu::buffer b_by("b_by", {size0, size1}, tiramisu::p_uint16, tiramisu::a_output);
+    tiramisu::buffer b_in2("b_in2", {size0, size1}, tiramisu::p_uint16, tiramisu::a_input);
+    tiramisu::buffer b_t("b_t", {size0, size1}, tiramisu::p_uint16, tiramisu::a_temporary);
+    tiramisu::buffer b_u("b_u", {size0, size1}, tiramisu::p_uint16, tiramisu::a_output);
+
+    in.store_in(&b_in);
+    bx.store_in(&b_bx);
+    by.store_in(&b_by, {i - 2, j});
+    in2.store_in(&b_in2);
+    t.store_in(&b_t);
+    u.store_in(&b_u);
+
+    tiramisu::fold_storage_automatically();
+
+    assert(b_bx.get_dim_sizes()[0].get_int_val() == 3);
+    assert(b_bx.get_dim_sizes()[1].get_int_val() == size1);
+    assert(b_t.get_dim_sizes()[0].get_int_val() == size0);
+    assert(b_t.get_dim_sizes()[1].get_int_val() == size1);
+
+    tiramisu::codegen({&b_in, &b_by, &b_in2, &b_u}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    stmt_summary stmt(tiramisu::global::get_implicit_function()->get_halide_stmt());
+    assert(stmt.allocations["b_bx"].size() == 1 && stmt.allocations["b_t"].size() == 1);
+    assert(allocation_extents(stmt.allocations["b_bx"][0]) == std::vector<int64_t>({size1, 3}));
+    assert(allocation_extents(stmt.allocations["b_t"][0]) == std::vector<int64_t>({size1, size0}));
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
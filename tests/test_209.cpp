@@ -0,0 +1,60 @@
+#include <tiramisu/tiramisu.h>
+
+#include "wrapper_test_209.h"
+
+using namespace tiramisu;
+
+/**
+ * Test buffer::set_layout() on NCHW buffers.
+ *
+ * The temporary t1 is stored as NCHWc16 (the channels are blocked by 16)
+ * and the temporary t2 as NHWC. The wrapper compares the output with a
+ * reference computed with the default (NCHW) layout.
+ */
+
+void generate_function(std::string name)
+{
+    tiramisu::init(name);
+
+    tiramisu::var n("n", 0, SIZE_N), c("c", 0, SIZE_C), h("h", 0, SIZE_H), w("w", 0, SIZE_W);
+
+    tiramisu::input in("in", {n, c, h, w}, tiramisu::p_int32);
+    tiramisu::computation t1("t1", {n, c, h, w}, in(n, c, h, w) * 2);
+    tiramisu::computation t2("t2", {n, c, h, w}, t1(n, c, h, w) + c);
+    tiramisu::computation out("out", {n, c, h, w}, t2(n, c, h, w) * 3 + t1(n, c, h, w));
+
+    t1.then(t2, tiramisu::computation::root)
+      .then(out, tiramisu::computation::root);
+
+    tiramisu::buffer b_in("b_in", {SIZE_N, SIZE_C, SIZE_H, SIZE_W}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_t1("b_t1", {SIZE_N, SIZE_C, SIZE_H, SIZE_W}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_t2("b_t2", {SIZE_N, SIZE_C, SIZE_H, SIZE_W}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_out("b_out", {SIZE_N, SIZE_C, SIZE_H, SIZE_W}, tiramisu::p_int32, tiramisu::a_output);
+
+    in.store_in(&b_in);
+    t1.store_in(&b_t1);
+    t2.store_in(&b_t2);
+    out.store_in(&b_out);
+
+    // NCHW -> NCHWc16
+    b_t1.set_layout({}, {{1, 16}});
+    assert(b_t1.get_n_dims() == 5);
+    assert(b_t1.get_dim_sizes()[1].get_int_val() == SIZE_C / 16);
+    assert(b_t1.get_dim_sizes()[4].get_int_val() == 16);
+
+    // NCHW -> NHWC
+    b_t2.set_layout({0, 2, 3, 1});
+    assert(b_t2.get_n_dims() == 4);
+    assert(b_t2.get_dim_sizes()[1].get_int_val() == SIZE_H);
+    assert(b_t2.get_dim_sizes()[2].get_int_val() == SIZE_W);
+    assert(b_t2.get_dim_sizes()[3].get_int_val() == SIZE_C);
+
+    tiramisu::codegen({&b_in, &b_out}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code");
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <tiramisu/tiramisu.h>
+
+#include "wrapper_test_210.h"
+
+using namespace tiramisu;
+
+/**
+ * Test function::pad_buffers_automatically() on a transposition.
+ *
+ * out reads the columns of t1 and t2. With rows of 1024 floats, the rows
+ * of a column are 4 KiB apart and map to one set of a 32 KiB, 8-way
+ * cache. t1 is padded by one element, and t2, which is aligned to 64
+ * bytes, by 16 elements so that its rows stay aligned. in and out are
+ * read and written along the rows and are not padded.
+ */
+
+void generate_function(std::string name, int size)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, size), j("j", 0, size);
+
+    tiramisu::input in("in", {i, j}, tiramisu::p_float32);
+    tiramisu::computation t1("t1", {i, j}, in(i, j) * tiramisu::expr((float) 2));
+    tiramisu::computation t2("t2", {i, j}, in(i, j) * tiramisu::expr((float) 3));
+    tiramisu::computation out("out", {i, j}, t1(j, i) + t2(j, i));
+
+    t1.then(t2, tiramisu::computation::root).then(out, tiramisu::computation::root);
+
+    tiramisu::buffer b_in("b_in", {size, size}, tiramisu::p_float32, tiramisu::a_input);
+    tiramisu::buffer b_t1("b_t1", {size, size}, tiramisu::p_float32, tiramisu::a_temporary);
+    tiramisu::buffer b_t2("b_t2", {size, size}, tiramisu::p_float32, tiramisu::a_temporary);
+    tiramisu::buffer b_out("b_out", {size, size}, tiramisu::p_float32, tiramisu::a_output);
+
+    in.store_in(&b_in);
+    t1.store_in(&b_t1);
+    t2.store_in(&b_t2);
+    out.store_in(&b_out);
+
+    b_t2.set_alignment(64);
+
+    std::map<std::string, int> paddings = tiramisu::pad_buffers_automatically(32 * 1024, 8, 64);
+
+    assert(paddings.size() == 2);
+    assert(paddings["b_t1"] == 1);
+    assert(paddings["b_t2"] == 16);
+
+    assert(b_t1.get_padding() == 1 && b_t1.get_extra_padding() == 1 && b_t1.is_padded());
+    assert(b_t1.get_dim_sizes()[1].get_int_val() == size + 1);
+    assert(b_t2.get_padding() == 1 && b_t2.get_extra_padding() == 16 && b_t2.is_padded());
+    assert(b_t2.get_dim_sizes()[1].get_int_val() == size + 16);
+    assert(!b_in.is_padded() && b_in.get_dim_sizes()[1].get_int_val() == size);
+    assert(!b_out.is_padded() && b_out.get_dim_sizes()[1].get_int_val() == size);
+
+    // The padded buffers are not padded again.
+    assert(tiramisu::pad_buffers_automatically(32 * 1024, 8, 64).empty());
+
+    tiramisu::codegen({&b_in, &b_out}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE);
+
+    return 0;
+}
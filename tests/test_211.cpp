@@ -0,0 +1,73 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_211.h"
+
+using namespace tiramisu;
+
+/**
+ * Test the allocation of the buffers allocated inside a parallel loop
+ * (buffer::allocate_at()).
+ *
+ * b_s (SIZE1 int32, 256 bytes) fits on the stack and is allocated with a
+ * Halide Allocate. b_l (SIZE2 int32, 32 KiB) is allocated in the arena of
+ * the thread with tiramisu_thread_arena_malloc and released with
+ * tiramisu_thread_arena_free at the end of each iteration. The wrapper
+ * tests the arena itself (reuse, alignment and malloc fallback) with a
+ * user allocator (tiramisu_set_thread_arena_allocator()).
+ */
+
+using namespace Halide::Internal;
+
+void generate_function(std::string name)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, SIZE0), j("j", 0, SIZE1), k("k", 0, SIZE2);
+
+    tiramisu::input in("in", {i, j}, tiramisu::p_int32);
+    tiramisu::computation s("s", {i, j}, in(i, j) + 1);
+    tiramisu::computation l("l", {i, k}, i * 2 + k);
+    tiramisu::computation out("out", {i, j}, s(i, j) + l(i, j * (SIZE2 / SIZE1)));
+
+    tiramisu::buffer b_in("b_in", {SIZE0, SIZE1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_s("b_s", {SIZE1}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_l("b_l", {SIZE2}, tiramisu::p_int32, tiramisu::a_temporary);
+    tiramisu::buffer b_out("b_out", {SIZE0, SIZE1}, tiramisu::p_int32, tiramisu::a_output);
+
+    in.store_in(&b_in);
+    s.store_in(&b_s, {j});
+    l.store_in(&b_l, {k});
+    out.store_in(&b_out);
+
+    tiramisu::computation *allocate_s = b_s.allocate_at(s, i);
+    tiramisu::computation *allocate_l = b_l.allocate_at(l, i);
+
+    allocate_s->then(*allocate_l, i)
+               .then(s, i)
+               .then(l, i)
+               .then(out, i);
+    s.parallelize(i);
+
+    tiramisu::codegen({&b_in, &b_out}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    stmt_summary stmt(tiramisu::global::get_implicit_function()->get_halide_stmt());
+
+    // b_s is on the stack, b_l in the arena of the thread, both in the loop.
+    assert(stmt.allocations["b_s"].size() == 1 && stmt.loop_depth[stmt.allocations["b_s"][0]] > 0);
+    assert(stmt.allocations.count("b_l") == 0);
+    assert(stmt.lets["b_l"].size() == 1 && stmt.loop_depth[stmt.lets["b_l"][0]] > 0);
+
+    const Call *call = stmt.lets["b_l"][0]->value.as<Call>();
+    assert(call != nullptr && call->name == "tiramisu_thread_arena_malloc");
+    assert(stmt.calls["tiramisu_thread_arena_malloc"].size() == 1);
+    assert(stmt.calls["tiramisu_thread_arena_free"].size() == 1);
+    assert(stmt.calls.count("tiramisu_aligned_malloc") == 0);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code");
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_212.h"
+
+using namespace tiramisu;
+
+/**
+ * Test computation::tag_streaming_store() on computations that read back
+ * what their non-temporal stores wrote in the same loop.
+ *
+ * P computes the prefix sums of the rows of the input (a recurrence that
+ * reads the element written by the previous iteration) and R computes
+ * the sums of the rows (a reduction that reads and writes the same
+ * element at each iteration). Both are tagged: their stores keep the name
+ * of their buffer (so LLVM orders them with the loads of the buffer) and
+ * are between markers in the lowered code. The wrapper checks the output.
+ */
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, size0), j0("j", 0, 1), j("j", 1, size1), k("k", 0, size1);
+
+    tiramisu::input in("in", {i, k}, tiramisu::p_int32);
+
+    tiramisu::computation P0("P0", {i, j0}, in(i, j0));
+    tiramisu::computation P("P", {i, j}, tiramisu::p_int32);
+    P.set_expression(P(i, j - 1) + in(i, j));
+
+    tiramisu::computation R0("R0", {i}, tiramisu::expr((int32_t) 0));
+    tiramisu::computation R("R", {i, k}, tiramisu::p_int32);
+    R.set_expression(R(i, k - 1) + in(i, k));
+
+    P0.then(P, i)
+      .then(R0, i)
+      .then(R, i);
+    P0.tag_parallel_level(i);
+    P.tag_streaming_store();
+    R.tag_streaming_store();
+
+    tiramisu::buffer b_in("b_in", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_out("b_out", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+    tiramisu::buffer b_sum("b_sum", {size0}, tiramisu::p_int32, tiramisu::a_output);
+
+    in.store_in(&b_in);
+    P0.store_in(&b_out);
+    P.store_in(&b_out);
+    R0.store_in(&b_sum, {i});
+    R.store_in(&b_sum, {i});
+
+    tiramisu::codegen({&b_in, &b_out, &b_sum},
+                      "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    // Check the stores in the lowered code, with the markers kept.
+    stmt_summary lowered(lower_function(tiramisu::global::get_implicit_function(), false, true));
+    assert(lowered.nontemporal_read_back_stores["b_out"] > 0);
+    assert(lowered.nontemporal_read_back_stores["b_sum"] > 0);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
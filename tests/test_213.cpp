@@ -0,0 +1,81 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_213.h"
+
+using namespace tiramisu;
+
+/**
+ * Test computation::prefetch().
+ *
+ * out reads A and C. The data of the buffer b_A is prefetched 16
+ * iterations ahead in the loop j, and the data of the input C 1 iteration
+ * ahead in the loop i (i.e. the next row of b_C). The generated statement
+ * must prefetch exactly these two accesses: the index of each prefetch is
+ * the index of a load of the same buffer, shifted by the distance times
+ * the stride of the loop. The wrapper checks the output.
+ */
+
+using namespace Halide::Internal;
+
+/**
+ * Return true if one of the loads of \p buffer is at \p offset elements
+ * before the element prefetched by \p prefetch.
+ */
+bool prefetches_load(stmt_summary &stmt, const Call *prefetch, const std::string &buffer, int64_t offset)
+{
+    const Variable *base = prefetch->args[0].as<Variable>();
+    if (base == nullptr || base->name != buffer)
+        return false;
+
+    for (const Load *load : stmt.loads[buffer])
+    {
+        const int64_t *distance = as_const_int(simplify(prefetch->args[1] - load->index));
+        if (distance != nullptr && *distance == offset)
+            return true;
+    }
+    return false;
+}
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1);
+
+    tiramisu::input A("A", {i, j}, tiramisu::p_int32);
+    tiramisu::input C("C", {i, j}, tiramisu::p_int32);
+    tiramisu::computation out("out", {i, j}, A(i, j) + C(i, j) * 2);
+
+    tiramisu::buffer b_A("b_A", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_C("b_C", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_out("b_out", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+
+    A.store_in(&b_A);
+    C.store_in(&b_C);
+    out.store_in(&b_out);
+
+    out.prefetch(&b_A, j, 16);
+    out.prefetch(C, i, 1);
+
+    tiramisu::codegen({&b_A, &b_C, &b_out}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    stmt_summary stmt(tiramisu::global::get_implicit_function()->get_halide_stmt());
+    const std::vector<const Call *> &prefetches = stmt.calls["prefetch"];
+    assert(prefetches.size() == 2);
+
+    bool prefetch_A = false, prefetch_C = false;
+    for (const Call *prefetch : prefetches)
+    {
+        prefetch_A = prefetch_A || prefetches_load(stmt, prefetch, "b_A", 16);
+        prefetch_C = prefetch_C || prefetches_load(stmt, prefetch, "b_C", size1);
+    }
+    assert(prefetch_A && prefetch_C);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <tiramisu/tiramisu.h>
+
+#include "test_ir_utils.h"
+#include "wrapper_test_214.h"
+
+using namespace tiramisu;
+
+/**
+ * Test vectorize() with vector_tail_t::masked: the loop over 23 elements
+ * is vectorized by 8 into a single loop over 3 vectors, without a scalar
+ * remainder. The buffers are not padded, so the store of the computation
+ * must be guarded by the mask inside the vectorized loop (Halide turns
+ * it into predicated stores, or scalarizes it on targets without masked
+ * stores). The wrapper checks the output and that the elements that
+ * follow the output buffer are not written.
+ */
+
+void generate_function(std::string name, int size0, int size1)
+{
+    tiramisu::init(name);
+
+    tiramisu::var i("i", 0, size0), j("j", 0, size1);
+
+    tiramisu::input A("A", {i, j}, tiramisu::p_int32);
+    tiramisu::computation B("B", {i, j}, A(i, j) * 2 + i);
+
+    B.vectorize(j, 8, tiramisu::vector_tail_t::masked);
+
+    tiramisu::buffer b_A("b_A", {size0, size1}, tiramisu::p_int32, tiramisu::a_input);
+    tiramisu::buffer b_B("b_B", {size0, size1}, tiramisu::p_int32, tiramisu::a_output);
+
+    A.store_in(&b_A);
+    B.store_in(&b_B);
+
+    tiramisu::codegen({&b_A, &b_B}, "build/generated_fct_test_" + std::string(TEST_NUMBER_STR) + ".o");
+
+    // A single vectorized loop, whose store is under the mask.
+    stmt_summary stmt(tiramisu::global::get_implicit_function()->get_halide_stmt());
+    assert(stmt.vectorized_loops == 1);
+    assert(stmt.stores["b_B"].size() == 1);
+
+    bool masked_store = false;
+    for (const Halide::Internal::IfThenElse *op : stmt.ifs)
+    {
+        stmt_summary guarded(op->then_case);
+        masked_store = masked_store || (guarded.loops == 0 && guarded.stores["b_B"].size() == 1);
+    }
+    assert(masked_store);
+}
+
+int main(int argc, char **argv)
+{
+    generate_function("tiramisu_generated_code", SIZE0, SIZE1);
+
+    return 0;
+}
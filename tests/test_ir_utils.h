@@ -0,0 +1,229 @@
+#ifndef TIRAMISU_test_ir_utils_h
+#define TIRAMISU_test_ir_utils_h
+
+#include <tiramisu/tiramisu.h>
+
+#include <cassert>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * Helpers for the tests that check the Halide statement generated by
+ * Tiramisu in addition to the output of the generated code.
+ */
+
+/**
+ * A summary of a Halide statement: its loads, stores, allocations, let
+ * statements and calls (including intrinsics such as "prefetch"), by name.
+ * The summary holds a reference to the statement, so the pointers to its
+ * nodes remain valid as long as the summary.
+ */
+class stmt_summary : public Halide::Internal::IRVisitor
+{
+    using Halide::Internal::IRVisitor::visit;
+
+public:
+    /**
+     * The number of loads and stores of each buffer in a loop that does not
+     * contain other loops.
+     */
+    struct loop_accesses
+    {
+        std::map<std::string, int> loads;
+        std::map<std::string, int> stores;
+    };
+
+    std::map<std::string, std::vector<const Halide::Internal::Load *>> loads;
+    std::map<std::string, std::vector<const Halide::Internal::Store *>> stores;
+    std::map<std::string, std::vector<const Halide::Internal::Allocate *>> allocations;
+    std::map<std::string, std::vector<const Halide::Internal::LetStmt *>> lets;
+    std::map<std::string, std::vector<const Halide::Internal::Call *>> calls;
+
+    /**
+     * The number of loops around each allocation and let statement.
+     */
+    std::map<const Halide::Internal::IRNode *, int> loop_depth;
+
+    int loops = 0;
+    int vectorized_loops = 0;
+
+    /**
+     * The accesses of the innermost loops, in the order of the statement.
+     */
+    std::vector<loop_accesses> innermost_loops;
+
+    /**
+     * The IfThenElse statements, each one before the statements it contains,
+     * and the variables used in their conditions.
+     */
+    std::vector<const Halide::Internal::IfThenElse *> ifs;
+    std::set<std::string> condition_variables;
+
+    /**
+     * For each buffer, the number of stores between the markers of
+     * non-temporal stores (see mark_nontemporal_stores()), the number of
+     * stores that load the stored buffer (e.g. the stores of a reduction)
+     * and the number of non-temporal stores that load the stored buffer.
+     * The markers are only kept if lower_halide_pipeline() is asked to.
+     */
+    std::map<std::string, int> nontemporal_stores;
+    std::map<std::string, int> read_back_stores;
+    std::map<std::string, int> nontemporal_read_back_stores;
+
+    stmt_summary(const Halide::Internal::Stmt &s) : stmt(s)
+    {
+        stmt.accept(this);
+    }
+
+private:
+    Halide::Internal::Stmt stmt;
+    std::vector<std::pair<loop_accesses, bool>> enclosing_loops;
+    std::set<std::string> loaded;
+    bool in_condition = false;
+    bool marked = false;
+
+    void visit(const Halide::Internal::For *op)
+    {
+        loops++;
+        if (op->for_type == Halide::Internal::ForType::Vectorized)
+            vectorized_loops++;
+
+        if (!enclosing_loops.empty())
+            enclosing_loops.back().second = true;
+        enclosing_loops.push_back(std::make_pair(loop_accesses(), false));
+
+        Halide::Internal::IRVisitor::visit(op);
+
+        if (!enclosing_loops.back().second)
+            innermost_loops.push_back(enclosing_loops.back().first);
+        enclosing_loops.pop_back();
+    }
+
+    void visit(const Halide::Internal::Load *op)
+    {
+        loads[op->name].push_back(op);
+        loaded.insert(op->name);
+        if (!enclosing_loops.empty())
+            enclosing_loops.back().first.loads[op->name]++;
+        Halide::Internal::IRVisitor::visit(op);
+    }
+
+    void visit(const Halide::Internal::Store *op)
+    {
+        stores[op->name].push_back(op);
+        if (!enclosing_loops.empty())
+            enclosing_loops.back().first.stores[op->name]++;
+
+        loaded.clear();
+        Halide::Internal::IRVisitor::visit(op);
+
+        if (marked)
+            nontemporal_stores[op->name]++;
+        if (loaded.count(op->name) > 0)
+        {
+            read_back_stores[op->name]++;
+            if (marked)
+                nontemporal_read_back_stores[op->name]++;
+        }
+    }
+
+    void visit(const Halide::Internal::Allocate *op)
+    {
+        allocations[op->name].push_back(op);
+        loop_depth[op] = enclosing_loops.size();
+        Halide::Internal::IRVisitor::visit(op);
+    }
+
+    void visit(const Halide::Internal::LetStmt *op)
+    {
+        lets[op->name].push_back(op);
+        loop_depth[op] = enclosing_loops.size();
+        Halide::Internal::IRVisitor::visit(op);
+    }
+
+    void visit(const Halide::Internal::Call *op)
+    {
+        // The markers are visited in the order of execution.
+        if (op->name == tiramisu::nontemporal_stores_marker(true))
+            marked = true;
+        else if (op->name == tiramisu::nontemporal_stores_marker(false))
+            marked = false;
+
+        calls[op->name].push_back(op);
+        Halide::Internal::IRVisitor::visit(op);
+    }
+
+    void visit(const Halide::Internal::IfThenElse *op)
+    {
+        ifs.push_back(op);
+
+        in_condition = true;
+        op->condition.accept(this);
+        in_condition = false;
+
+        op->then_case.accept(this);
+        if (op->else_case.defined())
+            op->else_case.accept(this);
+    }
+
+    void visit(const Halide::Internal::Variable *op)
+    {
+        if (in_condition)
+            condition_variables.insert(op->name);
+    }
+};
+
+/**
+ * Return the sum of the counts of \p counts whose name starts with \p prefix
+ * (e.g. the registers created by scalar replacement for a buffer).
+ */
+inline int count_with_prefix(const std::map<std::string, int> &counts, const std::string &prefix)
+{
+    int count = 0;
+    for (const auto &c : counts)
+        if (c.first.compare(0, prefix.size(), prefix) == 0)
+            count += c.second;
+    return count;
+}
+
+/**
+ * Return the extents of the allocation \p op, which must be constant.
+ * Halide extents are ordered from the innermost dimension.
+ */
+inline std::vector<int64_t> allocation_extents(const Halide::Internal::Allocate *op)
+{
+    std::vector<int64_t> extents;
+    for (const Halide::Expr &extent : op->extents)
+    {
+        const int64_t *value = Halide::Internal::as_const_int(extent);
+        assert(value != nullptr);
+        extents.push_back(*value);
+    }
+    return extents;
+}
+
+/**
+ * Lower the Halide statement of \p fct as gen_halide_obj() does and return
+ * the lowered statement. See lower_halide_pipeline() for \p fold_storage
+ * and \p keep_nontemporal_markers.
+ */
+inline Halide::Internal::Stmt lower_function(tiramisu::function *fct, bool fold_storage = false,
+                                             bool keep_nontemporal_markers = false)
+{
+    std::vector<Halide::Argument> arguments;
+    for (const auto &buf : fct->get_arguments())
+        arguments.push_back(Halide::Argument(buf->get_name(),
+                                             tiramisu::halide_argtype_from_tiramisu_argtype(buf->get_argument_type()),
+                                             tiramisu::halide_type_from_tiramisu_type(buf->get_elements_type()),
+                                             buf->get_n_dims()));
+
+    Halide::Module m = tiramisu::lower_halide_pipeline(fct->get_name(), Halide::get_host_target(), arguments,
+                                                       Halide::Internal::LoweredFunc::External,
+                                                       fct->get_halide_stmt(), fold_storage,
+                                                       keep_nontemporal_markers);
+    return m.functions()[0].body;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_198.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<uint16_t> input_buf(SIZE1, SIZE0 + 2, "input_buf");
+    for (int i = 0; i < SIZE0 + 2; i++)
+        for (int j = 0; j < SIZE1; j++)
+            input_buf(j, i) = (uint16_t) (std::rand() % 100);
+
+    Halide::Buffer<uint16_t> reference_buf(SIZE1, SIZE0, "reference_buf");
+    for (int i = 2; i < SIZE0 + 2; i++)
+        for (int j = 0; j < SIZE1; j++)
+            reference_buf(j, i - 2) = (input_buf(j, i - 2) + 1) + (input_buf(j, i - 1) + 1) + (input_buf(j, i) + 1);
+
+    Halide::Buffer<uint16_t> output_buf(SIZE1, SIZE0, "output_buf");
+    init_buffer(output_buf, (uint16_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer());
+
+    compare_buffers(std::string(TEST_NAME_STR), output_buf, reference_buf);
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_199.h"
+
+int main(int, char **)
+{
+    // The buffers are stored with their padded size. The last vector of
+    // each row also computes the padding element.
+    Halide::Buffer<int32_t> input_buf(PADDED_SIZE1, SIZE0, "input_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < PADDED_SIZE1; j++)
+            input_buf(j, i) = std::rand() % 100;
+
+    Halide::Buffer<int32_t> reference_buf(PADDED_SIZE1, SIZE0, "reference_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < PADDED_SIZE1; j++)
+            reference_buf(j, i) = 2 * input_buf(j, i) + 1;
+
+    Halide::Buffer<int32_t> output_buf(PADDED_SIZE1, SIZE0, "output_buf");
+    init_buffer(output_buf, (int32_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer());
+
+    compare_buffers(std::string(TEST_NAME_STR), output_buf, reference_buf);
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_202.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<int32_t> A(SIZE1, SIZE0, "A");
+    Halide::Buffer<int32_t> B(SIZE1, SIZE1, "B");
+    for (int i = 0; i < SIZE0; i++)
+        for (int k = 0; k < SIZE1; k++)
+            A(k, i) = std::rand() % 10 - 5;
+    for (int k = 0; k < SIZE1; k++)
+        for (int j = 0; j < SIZE1; j++)
+            B(j, k) = std::rand() % 10 - 5;
+
+    Halide::Buffer<int32_t> C_ref(SIZE1, SIZE0, "C_ref");
+    Halide::Buffer<int32_t> D_ref(SIZE1, SIZE1, SIZE0, "D_ref");
+    init_buffer(C_ref, (int32_t) 0);
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < SIZE1; j++)
+        {
+            C_ref(j, i) = 0;
+            for (int k = 0; k < SIZE1; k++)
+            {
+                C_ref(j, i) += A(k, i) * B(j, k);
+                D_ref(k, j, i) = C_ref(k, i);
+            }
+        }
+
+    Halide::Buffer<int32_t> C(SIZE1, SIZE0, "C");
+    Halide::Buffer<int32_t> D(SIZE1, SIZE1, SIZE0, "D");
+    init_buffer(C, (int32_t) 0);
+    init_buffer(D, (int32_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(A.raw_buffer(), B.raw_buffer(), C.raw_buffer(), D.raw_buffer());
+
+    compare_buffers(std::string(TEST_NAME_STR) + " (C)", C, C_ref);
+    compare_buffers(std::string(TEST_NAME_STR) + " (D)", D, D_ref);
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "wrapper_test_204.h"
+
+/**
+  * Run the generated code on an input stored at \p offset elements from
+  * a 64-byte aligned address.
+  */
+void run_test(int offset, const std::string &name)
+{
+    std::vector<int32_t> storage(SIZE0 * SIZE1 + 64);
+    int32_t *aligned = storage.data();
+    while (((uintptr_t) aligned) % 64 != 0)
+        aligned++;
+
+    Halide::Buffer<int32_t> input_buf(aligned + offset, SIZE1, SIZE0);
+    Halide::Buffer<int32_t> reference_buf(SIZE1, SIZE0, "reference_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < SIZE1; j++)
+        {
+            input_buf(j, i) = std::rand() % 100;
+            reference_buf(j, i) = 3 * input_buf(j, i) + 1;
+        }
+
+    Halide::Buffer<int32_t> output_buf(SIZE1, SIZE0, "output_buf");
+    init_buffer(output_buf, (int32_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer());
+
+    compare_buffers(name, output_buf, reference_buf);
+}
+
+int main(int, char **)
+{
+    run_test(0, std::string(TEST_NAME_STR) + " (aligned input)");
+    run_test(1, std::string(TEST_NAME_STR) + " (misaligned input)");
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_205.h"
+
+/**
+  * Run the generated code with N = \p size.
+  */
+void run_test(int size, const std::string &name)
+{
+    Halide::Buffer<int32_t> N(1, "N");
+    N(0) = size;
+
+    Halide::Buffer<int32_t> reference_buf(size, size, "reference_buf");
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++)
+            reference_buf(j, i) = i + j + 1;
+
+    Halide::Buffer<int32_t> output_buf(size, size, "output_buf");
+    init_buffer(output_buf, (int32_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(N.raw_buffer(), output_buf.raw_buffer());
+
+    compare_buffers(name, output_buf, reference_buf);
+}
+
+int main(int, char **)
+{
+    run_test(SIZE0, std::string(TEST_NAME_STR) + " (specialized version)");
+    run_test(SIZE1, std::string(TEST_NAME_STR) + " (generic version)");
+
+    return 0;
+}
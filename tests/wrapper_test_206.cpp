@@ -0,0 +1,46 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_206.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<int32_t> A(SIZE1, SIZE0, "A");
+    Halide::Buffer<int32_t> B(SIZE1, SIZE1, "B");
+    for (int i = 0; i < SIZE0; i++)
+        for (int k = 0; k < SIZE1; k++)
+            A(k, i) = std::rand() % 10 - 5;
+    for (int k = 0; k < SIZE1; k++)
+        for (int j = 0; j < SIZE1; j++)
+            B(j, k) = std::rand() % 10 - 5;
+
+    Halide::Buffer<int32_t> reference_buf(SIZE1, SIZE0, "reference_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < SIZE1; j++)
+        {
+            int32_t sum = 0;
+            for (int k = 0; k < SIZE1; k++)
+                sum += (A(k, i) * 2 + 1) * B(j, k);
+            reference_buf(j, i) = sum - (A(j, i) * 2 + 1);
+        }
+
+    Halide::Buffer<int32_t> output_buf(SIZE1, SIZE0, "output_buf");
+    init_buffer(output_buf, (int32_t) 0);
+    Halide::Buffer<int32_t> output_buf_c(SIZE1, SIZE0, "output_buf_c");
+    init_buffer(output_buf_c, (int32_t) 0);
+
+    // Call the Tiramisu generated code (object file and C file)
+    tiramisu_generated_code(A.raw_buffer(), B.raw_buffer(), output_buf.raw_buffer());
+    int error = tiramisu_generated_code_c(A.data(), B.data(), output_buf_c.data());
+
+    if (error != 0)
+        ERROR("\033[1;31mTest " + std::string(TEST_NAME_STR) + " failed: the C code returned " +
+              std::to_string(error) + ".\033[0m\n", true);
+
+    compare_buffers(std::string(TEST_NAME_STR) + " (object file)", output_buf, reference_buf);
+    compare_buffers(std::string(TEST_NAME_STR) + " (C file)", output_buf_c, output_buf);
+
+    return 0;
+}
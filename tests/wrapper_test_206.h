@@ -0,0 +1,32 @@
+#ifndef TIRAMISU_test_h
+#define TIRAMISU_test_h
+
+
+// Define these values for each new test
+#define TEST_NAME_STR       "C backend compiled with OpenMP"
+#define TEST_NUMBER_STR     "206"
+// Data size
+#define SIZE0 64
+#define SIZE1 128
+
+
+// --------------------------------------------------------
+// No need to modify anything in the following ------------
+// --------------------------------------------------------
+
+#include <tiramisu/utils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+int tiramisu_generated_code(halide_buffer_t *_p0_buffer, halide_buffer_t *_p1_buffer, halide_buffer_t *_p2_buffer);
+int tiramisu_generated_code_argv(void **args);
+
+// The function generated in C (see function::gen_c_code()).
+int tiramisu_generated_code_c(const int32_t *b_A, const int32_t *b_B, int32_t *b_D);
+
+extern const struct halide_filter_metadata_t halide_pipeline_aot_metadata;
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+#endif
@@ -0,0 +1,28 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_207.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<int32_t> input_buf(SIZE1, SIZE0, "input_buf");
+    Halide::Buffer<int32_t> reference_buf(SIZE1, SIZE0, "reference_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < SIZE1; j++)
+        {
+            input_buf(j, i) = std::rand() % 100;
+            reference_buf(j, i) = (input_buf(j, i) * 2 + 1) * 3;
+        }
+
+    Halide::Buffer<int32_t> output_buf(SIZE1, SIZE0, "output_buf");
+    init_buffer(output_buf, (int32_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer());
+
+    compare_buffers(TEST_NAME_STR, output_buf, reference_buf);
+
+    return 0;
+}
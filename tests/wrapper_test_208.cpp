@@ -0,0 +1,42 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_208.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<uint16_t> input_buf(SIZE1, SIZE0 + 2, "input_buf");
+    for (int i = 0; i < SIZE0 + 2; i++)
+        for (int j = 0; j < SIZE1; j++)
+            input_buf(j, i) = (uint16_t) (std::rand() % 100);
+
+    Halide::Buffer<uint16_t> reference_buf(SIZE1, SIZE0, "reference_buf");
+    for (int i = 2; i < SIZE0 + 2; i++)
+        for (int j = 0; j < SIZE1; j++)
+            reference_buf(j, i - 2) = (input_buf(j, i - 2) + 1) + (input_buf(j, i - 1) + 1) + (input_buf(j, i) + 1);
+
+    Halide::Buffer<uint16_t> input2_buf(SIZE1, SIZE0, "input2_buf");
+    Halide::Buffer<uint16_t> reference2_buf(SIZE1, SIZE0, "reference2_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < SIZE1; j++)
+        {
+            input2_buf(j, i) = (uint16_t) (std::rand() % 100);
+            reference2_buf(j, i) = input2_buf(j, i) * 2 + 1;
+        }
+
+    Halide::Buffer<uint16_t> output_buf(SIZE1, SIZE0, "output_buf");
+    Halide::Buffer<uint16_t> output2_buf(SIZE1, SIZE0, "output2_buf");
+    init_buffer(output_buf, (uint16_t) 0);
+    init_buffer(output2_buf, (uint16_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer(), input2_buf.raw_buffer(),
+                            output2_buf.raw_buffer());
+
+    compare_buffers(std::string(TEST_NAME_STR), output_buf, reference_buf);
+    compare_buffers(std::string(TEST_NAME_STR) + " (vectorized)", output2_buf, reference2_buf);
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_209.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<int32_t> input_buf(SIZE_W, SIZE_H, SIZE_C, SIZE_N, "input_buf");
+    Halide::Buffer<int32_t> reference_buf(SIZE_W, SIZE_H, SIZE_C, SIZE_N, "reference_buf");
+    for (int n = 0; n < SIZE_N; n++)
+        for (int c = 0; c < SIZE_C; c++)
+            for (int h = 0; h < SIZE_H; h++)
+                for (int w = 0; w < SIZE_W; w++)
+                {
+                    input_buf(w, h, c, n) = std::rand() % 100;
+                    int32_t t1 = input_buf(w, h, c, n) * 2;
+                    reference_buf(w, h, c, n) = (t1 + c) * 3 + t1;
+                }
+
+    Halide::Buffer<int32_t> output_buf(SIZE_W, SIZE_H, SIZE_C, SIZE_N, "output_buf");
+    init_buffer(output_buf, (int32_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer());
+
+    compare_4D_buffers(TEST_NAME_STR, output_buf, reference_buf, 0);
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_210.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<float> input_buf(SIZE, SIZE, "input_buf");
+    for (int i = 0; i < SIZE; i++)
+        for (int j = 0; j < SIZE; j++)
+            input_buf(j, i) = (float) (std::rand() % 100);
+
+    Halide::Buffer<float> reference_buf(SIZE, SIZE, "reference_buf");
+    for (int i = 0; i < SIZE; i++)
+        for (int j = 0; j < SIZE; j++)
+            reference_buf(j, i) = input_buf(i, j) * 2.0f + input_buf(i, j) * 3.0f;
+
+    Halide::Buffer<float> output_buf(SIZE, SIZE, "output_buf");
+    init_buffer(output_buf, (float) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer());
+
+    compare_buffers(std::string(TEST_NAME_STR), output_buf, reference_buf);
+
+    return 0;
+}
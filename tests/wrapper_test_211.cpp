@@ -0,0 +1,111 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <tiramisu/externs.h>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_211.h"
+
+static std::atomic<int> arenas_allocated(0);
+static std::atomic<int> arenas_freed(0);
+
+static void *count_arena_allocation(uint64_t size)
+{
+    arenas_allocated++;
+    return tiramisu_aligned_malloc(size, 128);
+}
+
+static void count_arena_deallocation(void *arena)
+{
+    arenas_freed++;
+    free(arena);
+}
+
+static void *fail_arena_allocation(uint64_t)
+{
+    return nullptr;
+}
+
+static bool is_aligned(void *ptr, uintptr_t alignment)
+{
+    return ((uintptr_t) ptr) % alignment == 0;
+}
+
+/**
+ * Test the arena of the calling thread, which is created by the first
+ * allocation with the user allocator and holds ARENA_SIZE bytes, then
+ * the malloc fallback when the allocator fails.
+ */
+static void test_thread_arena()
+{
+    // Allocations in the arena: the first one creates the arena.
+    char *a = (char *) tiramisu_thread_arena_malloc(1024, 128);
+    assert(arenas_allocated == 1);
+    char *b = (char *) tiramisu_thread_arena_malloc(1024, 256);
+    assert(arenas_allocated == 1);
+    assert(is_aligned(a, 128) && is_aligned(b, 256));
+    assert(b >= a + 1024 && b + 1024 <= a + ARENA_SIZE);
+
+    // The arena is not empty and too small: malloc fallback.
+    char *c = (char *) tiramisu_thread_arena_malloc(ARENA_SIZE, 128);
+    assert(arenas_allocated == 1);
+    assert(c != nullptr && is_aligned(c, 128));
+    assert(c + ARENA_SIZE <= a || c >= a + ARENA_SIZE);
+    c[0] = c[ARENA_SIZE - 1] = 1;
+    tiramisu_thread_arena_free(c);
+
+    // Releasing a buffer releases the memory after it (LIFO).
+    tiramisu_thread_arena_free(b);
+    char *b2 = (char *) tiramisu_thread_arena_malloc(1024, 256);
+    assert(b2 == b);
+    tiramisu_thread_arena_free(b2);
+    tiramisu_thread_arena_free(a);
+    char *a2 = (char *) tiramisu_thread_arena_malloc(1024, 128);
+    assert(a2 == a);
+    tiramisu_thread_arena_free(a2);
+
+    // An empty arena that is too small is replaced by a larger one.
+    char *d = (char *) tiramisu_thread_arena_malloc(2 * ARENA_SIZE, 128);
+    assert(arenas_allocated == 2 && arenas_freed == 1);
+    assert(is_aligned(d, 128));
+    tiramisu_thread_arena_free(d);
+
+    // The allocator fails: malloc fallback.
+    tiramisu_set_thread_arena_allocator(fail_arena_allocation, count_arena_deallocation, ARENA_SIZE);
+    char *e = (char *) tiramisu_thread_arena_malloc(4 * ARENA_SIZE, 128);
+    assert(arenas_freed == 2);
+    assert(e != nullptr && is_aligned(e, 128));
+    e[0] = e[4 * ARENA_SIZE - 1] = 1;
+    tiramisu_thread_arena_free(e);
+    tiramisu_set_thread_arena_allocator(count_arena_allocation, count_arena_deallocation, ARENA_SIZE);
+}
+
+int main(int, char **)
+{
+    tiramisu_set_thread_arena_allocator(count_arena_allocation, count_arena_deallocation, ARENA_SIZE);
+
+    test_thread_arena();
+
+    Halide::Buffer<int32_t> input_buf(SIZE1, SIZE0, "input_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < SIZE1; j++)
+            input_buf(j, i) = std::rand() % 100;
+
+    Halide::Buffer<int32_t> reference_buf(SIZE1, SIZE0, "reference_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < SIZE1; j++)
+            reference_buf(j, i) = (input_buf(j, i) + 1) + (i * 2 + j * (SIZE2 / SIZE1));
+
+    Halide::Buffer<int32_t> output_buf(SIZE1, SIZE0, "output_buf");
+    init_buffer(output_buf, (int32_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer());
+
+    compare_buffers(std::string(TEST_NAME_STR), output_buf, reference_buf);
+
+    return 0;
+}
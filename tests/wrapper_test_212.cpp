@@ -0,0 +1,37 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "wrapper_test_212.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<int32_t> input_buf(SIZE1, SIZE0, "input_buf");
+    Halide::Buffer<int32_t> reference_buf(SIZE1, SIZE0, "reference_buf");
+    Halide::Buffer<int32_t> reference_sum_buf(SIZE0, "reference_sum_buf");
+    for (int i = 0; i < SIZE0; i++)
+    {
+        int32_t sum = 0;
+        for (int j = 0; j < SIZE1; j++)
+        {
+            input_buf(j, i) = std::rand() % 100;
+            sum += input_buf(j, i);
+            reference_buf(j, i) = sum;
+        }
+        reference_sum_buf(i) = sum;
+    }
+
+    Halide::Buffer<int32_t> output_buf(SIZE1, SIZE0, "output_buf");
+    Halide::Buffer<int32_t> output_sum_buf(SIZE0, "output_sum_buf");
+    init_buffer(output_buf, (int32_t) 0);
+    init_buffer(output_sum_buf, (int32_t) 0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer(), output_sum_buf.raw_buffer());
+
+    compare_buffers(std::string(TEST_NAME_STR) + " (prefix sums)", output_buf, reference_buf);
+    compare_buffers(std::string(TEST_NAME_STR) + " (sums)", output_sum_buf, reference_sum_buf);
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "Halide.h"
+#include <tiramisu/utils.h>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "wrapper_test_214.h"
+
+int main(int, char **)
+{
+    Halide::Buffer<int32_t> input_buf(SIZE1, SIZE0, "input_buf");
+    Halide::Buffer<int32_t> reference_buf(SIZE1, SIZE0, "reference_buf");
+    for (int i = 0; i < SIZE0; i++)
+        for (int j = 0; j < SIZE1; j++)
+        {
+            input_buf(j, i) = std::rand() % 100;
+            reference_buf(j, i) = 2 * input_buf(j, i) + i;
+        }
+
+    // The output is followed by a vector of elements that must not be
+    // written by the masked last vector of the last row.
+    std::vector<int32_t> storage(SIZE0 * SIZE1 + 8, -1);
+    Halide::Buffer<int32_t> output_buf(storage.data(), SIZE1, SIZE0);
+
+    // Call the Tiramisu generated code
+    tiramisu_generated_code(input_buf.raw_buffer(), output_buf.raw_buffer());
+
+    compare_buffers(std::string(TEST_NAME_STR), output_buf, reference_buf);
+
+    for (int k = SIZE0 * SIZE1; k < (int) storage.size(); k++)
+        if (storage[k] != -1)
+            ERROR("\033[1;31mTest " + std::string(TEST_NAME_STR) + " failed: the element " +
+                  std::to_string(k - SIZE0 * SIZE1) + " after the output was written.\033[0m\n", true);
+
+    return 0;
+}
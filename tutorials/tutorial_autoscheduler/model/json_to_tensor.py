@@ -2,6 +2,7 @@ import numpy as np
 import torch
 import math
 import copy
+import json
 
 device = "cpu"
 
@@ -116,3 +117,53 @@ def get_representation(program_json, schedule_json):
     program_tensor = torch.unsqueeze(torch.FloatTensor(program_representation),0).to(device)     
 
     return prog_tree, program_tensor
+
+def get_schedule_json(program_json, record, shiftings, tree_structure):
+    """
+    Build the schedule JSON from a schedule record sent by evaluate_by_learning_model
+    and from its shiftings, given as (absolute order of the computation, loop level, shift)
+    (see evaluate_by_learning_model::write_schedule).
+    """
+    unfuse_l0, int_l0, int_l1, tile_nb_l, tile_l0, tile_f0, tile_f1, tile_f2, unrolling_fact, \
+        par_l0, vector_width, skew_l0, skew_f0, skew_f1, _ = record
+    tile_facts = [tile_f0, tile_f1, tile_f2]
+    
+    schedule_json = dict()
+    iterators = []
+    
+    for comp_name, comp_dict in program_json['computations'].items():
+        iterators = list(comp_dict['iterators'])
+        comp_sched = dict()
+        
+        comp_sched['interchange_dims'] = []
+        if int_l0 != -1:
+            comp_sched['interchange_dims'] = [iterators[int_l0], iterators[int_l1]]
+            iterators[int_l0], iterators[int_l1] = iterators[int_l1], iterators[int_l0]
+            
+        comp_sched['tiling'] = {}
+        if tile_nb_l != 0:
+            comp_sched['tiling'] = {
+                'tiling_depth' : tile_nb_l,
+                'tiling_dims' : iterators[tile_l0:tile_l0 + tile_nb_l],
+                'tiling_factors' : [str(f) for f in tile_facts[:tile_nb_l]]
+            }
+            
+        comp_sched['unrolling_factor'] = str(unrolling_fact) if unrolling_fact != 0 else None
+        comp_sched['parallelized_dim'] = iterators[par_l0] if par_l0 != -1 else None
+        comp_sched['vectorization_factor'] = str(vector_width) if vector_width != 0 else None
+        
+        comp_sched['skewing'] = {}
+        if skew_l0 != -1:
+            comp_sched['skewing'] = {
+                'skewed_dims' : iterators[skew_l0:skew_l0 + 2],
+                'skewing_factors' : [str(skew_f0), str(skew_f1)]
+            }
+            
+        comp_sched['shiftings'] = [[iterators[l0], str(shift)] for comp_order, l0, shift in shiftings
+                                   if comp_order == comp_dict['absolute_order']]
+        schedule_json[comp_name] = comp_sched
+        
+    schedule_json['unfuse_iterators'] = [iterators[unfuse_l0]] if unfuse_l0 != -1 else []
+    schedule_json['tree_structure'] = json.loads('{' + tree_structure + '}')
+    
+    return schedule_json
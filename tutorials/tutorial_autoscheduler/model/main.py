@@ -1,5 +1,5 @@
 from os import environ
-import sys, json
+import sys, json, struct
 
 from hier_lstm import Model_hier_LSTM
 from json_to_tensor import *
@@ -28,19 +28,60 @@ with torch.no_grad():
     model.to(device)
     model.eval()
 
-    try:
-        while True:
-            prog_json = input()
-            sched_json = input()
-
-            prog_json = json.loads(prog_json)
-            sched_json = json.loads(sched_json)
-
-            tree_tensor = get_representation(prog_json, sched_json)
+    stdin = sys.stdin.buffer
+    stdout = sys.stdout.buffer
+    
+    PROGRAM_FRAME = 1
+    SCHEDULES_FRAME = 2
+    
+    prog_json = None
+    
+    while True:
+        header = stdin.read(8)
+        if len(header) < 8:
+            exit()
+            
+        frame_type, size = struct.unpack('=ii', header)
+        
+        # The program is sent once, before its first schedules
+        if frame_type == PROGRAM_FRAME:
+            prog_json = json.loads(stdin.read(size).decode())
+            continue
             
-            speedup = model.forward(tree_tensor)
-            print(float(speedup.item()))
+        # Read the distinct tree structures of the frame, then the schedules
+        nb_trees, = struct.unpack('=i', stdin.read(4))
+        tree_structures = []
+        for i in range(nb_trees):
+            tree_size, = struct.unpack('=i', stdin.read(4))
+            tree_structures.append(stdin.read(tree_size).decode())
             
-    except EOFError:
-        exit()
+        # Each record is followed by its shiftings : (computation, loop level, shift)
+        records = []
+        shiftings = []
+        for i in range(size):
+            records.append(struct.unpack('=15i', stdin.read(60)))
+            nb_shiftings, = struct.unpack('=i', stdin.read(4))
+            values = struct.unpack('=%di' % (3 * nb_shiftings), stdin.read(12 * nb_shiftings))
+            shiftings.append([values[j:j + 3] for j in range(0, len(values), 3)])
         
+        # Schedules that share a tree structure are evaluated in one batch :
+        # their program tensors are stacked along the batch dimension.
+        speedups = [0.] * size
+        for tree_index, tree_structure in enumerate(tree_structures):
+            batch = [i for i in range(size) if records[i][14] == tree_index]
+            if not batch:
+                continue
+                
+            prog_tree = None
+            tensors = []
+            for i in batch:
+                sched_json = get_schedule_json(prog_json, records[i], shiftings[i], tree_structure)
+                prog_tree, prog_tensor = get_representation(prog_json, sched_json)
+                tensors.append(prog_tensor)
+                
+            batch_speedups = model.forward((prog_tree, torch.cat(tensors, 0)))
+            for i, speedup in zip(batch, batch_speedups.tolist()):
+                speedups[i] = float(speedup)
+                
+        stdout.write(struct.pack('=i%df' % len(speedups), len(speedups), *speedups))
+        stdout.flush()